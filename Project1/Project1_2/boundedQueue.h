@@ -0,0 +1,129 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+/// <summary>
+/// 容量に上限のあるスレッド間キュー
+/// 満杯のときのPushは空きができるまで待つため、後段が詰まると前段も自然に止まる
+/// Close()以降、Pushは失敗し、Popは残っている要素を取り出し終えた時点で失敗する
+/// </summary>
+/// <typeparam name="T">キューに入れる要素の型</typeparam>
+template <typename T>
+class BoundedQueue
+{
+private:
+	std::deque<T> mItems;
+	size_t mCapacity;
+	// これまでの最大の要素数
+	size_t mMaxDepth;
+	bool mClosed;
+	mutable std::mutex mMutex;
+	std::condition_variable mNotEmpty;
+	std::condition_variable mNotFull;
+
+public:
+	explicit BoundedQueue(size_t capacity) : mCapacity(capacity > 0 ? capacity : 1), mMaxDepth(0), mClosed(false)
+	{
+	}
+
+	BoundedQueue(const BoundedQueue&) = delete;
+	BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+	/// <summary>
+	/// 末尾に要素を追加（満杯の場合は空きができるまで待つ）
+	/// </summary>
+	/// <param name="item">追加する要素</param>
+	/// <returns>キューが閉じられていて追加できなかった場合はfalse</returns>
+	bool Push(T item)
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+		mNotFull.wait(lock, [this]() { return mClosed || mItems.size() < mCapacity; });
+		if (mClosed)
+		{
+			return false;
+		}
+
+		mItems.push_back(std::move(item));
+		if (mItems.size() > mMaxDepth)
+		{
+			mMaxDepth = mItems.size();
+		}
+		lock.unlock();
+		mNotEmpty.notify_one();
+		return true;
+	}
+
+	/// <summary>
+	/// 先頭の要素を取り出す（空の場合は要素が追加されるか閉じられるまで待つ）
+	/// </summary>
+	/// <param name="item">取り出した要素の格納先</param>
+	/// <returns>キューが閉じられていて空の場合はfalse</returns>
+	bool Pop(T& item)
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+		mNotEmpty.wait(lock, [this]() { return mClosed || !mItems.empty(); });
+		if (mItems.empty())
+		{
+			return false;
+		}
+
+		item = std::move(mItems.front());
+		mItems.pop_front();
+		lock.unlock();
+		mNotFull.notify_one();
+		return true;
+	}
+
+	/// <summary>
+	/// キューを閉じ、待っているスレッドをすべて起こす
+	/// </summary>
+	void Close()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mClosed = true;
+		}
+		mNotEmpty.notify_all();
+		mNotFull.notify_all();
+	}
+
+	/// <summary>
+	/// 残っている要素を捨ててキューを再び使える状態に戻す
+	/// </summary>
+	void Reopen()
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mItems.clear();
+		mMaxDepth = 0;
+		mClosed = false;
+	}
+
+	/// <summary>
+	/// 現在の要素数を取得
+	/// </summary>
+	size_t Depth() const
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		return mItems.size();
+	}
+
+	/// <summary>
+	/// これまでの最大の要素数を取得
+	/// </summary>
+	size_t MaxDepth() const
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		return mMaxDepth;
+	}
+
+	/// <summary>
+	/// 容量を取得
+	/// </summary>
+	size_t Capacity() const
+	{
+		return mCapacity;
+	}
+};
@@ -0,0 +1,259 @@
+#pragma once
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_set>
+
+#include "playerScore.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PLAYER_ID_SSE2 1
+#endif
+
+/// <summary>
+/// 固定長のバッファに収まらない長さのIDを保持する置き場
+/// 同じ内容のIDは同じ領域を指すので、ポインタの比較だけで一致を判定できる
+/// 登録したIDは解放せず、プロセスの終了まで有効
+/// </summary>
+class PlayerIdInterner
+{
+public:
+	/// <summary>
+	/// 共有のインスタンスを取得（終了時に破棄されたIDを参照しないよう、インスタンスは破棄しない）
+	/// </summary>
+	static PlayerIdInterner& Instance()
+	{
+		static PlayerIdInterner* instance = new PlayerIdInterner();
+		return *instance;
+	}
+
+	/// <summary>
+	/// IDを登録し、登録済みの同じ内容の領域を取得（どのスレッドから呼んでもよい）
+	/// </summary>
+	/// <param name="id">登録するID</param>
+	/// <returns>IDの内容を保持する領域の先頭</returns>
+	const char* Intern(std::string_view id)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		auto found = mIds.find(id);
+		if (found != mIds.end())
+		{
+			return found->data();
+		}
+		// dequeは要素を追加しても既存の要素が移動しないので、文字列の領域も動かない
+		const std::string& stored = mStorage.emplace_back(id);
+		mIds.insert(std::string_view(stored));
+		return stored.data();
+	}
+
+	/// <summary>
+	/// 登録済みのIDの数を取得
+	/// </summary>
+	size_t Count()
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		return mIds.size();
+	}
+
+private:
+	std::mutex mMutex;
+	std::deque<std::string> mStorage;
+	std::unordered_set<std::string_view> mIds;
+
+	PlayerIdInterner() = default;
+};
+
+/// <summary>
+/// 先頭InlineSizeバイトを固定長のバッファに持つプレイヤーID
+/// 一致判定と大小比較は16バイトをまとめて比較し（SSE2が使えない環境では1バイトずつ）、
+/// InlineSizeを超える長さのIDは残りをPlayerIdInternerに登録して、その領域を指す
+/// 自身でメモリを所有しないため、コピーはmemcpyと同じで、trivially copyable になる
+/// IDに'\0'が含まれていてもよい
+/// </summary>
+class PlayerId
+{
+public:
+	// バッファに収まるIDの長さ
+	static constexpr size_t InlineSize = 16;
+
+	/// <summary>
+	/// 空のIDを作成
+	/// </summary>
+	PlayerId() : mInline{}, mOverflow(nullptr), mLength(0)
+	{
+	}
+
+	/// <summary>
+	/// IDを作成（InlineSizeを超える長さのIDはPlayerIdInternerに登録する）
+	/// </summary>
+	/// <param name="id">ID</param>
+	explicit PlayerId(std::string_view id) : mInline{}, mOverflow(nullptr), mLength(static_cast<uint32_t>(id.size()))
+	{
+		std::memcpy(mInline, id.data(), id.size() < InlineSize ? id.size() : InlineSize);
+		if (id.size() > InlineSize)
+		{
+			mOverflow = PlayerIdInterner::Instance().Intern(id);
+		}
+	}
+
+	/// <summary>
+	/// IDの長さを取得
+	/// </summary>
+	size_t Size() const
+	{
+		return mLength;
+	}
+
+	/// <summary>
+	/// IDの内容を取得（IDが有効な間だけ有効）
+	/// </summary>
+	std::string_view View() const
+	{
+		return std::string_view(mOverflow ? mOverflow : mInline, mLength);
+	}
+
+	/// <summary>
+	/// IDの内容をstd::stringとして取得
+	/// </summary>
+	std::string ToString() const
+	{
+		return std::string(View());
+	}
+
+	/// <summary>
+	/// 二つのIDが同じ内容か比較
+	/// </summary>
+	bool operator==(const PlayerId& other) const
+	{
+		// 長いIDは同じ内容なら同じ領域を指すので、先頭のバッファとポインタが一致すれば同じ内容
+		return mLength == other.mLength && mOverflow == other.mOverflow && FirstDifference(other) == InlineSize;
+	}
+
+	/// <summary>
+	/// 二つのIDが異なる内容か比較
+	/// </summary>
+	bool operator!=(const PlayerId& other) const
+	{
+		return !(*this == other);
+	}
+
+	/// <summary>
+	/// 辞書順（バイト単位の符号なしの比較）で前に来るか比較
+	/// </summary>
+	bool operator<(const PlayerId& other) const
+	{
+		return Compare(other) < 0;
+	}
+
+	/// <summary>
+	/// 辞書順（バイト単位の符号なしの比較）で比較
+	/// </summary>
+	/// <returns>このIDが前なら負、同じなら0、後なら正</returns>
+	int Compare(const PlayerId& other) const
+	{
+		const size_t shorter = mLength < other.mLength ? mLength : other.mLength;
+		const size_t diff = FirstDifference(other);
+		if (diff < InlineSize && diff < shorter)
+		{
+			return static_cast<unsigned char>(mInline[diff]) < static_cast<unsigned char>(other.mInline[diff]) ? -1 : 1;
+		}
+		// 両方のIDの長さがInlineSizeを超え、先頭が一致した場合だけ残りを比較する
+		if (shorter > InlineSize && mOverflow != other.mOverflow)
+		{
+			const int rest = View().substr(InlineSize).compare(other.View().substr(InlineSize));
+			if (rest != 0)
+			{
+				return rest;
+			}
+		}
+		return mLength < other.mLength ? -1 : (mLength > other.mLength ? 1 : 0);
+	}
+
+private:
+	// IDの先頭InlineSizeバイト（短いIDの残りは0で埋める）
+	char mInline[InlineSize];
+	// InlineSizeを超える長さのIDの場合は、PlayerIdInternerに登録した全体の領域（それ以外はnullptr）
+	const char* mOverflow;
+	uint32_t mLength;
+
+	/// <summary>
+	/// 先頭のバッファで最初に異なるバイトの位置を求める（すべて同じならInlineSize）
+	/// </summary>
+	size_t FirstDifference(const PlayerId& other) const
+	{
+#ifdef PLAYER_ID_SSE2
+		const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mInline));
+		const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(other.mInline));
+		const unsigned differs = ~static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(a, b))) & 0xFFFFu;
+		return differs ? static_cast<size_t>(std::countr_zero(differs)) : InlineSize;
+#else
+		for (size_t i = 0; i < InlineSize; i++)
+		{
+			if (mInline[i] != other.mInline[i])
+			{
+				return i;
+			}
+		}
+		return InlineSize;
+#endif
+	}
+};
+
+static_assert(std::is_trivially_copyable_v<PlayerId>, "PlayerId must be trivially copyable");
+
+/// <summary>
+/// IDを固定長のバッファに持つPlayerScore
+/// trivially copyable なので、要素をまとめてmemcpyでコピーできる
+/// （InlineSizeを超える長さのIDはプロセス内の領域を指すため、バイナリのままファイルへ書き出せるのは短いIDだけ）
+/// </summary>
+struct CompactPlayerScore
+{
+	int score;
+	PlayerId id;
+
+
+	CompactPlayerScore() : score(0)
+	{
+	}
+
+	CompactPlayerScore(int score, std::string_view id) : score(score), id(id)
+	{
+	}
+
+	/// <summary>
+	/// PlayerScoreから変換
+	/// </summary>
+	explicit CompactPlayerScore(const PlayerScore& playerScore) : score(playerScore.score), id(playerScore.id)
+	{
+	}
+
+	/// <summary>
+	/// PlayerScoreへ変換
+	/// </summary>
+	PlayerScore ToPlayerScore() const
+	{
+		return PlayerScore(score, id.ToString());
+	}
+};
+
+static_assert(std::is_trivially_copyable_v<CompactPlayerScore>, "CompactPlayerScore must be trivially copyable");
+
+/// <summary>
+/// PlayerIdのハッシュ（unordered_mapなどのキーに使う）
+/// </summary>
+template <>
+struct std::hash<PlayerId>
+{
+	size_t operator()(const PlayerId& id) const noexcept
+	{
+		return std::hash<std::string_view>()(id.View());
+	}
+};
@@ -0,0 +1,265 @@
+#pragma once
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <utility>
+#include <variant>
+
+#if defined(__cpp_exceptions) || defined(_CPPUNWIND)
+#include <exception>
+#endif
+
+// 例外が有効なビルドかどうか（-fno-exceptions や /EHs- の場合は0）
+#if defined(__cpp_exceptions) || defined(_CPPUNWIND)
+#define LINKEDLIST_EXCEPTIONS 1
+#else
+#define LINKEDLIST_EXCEPTIONS 0
+#endif
+
+// 途中まで構築したものを片付けてから例外を送り直す処理を、例外が無効なビルドでもそのまま書けるようにするマクロ
+// 例外が無効なビルドでは LINKEDLIST_TRY の本体だけが実行され、LINKEDLIST_CATCH_ALL の本体は実行されない
+#if LINKEDLIST_EXCEPTIONS
+#define LINKEDLIST_TRY try
+#define LINKEDLIST_CATCH_ALL catch (...)
+#define LINKEDLIST_RETHROW throw
+#define LINKEDLIST_THROW(exception) throw exception
+#else
+#define LINKEDLIST_TRY if (true)
+#define LINKEDLIST_CATCH_ALL else
+#define LINKEDLIST_RETHROW ((void)0)
+#define LINKEDLIST_THROW(exception) AbortWithMessage((exception).what())
+#endif
+
+/// <summary>
+/// メッセージを標準エラー出力へ書き出してプロセスを異常終了させる
+/// </summary>
+[[noreturn]] inline void AbortWithMessage(const char* message)
+{
+	std::fputs(message, stderr);
+	std::fputc('\n', stderr);
+	std::abort();
+}
+
+/// <summary>
+/// 無効なイテレータの操作など、コンテナの誤った使い方を検出した際に呼ぶ関数
+/// 呼び出し元へ戻ってはならない（例外を送出するか、プロセスを終了させる）
+/// </summary>
+using MisuseHandler = void (*)(const char* message);
+
+/// <summary>
+/// std::runtime_errorを送出する（例外が有効なビルドの既定）
+/// </summary>
+inline void ThrowingMisuseHandler(const char* message)
+{
+#if LINKEDLIST_EXCEPTIONS
+	throw std::runtime_error(message);
+#else
+	AbortWithMessage(message);
+#endif
+}
+
+/// <summary>
+/// メッセージを書き出してプロセスを終了させる（例外が無効なビルドの既定）
+/// </summary>
+inline void TerminatingMisuseHandler(const char* message)
+{
+	AbortWithMessage(message);
+}
+
+namespace ErrorPolicyDetail
+{
+	inline std::atomic<MisuseHandler>& CurrentMisuseHandler()
+	{
+		static std::atomic<MisuseHandler> handler(LINKEDLIST_EXCEPTIONS ? ThrowingMisuseHandler : TerminatingMisuseHandler);
+		return handler;
+	}
+}
+
+/// <summary>
+/// 誤った使い方を検出した際に呼ぶ関数を設定（すべてのスレッド・コンテナで共通）
+/// </summary>
+/// <param name="handler">呼ぶ関数（nullptrなら既定の関数に戻す）</param>
+/// <returns>それまで設定されていた関数</returns>
+inline MisuseHandler SetMisuseHandler(MisuseHandler handler)
+{
+	if (!handler)
+	{
+		handler = LINKEDLIST_EXCEPTIONS ? ThrowingMisuseHandler : TerminatingMisuseHandler;
+	}
+	return ErrorPolicyDetail::CurrentMisuseHandler().exchange(handler, std::memory_order_acq_rel);
+}
+
+/// <summary>
+/// 誤った使い方を通知する
+/// 検出時にだけ呼ばれるため、呼び出し元へはインライン展開させず、正常時の処理を小さく保つ
+/// </summary>
+/// <param name="message">誤りの内容</param>
+#if defined(_MSC_VER)
+[[noreturn]] __declspec(noinline) inline void ReportMisuse(const char* message)
+#else
+[[noreturn]] __attribute__((noinline, cold)) inline void ReportMisuse(const char* message)
+#endif
+{
+	ErrorPolicyDetail::CurrentMisuseHandler().load(std::memory_order_acquire)(message);
+	// 設定された関数が戻ってきた場合も処理は続けられない
+	AbortWithMessage(message);
+}
+
+/// <summary>
+/// 別のスレッドで発生した例外を、結果を待つスレッドへ運ぶための入れ物
+/// 例外が無効なビルドでは例外が発生しないため、何も持たない
+/// </summary>
+class CapturedException
+{
+public:
+	/// <summary>
+	/// 処理中の例外を記録（LINKEDLIST_CATCH_ALL の本体で呼ぶ）
+	/// </summary>
+	static CapturedException Current()
+	{
+		CapturedException captured;
+#if LINKEDLIST_EXCEPTIONS
+		captured.mError = std::current_exception();
+#endif
+		return captured;
+	}
+
+	/// <summary>
+	/// 例外を記録しているか
+	/// </summary>
+	explicit operator bool() const
+	{
+#if LINKEDLIST_EXCEPTIONS
+		return static_cast<bool>(mError);
+#else
+		return false;
+#endif
+	}
+
+	/// <summary>
+	/// 記録した例外を送出する（記録していなければ何もしない）
+	/// </summary>
+	void RethrowIfAny() const
+	{
+#if LINKEDLIST_EXCEPTIONS
+		if (mError)
+		{
+			std::rethrow_exception(mError);
+		}
+#endif
+	}
+
+private:
+#if LINKEDLIST_EXCEPTIONS
+	std::exception_ptr mError;
+#endif
+};
+
+/// <summary>
+/// Expectedにエラーを格納する際に使う包み
+/// </summary>
+template <typename E>
+struct Unexpected
+{
+	E error;
+
+	explicit Unexpected(E error) : error(std::move(error))
+	{
+	}
+};
+
+/// <summary>
+/// 値か、値を得られなかった理由のどちらかを持つ結果（C++23のstd::expectedの必要な部分だけを持つ）
+/// 例外を使わずに失敗を呼び出し元へ返す
+/// </summary>
+/// <typeparam name="T">成功時の値</typeparam>
+/// <typeparam name="E">失敗の理由</typeparam>
+template <typename T, typename E>
+class Expected
+{
+public:
+	Expected(const T& value) : mStorage(std::in_place_index<0>, value)
+	{
+	}
+
+	Expected(T&& value) : mStorage(std::in_place_index<0>, std::move(value))
+	{
+	}
+
+	Expected(Unexpected<E> unexpected) : mStorage(std::in_place_index<1>, std::move(unexpected.error))
+	{
+	}
+
+	/// <summary>
+	/// 値を持っているか
+	/// </summary>
+	bool HasValue() const
+	{
+		return mStorage.index() == 0;
+	}
+
+	explicit operator bool() const
+	{
+		return HasValue();
+	}
+
+	/// <summary>
+	/// 値を取得（値を持っていなければ誤った使い方として通知する）
+	/// </summary>
+	T& Value()
+	{
+		if (!HasValue())
+		{
+			ReportMisuse("Expected has no value");
+		}
+		return *std::get_if<0>(&mStorage);
+	}
+
+	/// <summary>
+	/// 値を取得（値を持っていなければ誤った使い方として通知する）
+	/// </summary>
+	const T& Value() const
+	{
+		if (!HasValue())
+		{
+			ReportMisuse("Expected has no value");
+		}
+		return *std::get_if<0>(&mStorage);
+	}
+
+	/// <summary>
+	/// 失敗の理由を取得（値を持っている場合は誤った使い方として通知する）
+	/// </summary>
+	const E& Error() const
+	{
+		if (HasValue())
+		{
+			ReportMisuse("Expected has a value");
+		}
+		return *std::get_if<1>(&mStorage);
+	}
+
+	T& operator*()
+	{
+		return Value();
+	}
+
+	const T& operator*() const
+	{
+		return Value();
+	}
+
+	T* operator->()
+	{
+		return &Value();
+	}
+
+	const T* operator->() const
+	{
+		return &Value();
+	}
+
+private:
+	std::variant<T, E> mStorage;
+};
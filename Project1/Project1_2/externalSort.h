@@ -0,0 +1,425 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <optional>
+#include <queue>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "linkedList.h"
+#include "playerScore.h"
+#include "scoreLoader.h"
+#include "scoreSnapshot.h"
+#include "scoreWriter.h"
+
+/// <summary>
+/// 外部ソートの設定
+/// </summary>
+struct ExternalSortOptions
+{
+	// memoryBudgetとして受け付ける最小値（これより小さい値はこの値として扱い、1行ごとにランができるのを防ぐ）
+	static constexpr size_t MinMemoryBudget = 4 << 10;
+	// マージ時に1つのランへ割り当てたい読み込みバッファの大きさ
+	// 同時にマージするランの数はmemoryBudgetをこの値で割った数（最低2）までに抑え、超える分は中間のマージで減らす
+	static constexpr size_t MergeBufferSize = 64 << 10;
+
+	// 1つのランをメモリ上に保持する際の上限バイト数（要素とIDの見積もりサイズの合計）
+	size_t memoryBudget = 256 << 20;
+	// 読み書き1回あたりのバッファサイズ
+	size_t ioBufferSize = 1 << 20;
+	// ランを書き出す一時ファイルのディレクトリ（空の場合は出力ファイルと同じ場所）
+	std::string tempDirectory;
+};
+
+/// <summary>
+/// 外部ソートの結果
+/// </summary>
+struct ExternalSortStats
+{
+	// 出力した行数
+	uint64_t rows = 0;
+	// 一時ファイルに書き出したランの数（メモリに収まった場合は0）
+	size_t runs = 0;
+	// 最後のマージの前に、ランの数を減らすために行った中間のマージの回数
+	size_t mergePasses = 0;
+};
+
+namespace ExternalSortDetail
+{
+	/// <summary>
+	/// 一時ファイルに書き出したランを先頭から順に読み込むクラス
+	/// ランはScoreFormat::Binary形式で書き出す
+	/// </summary>
+	class RunReader
+	{
+	public:
+		RunReader(const std::string& path, size_t bufferSize)
+			: mFile(path, std::ios::binary), mBuffer(bufferSize > 16 ? bufferSize : 16), mBegin(0), mEnd(0),
+			mFailed(!mFile.is_open())
+		{
+		}
+
+		/// <summary>
+		/// 次の行を読み込む
+		/// </summary>
+		/// <param name="playerScore">読み込んだ行の格納先</param>
+		/// <returns>ランの終わりに達した、または読み込めなかった場合はfalse（どちらかはFailed()で区別する）</returns>
+		bool Next(PlayerScore& playerScore)
+		{
+			if (mFailed)
+			{
+				return false;
+			}
+			if (!Fill(8))
+			{
+				// 行の境目でファイルが終わっていれば正常な終わり、途中で終わっていれば壊れている
+				mFailed = mFile.bad() || mEnd > mBegin;
+				return false;
+			}
+			const int score = static_cast<int>(static_cast<uint32_t>(SnapshotDetail::LoadUInt(&mBuffer[mBegin], 4)));
+			const size_t idLength = static_cast<size_t>(SnapshotDetail::LoadUInt(&mBuffer[mBegin + 4], 4));
+			if (!Fill(8 + idLength))
+			{
+				mFailed = true;
+				return false;
+			}
+			playerScore.score = score;
+			playerScore.id.assign(&mBuffer[mBegin + 8], idLength);
+			mBegin += 8 + idLength;
+			return true;
+		}
+
+		/// <summary>
+		/// 開けなかった、読み込みに失敗した、または行の途中で終わっていたためにランを最後まで読めなかったか
+		/// </summary>
+		bool Failed() const
+		{
+			return mFailed;
+		}
+
+	private:
+		std::ifstream mFile;
+		std::vector<char> mBuffer;
+		size_t mBegin;
+		size_t mEnd;
+		bool mFailed;
+
+		/// <summary>
+		/// バッファの未読部分が size バイト以上になるまで読み込む
+		/// </summary>
+		bool Fill(size_t size)
+		{
+			if (mEnd - mBegin >= size)
+			{
+				return true;
+			}
+
+			// 未読部分を先頭へ寄せてから読み足す
+			std::copy(mBuffer.begin() + mBegin, mBuffer.begin() + mEnd, mBuffer.begin());
+			mEnd -= mBegin;
+			mBegin = 0;
+			if (mBuffer.size() < size)
+			{
+				mBuffer.resize(size);
+			}
+
+			while (mEnd < size && mFile)
+			{
+				mFile.read(mBuffer.data() + mEnd, static_cast<std::streamsize>(mBuffer.size() - mEnd));
+				mEnd += static_cast<size_t>(mFile.gcount());
+			}
+			return mEnd >= size;
+		}
+	};
+
+	/// <summary>
+	/// 行を大きなバッファにためてからファイルへ書き出すクラス
+	/// </summary>
+	class RowFileWriter
+	{
+	public:
+		RowFileWriter(const std::string& path, ScoreFormat format, size_t bufferSize)
+			: mFile(path, std::ios::binary | std::ios::trunc), mFormat(format), mBufferSize(bufferSize)
+		{
+			mBuffer.reserve(mBufferSize + 64);
+		}
+
+		bool IsOpen() const
+		{
+			return mFile.is_open();
+		}
+
+		void Write(const PlayerScore& playerScore)
+		{
+			ScoreWriter::AppendRow(mBuffer, playerScore, mFormat);
+			if (mBuffer.size() >= mBufferSize)
+			{
+				mFile.write(mBuffer.data(), static_cast<std::streamsize>(mBuffer.size()));
+				mBuffer.clear();
+			}
+		}
+
+		/// <summary>
+		/// 残りを書き出して閉じる
+		/// </summary>
+		/// <returns>すべての書き込みが成功していればtrue</returns>
+		bool Close()
+		{
+			mFile.write(mBuffer.data(), static_cast<std::streamsize>(mBuffer.size()));
+			mBuffer.clear();
+			mFile.close();
+			return !mFile.fail();
+		}
+
+	private:
+		std::ofstream mFile;
+		ScoreFormat mFormat;
+		size_t mBufferSize;
+		std::string mBuffer;
+	};
+
+	/// <summary>
+	/// paths[begin, end) のランを先頭から少しずつ読みながらk-wayマージし、1行ずつwriteへ渡す
+	/// 比較が等しい行は前のランの行を先に渡して安定性を保つ
+	/// </summary>
+	/// <returns>すべてのランを最後まで読めた場合はtrue（falseの場合は一部の行が欠けている）</returns>
+	template <typename Less, typename Write>
+	bool MergeRuns(const std::vector<std::string>& paths, size_t begin, size_t end, size_t bufferSize, Less& less, Write&& write)
+	{
+		std::vector<RunReader> readers;
+		std::vector<PlayerScore> heads;
+		readers.reserve(end - begin);
+		heads.reserve(end - begin);
+
+		// 先頭の値が小さいランを取り出すヒープ（等しい場合は先に書き出したランを優先する）
+		auto later = [&heads, &less](size_t a, size_t b)
+		{
+			if (less(heads[b], heads[a]))
+			{
+				return true;
+			}
+			if (less(heads[a], heads[b]))
+			{
+				return false;
+			}
+			return a > b;
+		};
+		std::priority_queue<size_t, std::vector<size_t>, decltype(later)> heap(later);
+
+		for (size_t i = 0; i < end - begin; i++)
+		{
+			readers.emplace_back(paths[begin + i], bufferSize);
+			heads.emplace_back(0, std::string());
+			if (readers[i].Next(heads[i]))
+			{
+				heap.push(i);
+			}
+		}
+
+		while (!heap.empty())
+		{
+			const size_t top = heap.top();
+			heap.pop();
+			write(heads[top]);
+			if (readers[top].Next(heads[top]))
+			{
+				heap.push(top);
+			}
+		}
+
+		return std::none_of(readers.begin(), readers.end(), [](const RunReader& reader) { return reader.Failed(); });
+	}
+
+	/// <summary>
+	/// 1行がメモリ上で占めるおおよそのバイト数（ノード本体と、短い文字列に収まらないIDの領域）
+	/// </summary>
+	inline size_t EstimateRowBytes(const std::string& id)
+	{
+		const size_t node = sizeof(PlayerScore) + sizeof(void*) * 4;
+		return node + (id.size() >= sizeof(std::string) ? id.size() + 1 : 0);
+	}
+}
+
+/// <summary>
+/// メモリに収まらない大きさのスコアファイルをソートしてScores.txtと同じ形式で書き出す
+/// メモリ上限まで読み込んだ行をLinkedList::Sortでソートしてランとして一時ファイルへ書き出し、
+/// 最後に全ランを先頭から少しずつ読みながらk-wayマージする（入出力はすべて先頭からの連続した読み書き）
+/// ランが多すぎて読み込みバッファの合計がメモリ上限を超える場合は、隣り合うランをまとめる中間のマージを先に行う
+/// 比較が等しい行は入力ファイル内の順番を保つ
+/// </summary>
+/// <param name="inputPath">入力ファイルのパス（Scores.txt形式、解析できない行は読み飛ばす）</param>
+/// <param name="outputPath">出力ファイルのパス</param>
+/// <param name="less">aをbより前に並べる場合にtrueを返す比較関数</param>
+/// <param name="options">メモリ上限などの設定（memoryBudgetはMinMemoryBudget以上に切り上げる）</param>
+/// <param name="stats">結果の格納先（不要ならnullptr）</param>
+/// <returns>入力ファイルを開けなかった、一時ファイルを読み戻せなかった、または書き込みに失敗した場合はfalse</returns>
+template <typename Less>
+bool ExternalSortScores(const std::string& inputPath, const std::string& outputPath, Less less,
+	const ExternalSortOptions& options = ExternalSortOptions(), ExternalSortStats* stats = nullptr)
+{
+	using namespace ExternalSortDetail;
+
+	const size_t memoryBudget = std::max(options.memoryBudget, ExternalSortOptions::MinMemoryBudget);
+	const std::string tempPrefix = (options.tempDirectory.empty() ? outputPath : options.tempDirectory + "/sort") + ".run";
+	// 作成した一時ファイルすべて（中間のマージで消したものも含む）
+	std::vector<std::string> tempPaths;
+	auto newTempPath = [&]()
+	{
+		tempPaths.push_back(tempPrefix + std::to_string(tempPaths.size()) + ".tmp");
+		return tempPaths.back();
+	};
+	auto removeRuns = [&tempPaths]()
+	{
+		for (const std::string& path : tempPaths)
+		{
+			std::remove(path.c_str());
+		}
+	};
+	// まだマージしていないラン（入力順）
+	std::vector<std::string> runPaths;
+
+	LinkedList<PlayerScore> run;
+	size_t runBytes = 0;
+	bool writeFailed = false;
+
+	// メモリ上のランをソートして一時ファイルへ書き出す
+	auto spill = [&]()
+	{
+		run.Sort(less);
+		runPaths.push_back(newTempPath());
+		RowFileWriter writer(runPaths.back(), ScoreFormat::Binary, options.ioBufferSize);
+		run.ForEach([&writer](const PlayerScore& playerScore) { writer.Write(playerScore); });
+		writeFailed = !writer.Close() || writeFailed;
+		run.Clean();
+		runBytes = 0;
+	};
+
+	// 書き出しに失敗したら、残りの入力は読まずにやめる
+	const bool opened = ReadScoreChunks(inputPath, [&](const char* data, size_t size, bool eof) -> std::optional<size_t>
+	{
+		const size_t consumed = ForEachScoreLine(data, size, eof, [&](int score, std::string_view id)
+		{
+			if (writeFailed)
+			{
+				return;
+			}
+			auto it = run.Insert(run.End(), PlayerScore(score, std::string(id)));
+			runBytes += EstimateRowBytes(it->id);
+			if (runBytes >= memoryBudget)
+			{
+				spill();
+			}
+		});
+		if (writeFailed)
+		{
+			return std::nullopt;
+		}
+		return consumed;
+	});
+	if (!opened || writeFailed)
+	{
+		removeRuns();
+		return false;
+	}
+
+	ExternalSortStats result;
+	RowFileWriter output(outputPath, ScoreFormat::Tsv, options.ioBufferSize);
+	if (!output.IsOpen())
+	{
+		removeRuns();
+		return false;
+	}
+
+	if (runPaths.empty())
+	{
+		// すべてメモリに収まった場合は一時ファイルを使わない
+		run.Sort(less);
+		run.ForEach([&output](const PlayerScore& playerScore) { output.Write(playerScore); });
+		result.rows = run.Count();
+	}
+	else
+	{
+		if (run.Any())
+		{
+			spill();
+		}
+		if (writeFailed)
+		{
+			removeRuns();
+			return false;
+		}
+
+		// 同時に読むランの読み込みバッファの合計がメモリ上限に収まるように、同時にマージするランの数を抑える
+		const size_t fanIn = std::max<size_t>(2, memoryBudget / ExternalSortOptions::MergeBufferSize);
+		const size_t readerBuffer = std::min(options.ioBufferSize, memoryBudget / std::min(fanIn, runPaths.size()));
+		result.runs = runPaths.size();
+
+		// 隣り合うfanIn個ずつのランを1つにまとめる（並び順を保つので、等しい行の順番も変わらない）
+		while (runPaths.size() > fanIn)
+		{
+			std::vector<std::string> merged;
+			for (size_t begin = 0; begin < runPaths.size(); begin += fanIn)
+			{
+				const size_t end = std::min(begin + fanIn, runPaths.size());
+				if (end - begin == 1)
+				{
+					merged.push_back(runPaths[begin]);
+					continue;
+				}
+
+				merged.push_back(newTempPath());
+				RowFileWriter writer(merged.back(), ScoreFormat::Binary, options.ioBufferSize);
+				const bool readOk = MergeRuns(runPaths, begin, end, readerBuffer, less,
+					[&writer](const PlayerScore& playerScore) { writer.Write(playerScore); });
+				if (!writer.Close() || !readOk)
+				{
+					output.Close();
+					removeRuns();
+					return false;
+				}
+				for (size_t i = begin; i < end; i++)
+				{
+					std::remove(runPaths[i].c_str());
+				}
+			}
+			runPaths.swap(merged);
+			result.mergePasses++;
+		}
+
+		const bool readOk = MergeRuns(runPaths, 0, runPaths.size(), readerBuffer, less, [&](const PlayerScore& playerScore)
+		{
+			output.Write(playerScore);
+			result.rows++;
+		});
+		removeRuns();
+		if (!readOk)
+		{
+			// 途中で読めなくなったランがあれば、出力は一部の行が欠けている
+			output.Close();
+			return false;
+		}
+	}
+
+	if (!output.Close())
+	{
+		return false;
+	}
+	if (stats)
+	{
+		*stats = result;
+	}
+	return true;
+}
+
+/// <summary>
+/// スコアの高い順（同点は入力順）に外部ソート
+/// </summary>
+inline bool ExternalSortScores(const std::string& inputPath, const std::string& outputPath,
+	const ExternalSortOptions& options = ExternalSortOptions(), ExternalSortStats* stats = nullptr)
+{
+	return ExternalSortScores(inputPath, outputPath,
+		[](const PlayerScore& a, const PlayerScore& b) { return a.score > b.score; }, options, stats);
+}
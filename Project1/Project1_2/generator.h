@@ -0,0 +1,199 @@
+#pragma once
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <utility>
+
+/// <summary>
+/// co_yieldで値を1つずつ返すコルーチンの戻り値型
+/// 値は要求されるたびに生成され、走査を途中でやめるとコルーチンは残りを実行せずに破棄される
+/// 取得した参照は次に進めるまでの間だけ有効
+/// </summary>
+/// <typeparam name="T">生成する値の型</typeparam>
+template <typename T>
+class Generator
+{
+public:
+	/// <summary>
+	/// コルーチンの状態
+	/// </summary>
+	class promise_type
+	{
+	private:
+		const T* mValue = nullptr;
+		std::exception_ptr mError;
+		friend class Generator<T>;
+
+	public:
+		Generator get_return_object()
+		{
+			return Generator(std::coroutine_handle<promise_type>::from_promise(*this));
+		}
+
+		// 最初の値が要求されるまで何もしない
+		std::suspend_always initial_suspend() noexcept
+		{
+			return {};
+		}
+
+		std::suspend_always final_suspend() noexcept
+		{
+			return {};
+		}
+
+		// co_yieldした値はコルーチンが再開されるまで生きているので、コピーせずに指すだけでよい
+		std::suspend_always yield_value(const T& value) noexcept
+		{
+			mValue = std::addressof(value);
+			return {};
+		}
+
+		void return_void() noexcept
+		{
+		}
+
+		void unhandled_exception()
+		{
+			mError = std::current_exception();
+		}
+
+		// 生成中にco_awaitすることはできない
+		template <typename U>
+		std::suspend_never await_transform(U&&) = delete;
+	};
+
+	/// <summary>
+	/// 生成された値を順に返す入力イテレータ
+	/// </summary>
+	class Iterator
+	{
+	private:
+		std::coroutine_handle<promise_type> mHandle;
+		friend class Generator<T>;
+
+		explicit Iterator(std::coroutine_handle<promise_type> handle) : mHandle(handle)
+		{
+		}
+
+	public:
+		using iterator_category = std::input_iterator_tag;
+		using value_type = T;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const T*;
+		using reference = const T&;
+
+		Iterator() = default;
+
+		/// <summary>
+		/// 現在の値を取得
+		/// </summary>
+		const T& operator*() const
+		{
+			return *mHandle.promise().mValue;
+		}
+
+		/// <summary>
+		/// アロー演算子
+		/// </summary>
+		const T* operator->() const
+		{
+			return mHandle.promise().mValue;
+		}
+
+		/// <summary>
+		/// 次の値を生成する
+		/// </summary>
+		Iterator& operator++()
+		{
+			Generator::Advance(mHandle);
+			return *this;
+		}
+
+		/// <summary>
+		/// 次の値を生成する（後置、入力イテレータなので元の位置は返さない）
+		/// </summary>
+		void operator++(int)
+		{
+			++*this;
+		}
+
+		/// <summary>
+		/// すべての値を生成し終えたかチェック
+		/// </summary>
+		bool operator==(std::default_sentinel_t) const
+		{
+			return !mHandle || mHandle.done();
+		}
+	};
+
+	Generator(Generator&& other) noexcept : mHandle(std::exchange(other.mHandle, nullptr))
+	{
+	}
+
+	Generator& operator=(Generator&& other) noexcept
+	{
+		if (this != &other)
+		{
+			if (mHandle)
+			{
+				mHandle.destroy();
+			}
+			mHandle = std::exchange(other.mHandle, nullptr);
+		}
+		return *this;
+	}
+
+	Generator(const Generator&) = delete;
+	Generator& operator=(const Generator&) = delete;
+
+	~Generator()
+	{
+		if (mHandle)
+		{
+			mHandle.destroy();
+		}
+	}
+
+	/// <summary>
+	/// 最初の値を生成して先頭イテレータを取得（範囲for文用、1回だけ呼べる）
+	/// </summary>
+	Iterator begin()
+	{
+		Advance(mHandle);
+		return Iterator(mHandle);
+	}
+
+	/// <summary>
+	/// 終端を表す番兵を取得（範囲for文用）
+	/// </summary>
+	std::default_sentinel_t end() const noexcept
+	{
+		return std::default_sentinel;
+	}
+
+private:
+	std::coroutine_handle<promise_type> mHandle;
+
+	explicit Generator(std::coroutine_handle<promise_type> handle) : mHandle(handle)
+	{
+	}
+
+	/// <summary>
+	/// コルーチンを次のco_yieldまで進め、コルーチン内で発生した例外は呼び出し元へ投げ直す
+	/// </summary>
+	static void Advance(std::coroutine_handle<promise_type> handle)
+	{
+		if (!handle || handle.done())
+		{
+			return;
+		}
+
+		handle.resume();
+		if (handle.promise().mError)
+		{
+			std::rethrow_exception(std::exchange(handle.promise().mError, nullptr));
+		}
+	}
+};
@@ -0,0 +1,508 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include "errorPolicy.h"
+
+/// <summary>
+/// 最大N個の要素を内部の配列に格納する固定容量の双方向リスト
+/// ノードは配列の添字で繋がれ、空きノードは配列内の空きリストで管理するため、アロケータを一切呼ばない
+/// スタック上に置くことができ、Tがリテラル型であればconstexprな文脈でも使える
+/// インターフェースはLinkedListと同じだが、満杯のときのInsertは誤った使い方として通知する（挿入前にFull()で確かめる）
+/// </summary>
+/// <typeparam name="T">リストに格納する要素の型</typeparam>
+/// <typeparam name="N">最大要素数</typeparam>
+template <typename T, size_t N>
+class InplaceLinkedList
+{
+private:
+	static_assert(N > 0, "N must be greater than 0");
+	// Nそのものを無効な添字として使うため、添字型で表せる最大値より小さくなければならない
+	static_assert(N < std::numeric_limits<uint32_t>::max(), "N must be less than the maximum value of uint32_t");
+
+	// 要素数に応じて最小の添字型を選ぶ（Nは無効な添字として使う）
+	using Index = std::conditional_t<(N < 0xFFFF), uint16_t, uint32_t>;
+	static constexpr Index Npos = static_cast<Index>(N);
+
+	// ノード構造体（dataは使用中のノードでのみ構築されている）
+	struct Slot
+	{
+		union
+		{
+			T data;
+		};
+		Index prev;
+		Index next;
+
+		constexpr Slot() : prev(Npos), next(Npos)
+		{
+		}
+
+		constexpr ~Slot()
+		{
+		}
+	};
+
+	Slot mSlots[N];
+	Index mHead;
+	Index mTail;
+	// 空きノードの先頭（空きノードはnextで繋がる）
+	Index mFree;
+	size_t mCount;
+
+public:
+	// コンストイテレータクラスの前方宣言
+	class ConstIterator;
+
+	/// <summary>
+	/// イテレータクラス
+	/// </summary>
+	class Iterator
+	{
+	private:
+		InplaceLinkedList* mList;
+		Index mIndex;
+		friend class InplaceLinkedList<T, N>;
+		friend class ConstIterator;
+
+		constexpr Iterator(InplaceLinkedList* list, Index index) : mList(list), mIndex(index)
+		{
+		}
+
+	public:
+		using iterator_category = std::bidirectional_iterator_tag;
+		using value_type = T;
+		using difference_type = std::ptrdiff_t;
+		using pointer = T*;
+		using reference = T&;
+
+		constexpr Iterator() : mList(nullptr), mIndex(Npos)
+		{
+		}
+
+		/// <summary>
+		/// イテレータの指す要素を取得（非const版）
+		/// </summary>
+		constexpr T& operator*()
+		{
+			if (!mList || mIndex == Npos)
+			{
+				ReportMisuse("Invalid iterator");
+			}
+			return mList->mSlots[mIndex].data;
+		}
+
+		/// <summary>
+		/// アロー演算子
+		/// </summary>
+		constexpr T* operator->()
+		{
+			return &**this;
+		}
+
+		/// <summary>
+		/// 前置インクリメント
+		/// </summary>
+		constexpr Iterator& operator++()
+		{
+			if (!mList || mIndex == Npos)
+			{
+				ReportMisuse("Invalid iterator");
+			}
+			mIndex = mList->mSlots[mIndex].next;
+			return *this;
+		}
+
+		/// <summary>
+		/// 後置インクリメント
+		/// </summary>
+		constexpr Iterator operator++(int)
+		{
+			Iterator temp = *this;
+			++*this;
+			return temp;
+		}
+
+		/// <summary>
+		/// 前置デクリメント
+		/// </summary>
+		constexpr Iterator& operator--()
+		{
+			if (!mList || mIndex == Npos)
+			{
+				ReportMisuse("Invalid iterator");
+			}
+			mIndex = mList->mSlots[mIndex].prev;
+			return *this;
+		}
+
+		/// <summary>
+		/// 後置デクリメント
+		/// </summary>
+		constexpr Iterator operator--(int)
+		{
+			Iterator temp = *this;
+			--*this;
+			return temp;
+		}
+
+		/// <summary>
+		/// 等価比較
+		/// </summary>
+		constexpr bool operator==(const Iterator& other) const
+		{
+			return mIndex == other.mIndex;
+		}
+
+		/// <summary>
+		/// 非等価比較
+		/// </summary>
+		constexpr bool operator!=(const Iterator& other) const
+		{
+			return mIndex != other.mIndex;
+		}
+	};
+
+	/// <summary>
+	/// コンストイテレータクラス
+	/// </summary>
+	class ConstIterator
+	{
+	private:
+		const InplaceLinkedList* mList;
+		Index mIndex;
+		friend class InplaceLinkedList<T, N>;
+
+		constexpr ConstIterator(const InplaceLinkedList* list, Index index) : mList(list), mIndex(index)
+		{
+		}
+
+	public:
+		using iterator_category = std::bidirectional_iterator_tag;
+		using value_type = T;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const T*;
+		using reference = const T&;
+
+		constexpr ConstIterator() : mList(nullptr), mIndex(Npos)
+		{
+		}
+
+		/// <summary>
+		/// イテレータの指す要素を取得（const版）
+		/// </summary>
+		constexpr const T& operator*() const
+		{
+			if (!mList || mIndex == Npos)
+			{
+				ReportMisuse("Invalid iterator");
+			}
+			return mList->mSlots[mIndex].data;
+		}
+
+		/// <summary>
+		/// アロー演算子（const版）
+		/// </summary>
+		constexpr const T* operator->() const
+		{
+			return &**this;
+		}
+
+		/// <summary>
+		/// 前置インクリメント
+		/// </summary>
+		constexpr ConstIterator& operator++()
+		{
+			if (!mList || mIndex == Npos)
+			{
+				ReportMisuse("Invalid iterator");
+			}
+			mIndex = mList->mSlots[mIndex].next;
+			return *this;
+		}
+
+		/// <summary>
+		/// 後置インクリメント
+		/// </summary>
+		constexpr ConstIterator operator++(int)
+		{
+			ConstIterator temp = *this;
+			++*this;
+			return temp;
+		}
+
+		/// <summary>
+		/// 前置デクリメント
+		/// </summary>
+		constexpr ConstIterator& operator--()
+		{
+			if (!mList || mIndex == Npos)
+			{
+				ReportMisuse("Invalid iterator");
+			}
+			mIndex = mList->mSlots[mIndex].prev;
+			return *this;
+		}
+
+		/// <summary>
+		/// 後置デクリメント
+		/// </summary>
+		constexpr ConstIterator operator--(int)
+		{
+			ConstIterator temp = *this;
+			--*this;
+			return temp;
+		}
+
+		/// <summary>
+		/// 等価比較
+		/// </summary>
+		constexpr bool operator==(const ConstIterator& other) const
+		{
+			return mIndex == other.mIndex;
+		}
+
+		/// <summary>
+		/// 非等価比較
+		/// </summary>
+		constexpr bool operator!=(const ConstIterator& other) const
+		{
+			return mIndex != other.mIndex;
+		}
+	};
+
+	constexpr InplaceLinkedList() : mHead(Npos), mTail(Npos), mFree(0), mCount(0)
+	{
+		ResetFreeList();
+	}
+
+	/// <summary>
+	/// コピーコンストラクタ（要素を順に複製する）
+	/// </summary>
+	constexpr InplaceLinkedList(const InplaceLinkedList& other) : InplaceLinkedList()
+	{
+		for (auto it = other.CBegin(); it != other.CEnd(); ++it)
+		{
+			Insert(End(), *it);
+		}
+	}
+
+	constexpr ~InplaceLinkedList()
+	{
+		Clean();
+	}
+
+	/// <summary>
+	/// コピー代入演算子
+	/// </summary>
+	constexpr InplaceLinkedList& operator=(const InplaceLinkedList& other)
+	{
+		if (this != &other)
+		{
+			Clean();
+			for (auto it = other.CBegin(); it != other.CEnd(); ++it)
+			{
+				Insert(End(), *it);
+			}
+		}
+		return *this;
+	}
+
+	/// <summary>
+	/// イテレータが指す位置の要素を削除
+	/// </summary>
+	/// <param name="it">削除する要素を指すイテレータ</param>
+	/// <returns>削除された要素の次を指すイテレータ</returns>
+	constexpr Iterator Remove(Iterator it)
+	{
+		if (it.mIndex == Npos)
+		{
+			return End();
+		}
+
+		const Index index = it.mIndex;
+		Slot& slot = mSlots[index];
+		const Index next = slot.next;
+
+		// 前後のノードを繋ぎ直す
+		if (slot.prev != Npos)
+		{
+			mSlots[slot.prev].next = slot.next;
+		}
+		else
+		{
+			mHead = slot.next;
+		}
+
+		if (slot.next != Npos)
+		{
+			mSlots[slot.next].prev = slot.prev;
+		}
+		else
+		{
+			mTail = slot.prev;
+		}
+
+		// 空きリストに戻す
+		std::destroy_at(&slot.data);
+		slot.prev = Npos;
+		slot.next = mFree;
+		mFree = index;
+		mCount--;
+
+		return Iterator(this, next);
+	}
+
+	/// <summary>
+	/// イテレータが指す位置の前に要素を挿入
+	/// </summary>
+	/// <param name="it">挿入位置を指すイテレータ</param>
+	/// <param name="value">挿入する値</param>
+	/// <returns>挿入された要素を指すイテレータ（満杯の場合は挿入せず、誤った使い方として通知する）</returns>
+	constexpr Iterator Insert(Iterator it, const T& value)
+	{
+		if (mFree == Npos)
+		{
+			ReportMisuse("List is full");
+		}
+
+		// 構築に成功してから空きリストから外す（コピーが例外を送出しても空きノードを失わない）
+		const Index index = mFree;
+		Slot& slot = mSlots[index];
+		std::construct_at(&slot.data, value);
+		mFree = slot.next;
+
+		if (it.mIndex == Npos)
+		{
+			// 末尾への挿入、またはリストが空の場合
+			slot.prev = mTail;
+			slot.next = Npos;
+			if (mTail != Npos)
+			{
+				mSlots[mTail].next = index;
+			}
+			else
+			{
+				mHead = index;
+			}
+			mTail = index;
+		}
+		else
+		{
+			Slot& current = mSlots[it.mIndex];
+			slot.prev = current.prev;
+			slot.next = it.mIndex;
+			if (current.prev != Npos)
+			{
+				mSlots[current.prev].next = index;
+			}
+			else
+			{
+				// 先頭への挿入
+				mHead = index;
+			}
+			current.prev = index;
+		}
+
+		mCount++;
+		return Iterator(this, index);
+	}
+
+	/// <summary>
+	/// 先頭イテレータ取得
+	/// </summary>
+	constexpr Iterator Begin()
+	{
+		return Iterator(this, mHead);
+	}
+
+	/// <summary>
+	/// 末尾の次を指すイテレータ取得
+	/// </summary>
+	constexpr Iterator End()
+	{
+		return Iterator(this, Npos);
+	}
+
+	/// <summary>
+	/// 先頭コンストイテレータ取得
+	/// </summary>
+	constexpr ConstIterator CBegin() const
+	{
+		return ConstIterator(this, mHead);
+	}
+
+	/// <summary>
+	/// 末尾の次を指すコンストイテレータ取得
+	/// </summary>
+	constexpr ConstIterator CEnd() const
+	{
+		return ConstIterator(this, Npos);
+	}
+
+	/// <summary>
+	/// リスト内の要素数を取得
+	/// </summary>
+	constexpr size_t Count() const
+	{
+		return mCount;
+	}
+
+	/// <summary>
+	/// リストに要素が存在するかチェック
+	/// </summary>
+	constexpr bool Any() const
+	{
+		return mCount != 0;
+	}
+
+	/// <summary>
+	/// これ以上挿入できないかチェック
+	/// </summary>
+	constexpr bool Full() const
+	{
+		return mFree == Npos;
+	}
+
+	/// <summary>
+	/// 最大要素数を取得
+	/// </summary>
+	static constexpr size_t Capacity()
+	{
+		return N;
+	}
+
+	/// <summary>
+	/// リストのすべての要素を削除
+	/// </summary>
+	constexpr void Clean()
+	{
+		for (Index index = mHead; index != Npos; index = mSlots[index].next)
+		{
+			std::destroy_at(&mSlots[index].data);
+		}
+		mHead = Npos;
+		mTail = Npos;
+		mCount = 0;
+		ResetFreeList();
+	}
+
+private:
+	/// <summary>
+	/// 全ノードを空きリストに繋ぐ
+	/// </summary>
+	constexpr void ResetFreeList()
+	{
+		for (size_t i = 0; i < N; i++)
+		{
+			mSlots[i].prev = Npos;
+			mSlots[i].next = static_cast<Index>(i + 1);
+		}
+		mFree = 0;
+	}
+};
@@ -0,0 +1,485 @@
+#pragma once
+#include <cstddef>
+#include <iterator>
+
+#include "errorPolicy.h"
+
+/// <summary>
+/// 要素に埋め込んでIntrusiveListに繋ぐためのフック
+/// 1つのフックは同時に1つのリストにしか繋げないが、要素に複数のフックを持たせれば複数のリストに同時に繋げられる
+/// 要素をコピーしてもフックはコピーされず、新しい要素はどのリストにも繋がっていない状態になる
+/// </summary>
+/// <typeparam name="T">フックを埋め込む要素の型</typeparam>
+template <typename T>
+class ListHook
+{
+private:
+	T* mPrev = nullptr;
+	T* mNext = nullptr;
+	// 繋がっているリスト（繋がっていなければnullptr）
+	const void* mList = nullptr;
+
+	template <typename U, ListHook<U> U::* Hook>
+	friend class IntrusiveList;
+
+public:
+	ListHook() = default;
+
+	ListHook(const ListHook&)
+	{
+	}
+
+	ListHook& operator=(const ListHook&)
+	{
+		// 繋がっている状態はコピー元に関係なく維持する
+		return *this;
+	}
+
+	/// <summary>
+	/// いずれかのリストに繋がっているかチェック
+	/// </summary>
+	bool IsLinked() const
+	{
+		return mList != nullptr;
+	}
+};
+
+/// <summary>
+/// 要素に埋め込まれたフックで既存のオブジェクトを繋ぐ双方向リスト
+/// ノードの確保も要素のコピーも行わず、要素の寿命は呼び出し側が管理する
+/// 繋がっている要素を破棄する前には、必ずリストから取り除くこと
+/// </summary>
+/// <typeparam name="T">リストに繋ぐ要素の型</typeparam>
+/// <typeparam name="Hook">リストに使うフックのメンバポインタ</typeparam>
+template <typename T, ListHook<T> T::* Hook>
+class IntrusiveList
+{
+private:
+	T* mHead;
+	T* mTail;
+	size_t mCount;
+
+	static ListHook<T>& HookOf(T* element)
+	{
+		return element->*Hook;
+	}
+
+	static const ListHook<T>& HookOf(const T* element)
+	{
+		return element->*Hook;
+	}
+
+public:
+	// コンストイテレータクラスの前方宣言
+	class ConstIterator;
+
+	/// <summary>
+	/// イテレータクラス
+	/// </summary>
+	class Iterator
+	{
+	private:
+		T* mElement;
+		friend class IntrusiveList<T, Hook>;
+		friend class ConstIterator;
+
+		Iterator(T* element) : mElement(element)
+		{
+		}
+
+	public:
+		using iterator_category = std::bidirectional_iterator_tag;
+		using value_type = T;
+		using difference_type = std::ptrdiff_t;
+		using pointer = T*;
+		using reference = T&;
+
+		Iterator() : mElement(nullptr)
+		{
+		}
+
+		/// <summary>
+		/// イテレータの指す要素を取得（非const版）
+		/// </summary>
+		T& operator*()
+		{
+			if (!mElement)
+			{
+				ReportMisuse("Invalid iterator");
+			}
+			return *mElement;
+		}
+
+		/// <summary>
+		/// アロー演算子
+		/// </summary>
+		T* operator->()
+		{
+			return &**this;
+		}
+
+		/// <summary>
+		/// 前置インクリメント
+		/// </summary>
+		Iterator& operator++()
+		{
+			if (!mElement)
+			{
+				ReportMisuse("Invalid iterator");
+			}
+			mElement = HookOf(mElement).mNext;
+			return *this;
+		}
+
+		/// <summary>
+		/// 後置インクリメント
+		/// </summary>
+		Iterator operator++(int)
+		{
+			Iterator temp = *this;
+			++*this;
+			return temp;
+		}
+
+		/// <summary>
+		/// 前置デクリメント
+		/// </summary>
+		Iterator& operator--()
+		{
+			if (!mElement)
+			{
+				ReportMisuse("Invalid iterator");
+			}
+			mElement = HookOf(mElement).mPrev;
+			return *this;
+		}
+
+		/// <summary>
+		/// 後置デクリメント
+		/// </summary>
+		Iterator operator--(int)
+		{
+			Iterator temp = *this;
+			--*this;
+			return temp;
+		}
+
+		/// <summary>
+		/// 等価比較
+		/// </summary>
+		bool operator==(const Iterator& other) const
+		{
+			return mElement == other.mElement;
+		}
+
+		/// <summary>
+		/// 非等価比較
+		/// </summary>
+		bool operator!=(const Iterator& other) const
+		{
+			return mElement != other.mElement;
+		}
+	};
+
+	/// <summary>
+	/// コンストイテレータクラス
+	/// </summary>
+	class ConstIterator
+	{
+	private:
+		const T* mElement;
+		friend class IntrusiveList<T, Hook>;
+
+		ConstIterator(const T* element) : mElement(element)
+		{
+		}
+
+	public:
+		using iterator_category = std::bidirectional_iterator_tag;
+		using value_type = T;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const T*;
+		using reference = const T&;
+
+		ConstIterator() : mElement(nullptr)
+		{
+		}
+
+		/// <summary>
+		/// イテレータの指す要素を取得（const版）
+		/// </summary>
+		const T& operator*() const
+		{
+			if (!mElement)
+			{
+				ReportMisuse("Invalid iterator");
+			}
+			return *mElement;
+		}
+
+		/// <summary>
+		/// アロー演算子（const版）
+		/// </summary>
+		const T* operator->() const
+		{
+			return &**this;
+		}
+
+		/// <summary>
+		/// 前置インクリメント
+		/// </summary>
+		ConstIterator& operator++()
+		{
+			if (!mElement)
+			{
+				ReportMisuse("Invalid iterator");
+			}
+			mElement = HookOf(mElement).mNext;
+			return *this;
+		}
+
+		/// <summary>
+		/// 後置インクリメント
+		/// </summary>
+		ConstIterator operator++(int)
+		{
+			ConstIterator temp = *this;
+			++*this;
+			return temp;
+		}
+
+		/// <summary>
+		/// 前置デクリメント
+		/// </summary>
+		ConstIterator& operator--()
+		{
+			if (!mElement)
+			{
+				ReportMisuse("Invalid iterator");
+			}
+			mElement = HookOf(mElement).mPrev;
+			return *this;
+		}
+
+		/// <summary>
+		/// 後置デクリメント
+		/// </summary>
+		ConstIterator operator--(int)
+		{
+			ConstIterator temp = *this;
+			--*this;
+			return temp;
+		}
+
+		/// <summary>
+		/// 等価比較
+		/// </summary>
+		bool operator==(const ConstIterator& other) const
+		{
+			return mElement == other.mElement;
+		}
+
+		/// <summary>
+		/// 非等価比較
+		/// </summary>
+		bool operator!=(const ConstIterator& other) const
+		{
+			return mElement != other.mElement;
+		}
+	};
+
+	IntrusiveList() : mHead(nullptr), mTail(nullptr), mCount(0)
+	{
+	}
+
+	// 要素の所有権を持たないため、コピーは許可しない
+	IntrusiveList(const IntrusiveList&) = delete;
+	IntrusiveList& operator=(const IntrusiveList&) = delete;
+
+	/// <summary>
+	/// 繋がっている要素をすべて切り離す（要素自体は破棄しない）
+	/// </summary>
+	~IntrusiveList()
+	{
+		Clean();
+	}
+
+	/// <summary>
+	/// イテレータが指す要素をリストから切り離す（要素自体は破棄しない）
+	/// </summary>
+	/// <param name="it">切り離す要素を指すイテレータ</param>
+	/// <returns>切り離された要素の次を指すイテレータ</returns>
+	Iterator Remove(Iterator it)
+	{
+		if (!it.mElement)
+		{
+			return End();
+		}
+
+		ListHook<T>& hook = HookOf(it.mElement);
+		if (hook.mList != this)
+		{
+			ReportMisuse("Element is not linked to this list");
+		}
+
+		T* next = hook.mNext;
+
+		// 前後の要素を繋ぎ直す
+		if (hook.mPrev)
+		{
+			HookOf(hook.mPrev).mNext = hook.mNext;
+		}
+		else
+		{
+			mHead = hook.mNext;
+		}
+
+		if (hook.mNext)
+		{
+			HookOf(hook.mNext).mPrev = hook.mPrev;
+		}
+		else
+		{
+			mTail = hook.mPrev;
+		}
+
+		hook.mPrev = nullptr;
+		hook.mNext = nullptr;
+		hook.mList = nullptr;
+		mCount--;
+
+		return Iterator(next);
+	}
+
+	/// <summary>
+	/// イテレータが指す位置の前に要素を繋ぐ
+	/// </summary>
+	/// <param name="it">挿入位置を指すイテレータ</param>
+	/// <param name="element">繋ぐ要素（このフックで他のリストに繋がっていないこと）</param>
+	/// <returns>繋いだ要素を指すイテレータ</returns>
+	Iterator Insert(Iterator it, T& element)
+	{
+		ListHook<T>& hook = HookOf(&element);
+		if (hook.mList)
+		{
+			ReportMisuse("Element is already linked");
+		}
+		hook.mList = this;
+
+		if (!it.mElement)
+		{
+			// 末尾への挿入、またはリストが空の場合
+			hook.mPrev = mTail;
+			hook.mNext = nullptr;
+			if (mTail)
+			{
+				HookOf(mTail).mNext = &element;
+			}
+			else
+			{
+				mHead = &element;
+			}
+			mTail = &element;
+		}
+		else
+		{
+			ListHook<T>& current = HookOf(it.mElement);
+			hook.mPrev = current.mPrev;
+			hook.mNext = it.mElement;
+			if (current.mPrev)
+			{
+				HookOf(current.mPrev).mNext = &element;
+			}
+			else
+			{
+				// 先頭への挿入
+				mHead = &element;
+			}
+			current.mPrev = &element;
+		}
+
+		mCount++;
+		return Iterator(&element);
+	}
+
+	/// <summary>
+	/// このリストに繋がっている要素を指すイテレータを取得
+	/// </summary>
+	/// <param name="element">このリストに繋がっている要素</param>
+	/// <returns>要素を指すイテレータ</returns>
+	Iterator IteratorTo(T& element)
+	{
+		if (HookOf(&element).mList != this)
+		{
+			ReportMisuse("Element is not linked to this list");
+		}
+		return Iterator(&element);
+	}
+
+	/// <summary>
+	/// 先頭イテレータ取得
+	/// </summary>
+	Iterator Begin()
+	{
+		return Iterator(mHead);
+	}
+
+	/// <summary>
+	/// 末尾の次を指すイテレータ取得
+	/// </summary>
+	Iterator End()
+	{
+		return Iterator(nullptr);
+	}
+
+	/// <summary>
+	/// 先頭コンストイテレータ取得
+	/// </summary>
+	ConstIterator CBegin() const
+	{
+		return ConstIterator(mHead);
+	}
+
+	/// <summary>
+	/// 末尾の次を指すコンストイテレータ取得
+	/// </summary>
+	ConstIterator CEnd() const
+	{
+		return ConstIterator(nullptr);
+	}
+
+	/// <summary>
+	/// リスト内の要素数を取得
+	/// </summary>
+	size_t Count() const
+	{
+		return mCount;
+	}
+
+	/// <summary>
+	/// リストに要素が存在するかチェック
+	/// </summary>
+	bool Any() const
+	{
+		return mCount != 0;
+	}
+
+	/// <summary>
+	/// リストのすべての要素を切り離す（要素自体は破棄しない）
+	/// </summary>
+	void Clean()
+	{
+		T* current = mHead;
+		while (current)
+		{
+			ListHook<T>& hook = HookOf(current);
+			current = hook.mNext;
+			hook.mPrev = nullptr;
+			hook.mNext = nullptr;
+			hook.mList = nullptr;
+		}
+		mHead = nullptr;
+		mTail = nullptr;
+		mCount = 0;
+	}
+};
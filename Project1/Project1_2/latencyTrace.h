@@ -0,0 +1,355 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <ostream>
+#include <string>
+
+/// <summary>
+/// 処理時間を計測する操作の種類
+/// </summary>
+enum class TraceOp
+{
+	Insert,
+	InsertBulk,
+	Remove,
+	Clean,
+	ForEach,
+	Sort,
+	LoadScores,
+	// 操作の種類の数（操作としては使わない）
+	Count,
+};
+
+/// <summary>
+/// 操作の種類の表示名を取得
+/// </summary>
+inline const char* TraceOpName(TraceOp op)
+{
+	switch (op)
+	{
+	case TraceOp::Insert:
+		return "Insert";
+	case TraceOp::InsertBulk:
+		return "InsertBulk";
+	case TraceOp::Remove:
+		return "Remove";
+	case TraceOp::Clean:
+		return "Clean";
+	case TraceOp::ForEach:
+		return "ForEach";
+	case TraceOp::Sort:
+		return "Sort";
+	case TraceOp::LoadScores:
+		return "LoadScores";
+	default:
+		return "Unknown";
+	}
+}
+
+/// <summary>
+/// ナノ秒単位の処理時間を記録するHDR形式のヒストグラム
+/// 2のべき乗ごとの区間をさらにSubBuckets個に等分するため、記録値の相対誤差は約3%以内に収まる
+/// 記録はアトミックな加算だけで行い、ロックを取らないので複数スレッドから同時に呼べる
+/// </summary>
+class LatencyHistogram
+{
+public:
+	// 2のべき乗の区間1つあたりのバケット数
+	static constexpr uint32_t SubBucketBits = 5;
+	static constexpr uint32_t SubBuckets = 1u << SubBucketBits;
+	// 記録できる最大値のビット数（これを超える値は最大のバケットに入れる、約18分）
+	static constexpr uint32_t MaxValueBits = 40;
+	static constexpr uint32_t BucketCount = (MaxValueBits - SubBucketBits + 1) * SubBuckets;
+
+	LatencyHistogram()
+	{
+		Reset();
+	}
+
+	LatencyHistogram(const LatencyHistogram&) = delete;
+	LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+	/// <summary>
+	/// 値を1つ記録
+	/// </summary>
+	/// <param name="nanoseconds">処理時間（ナノ秒）</param>
+	void Record(uint64_t nanoseconds)
+	{
+		mBuckets[BucketIndex(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+		mCount.fetch_add(1, std::memory_order_relaxed);
+		mSum.fetch_add(nanoseconds, std::memory_order_relaxed);
+
+		uint64_t max = mMax.load(std::memory_order_relaxed);
+		while (nanoseconds > max && !mMax.compare_exchange_weak(max, nanoseconds, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	/// <summary>
+	/// 記録した値の数を取得
+	/// </summary>
+	uint64_t Count() const
+	{
+		return mCount.load(std::memory_order_relaxed);
+	}
+
+	/// <summary>
+	/// 記録した値の最大値を取得
+	/// </summary>
+	uint64_t Max() const
+	{
+		return mMax.load(std::memory_order_relaxed);
+	}
+
+	/// <summary>
+	/// 記録した値の平均を取得
+	/// </summary>
+	double Mean() const
+	{
+		const uint64_t count = Count();
+		return count ? static_cast<double>(mSum.load(std::memory_order_relaxed)) / static_cast<double>(count) : 0.0;
+	}
+
+	/// <summary>
+	/// 記録した値のパーセンタイルを取得
+	/// </summary>
+	/// <param name="percentile">0から100までのパーセンタイル</param>
+	/// <returns>該当する値が入っているバケットの上端（記録が無ければ0）</returns>
+	uint64_t Percentile(double percentile) const
+	{
+		const uint64_t count = Count();
+		if (count == 0)
+		{
+			return 0;
+		}
+
+		// 値の小さい方から数えて rank 番目の値が入っているバケットを探す
+		const double clamped = std::clamp(percentile, 0.0, 100.0);
+		const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(clamped / 100.0 * static_cast<double>(count) + 0.5));
+		uint64_t seen = 0;
+		for (uint32_t i = 0; i < BucketCount; i++)
+		{
+			seen += mBuckets[i].load(std::memory_order_relaxed);
+			if (seen >= rank)
+			{
+				return std::min(BucketUpperBound(i), Max());
+			}
+		}
+		return Max();
+	}
+
+	/// <summary>
+	/// 記録をすべて消す（記録中のスレッドと同時に呼んだ場合、その記録は残る場合がある）
+	/// </summary>
+	void Reset()
+	{
+		for (auto& bucket : mBuckets)
+		{
+			bucket.store(0, std::memory_order_relaxed);
+		}
+		mCount.store(0, std::memory_order_relaxed);
+		mSum.store(0, std::memory_order_relaxed);
+		mMax.store(0, std::memory_order_relaxed);
+	}
+
+	/// <summary>
+	/// 値が入るバケットの番号を求める
+	/// </summary>
+	static uint32_t BucketIndex(uint64_t value)
+	{
+		if (value < SubBuckets)
+		{
+			return static_cast<uint32_t>(value);
+		}
+
+		const uint32_t exponent = static_cast<uint32_t>(std::bit_width(value)) - 1;
+		if (exponent >= MaxValueBits)
+		{
+			return BucketCount - 1;
+		}
+
+		const uint32_t sub = static_cast<uint32_t>(value >> (exponent - SubBucketBits)) & (SubBuckets - 1);
+		return (exponent - SubBucketBits + 1) * SubBuckets + sub;
+	}
+
+	/// <summary>
+	/// バケットに入る値の上端を求める
+	/// </summary>
+	static uint64_t BucketUpperBound(uint32_t index)
+	{
+		if (index < SubBuckets)
+		{
+			return index;
+		}
+
+		const uint32_t exponent = index / SubBuckets + SubBucketBits - 1;
+		const uint64_t sub = index % SubBuckets;
+		const uint64_t width = static_cast<uint64_t>(1) << (exponent - SubBucketBits);
+		return ((SubBuckets + sub) << (exponent - SubBucketBits)) + width - 1;
+	}
+
+private:
+	std::atomic<uint64_t> mBuckets[BucketCount];
+	std::atomic<uint64_t> mCount;
+	std::atomic<uint64_t> mSum;
+	std::atomic<uint64_t> mMax;
+};
+
+/// <summary>
+/// 操作ごとの処理時間のヒストグラムをまとめて持つクラス
+/// 既定ではすべての呼び出しを記録し、SetSampleRate(n)でn回に1回だけ記録して計測の負荷を抑えられる
+/// LinkedListなどの計測点はLINKEDLIST_TRACINGを定義してビルドした場合にだけ有効になる
+/// </summary>
+class LatencyTracer
+{
+public:
+	/// <summary>
+	/// 計測点が記録する共有のインスタンスを取得
+	/// </summary>
+	static LatencyTracer& Instance()
+	{
+		static LatencyTracer instance;
+		return instance;
+	}
+
+	/// <summary>
+	/// 何回に1回記録するかを設定（0は記録しない、1はすべて記録する）
+	/// </summary>
+	void SetSampleRate(uint32_t rate)
+	{
+		mSampleRate.store(rate, std::memory_order_relaxed);
+	}
+
+	/// <summary>
+	/// 今回の呼び出しを記録するかどうかを決める（スレッドごとの呼び出し回数で間引く）
+	/// </summary>
+	bool ShouldSample()
+	{
+		const uint32_t rate = mSampleRate.load(std::memory_order_relaxed);
+		if (rate <= 1)
+		{
+			return rate == 1;
+		}
+		thread_local uint32_t counter = 0;
+		if (++counter < rate)
+		{
+			return false;
+		}
+		counter = 0;
+		return true;
+	}
+
+	/// <summary>
+	/// 処理時間を記録
+	/// </summary>
+	void Record(TraceOp op, uint64_t nanoseconds)
+	{
+		mHistograms[static_cast<size_t>(op)].Record(nanoseconds);
+	}
+
+	/// <summary>
+	/// 操作のヒストグラムを取得
+	/// </summary>
+	const LatencyHistogram& Histogram(TraceOp op) const
+	{
+		return mHistograms[static_cast<size_t>(op)];
+	}
+
+	/// <summary>
+	/// すべてのヒストグラムの記録を消す
+	/// </summary>
+	void Reset()
+	{
+		for (auto& histogram : mHistograms)
+		{
+			histogram.Reset();
+		}
+	}
+
+	/// <summary>
+	/// 記録のある操作ごとに件数・平均・p50/p99/p999・最大値（ナノ秒）をタブ区切りで書き出す
+	/// </summary>
+	void WriteSummary(std::ostream& out) const
+	{
+		out << "op\tcount\tmean_ns\tp50_ns\tp99_ns\tp999_ns\tmax_ns\n";
+		for (size_t i = 0; i < static_cast<size_t>(TraceOp::Count); i++)
+		{
+			const LatencyHistogram& histogram = mHistograms[i];
+			if (histogram.Count() == 0)
+			{
+				continue;
+			}
+			out << TraceOpName(static_cast<TraceOp>(i)) << '\t' << histogram.Count() << '\t'
+				<< static_cast<uint64_t>(histogram.Mean()) << '\t' << histogram.Percentile(50.0) << '\t'
+				<< histogram.Percentile(99.0) << '\t' << histogram.Percentile(99.9) << '\t' << histogram.Max() << '\n';
+		}
+	}
+
+	/// <summary>
+	/// 集計結果をファイルへ書き出す
+	/// </summary>
+	/// <returns>書き込みに成功した場合はtrue</returns>
+	bool WriteSummary(const std::string& path) const
+	{
+		std::ofstream file(path, std::ios::trunc);
+		if (!file.is_open())
+		{
+			return false;
+		}
+		WriteSummary(file);
+		file.close();
+		return !file.fail();
+	}
+
+private:
+	LatencyHistogram mHistograms[static_cast<size_t>(TraceOp::Count)];
+	std::atomic<uint32_t> mSampleRate{ 1 };
+
+	LatencyTracer() = default;
+};
+
+/// <summary>
+/// 生存期間の処理時間を記録するスコープ
+/// 間引きで記録しないことになった場合は時刻も取得しない
+/// </summary>
+class TraceScope
+{
+public:
+	explicit TraceScope(TraceOp op) : mOp(op), mSampled(LatencyTracer::Instance().ShouldSample())
+	{
+		if (mSampled)
+		{
+			mStart = std::chrono::steady_clock::now();
+		}
+	}
+
+	TraceScope(const TraceScope&) = delete;
+	TraceScope& operator=(const TraceScope&) = delete;
+
+	~TraceScope()
+	{
+		if (mSampled)
+		{
+			const auto elapsed = std::chrono::steady_clock::now() - mStart;
+			LatencyTracer::Instance().Record(mOp, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+		}
+	}
+
+private:
+	TraceOp mOp;
+	bool mSampled;
+	std::chrono::steady_clock::time_point mStart;
+};
+
+// LINKEDLIST_TRACINGを定義した場合だけ計測点を有効にする（未定義の場合は何も生成しない）
+#ifdef LINKEDLIST_TRACING
+#define LINKEDLIST_TRACE_CONCAT_INNER(a, b) a##b
+#define LINKEDLIST_TRACE_CONCAT(a, b) LINKEDLIST_TRACE_CONCAT_INNER(a, b)
+#define LINKEDLIST_TRACE_SCOPE(op) TraceScope LINKEDLIST_TRACE_CONCAT(traceScope_, __LINE__)(TraceOp::op)
+#else
+#define LINKEDLIST_TRACE_SCOPE(op) ((void)0)
+#endif
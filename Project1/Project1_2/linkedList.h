@@ -1,5 +1,25 @@
 #pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <new>
 #include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "errorPolicy.h"
+#include "latencyTrace.h"
+#include "nodeCache.h"
+
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <xmmintrin.h>
+#endif
 
 /// <summary>
 /// 双方向リストのテンプレートクラス
@@ -9,23 +29,108 @@ template <typename T>
 class LinkedList
 {
 private:
+	// まとめて確保したノード群のヘッダ（ノード配列がこの直後に続く）
+	struct NodeBlock
+	{
+		// ブロック内でまだ解放されていないノード数（ブロックのノードが別々のスレッドのリストへ渡っても解放できるようアトミックにする）
+		std::atomic<size_t> liveCount;
+		// ブロックに確保したノード数
+		size_t capacity;
+		// ブロックを記録しているリスト（どのリストにも記録されていなければnullptr）と、そのリストのmBlocks内の位置
+		LinkedList* owner;
+		size_t ownerIndex;
+	};
+
+	// スロットを持たないことを表すスロット番号
+	static constexpr uint32_t NoHandleSlot = std::numeric_limits<uint32_t>::max();
+
 	// ノード構造体
 	struct Node
 	{
 		T data;
 		Node* prev;
 		Node* next;
+		// まとめて確保されたノードの場合は所属ブロック、個別に確保された場合はnullptr
+		NodeBlock* block;
+		// 遅延削除で削除済みの印を付けられたノード（トゥームストーン）かどうか
+		bool removed;
+		// ノードキャッシュから確保されたノードかどうか
+		bool cached;
+		// ハンドルのスロット番号（ハンドルを発行していなければNoHandleSlot）
+		uint32_t handleSlot;
+
+		Node(const T& value) : data(value), prev(nullptr), next(nullptr), block(nullptr), removed(false), cached(false), handleSlot(NoHandleSlot)
+		{
+		}
+
+		Node(T&& value) : data(static_cast<T&&>(value)), prev(nullptr), next(nullptr), block(nullptr), removed(false), cached(false), handleSlot(NoHandleSlot)
+		{
+		}
 
-		Node(const T& value) : data(value), prev(nullptr), next(nullptr)
+		Node(const T& value, Node* prev, Node* next, NodeBlock* block) : data(value), prev(prev), next(next), block(block), removed(false), cached(false), handleSlot(NoHandleSlot)
 		{
 		}
 	};
 
+	// ハンドルのスロット
+	struct HandleSlot
+	{
+		// スロットが指すノード（空きスロットならnullptr）
+		Node* node;
+		// スロットを解放するたびに増える番号（発行済みのハンドルと一致しなければ、そのハンドルは無効）
+		uint32_t generation;
+		// 次の空きスロットの番号
+		uint32_t nextFree;
+	};
+
+	static_assert(alignof(Node) <= alignof(std::max_align_t), "over-aligned T is not supported");
+
+	// ブロック先頭からノード配列までのオフセット
+	static constexpr size_t BlockHeaderSize = (sizeof(NodeBlock) + alignof(Node) - 1) / alignof(Node) * alignof(Node);
+
+	// 先読みする距離の上限
+	static constexpr size_t MaxPrefetchDistance = 64;
+
+	// 自動コンパクションを行う最小のトゥームストーン数
+	static constexpr size_t MinTombstonesForCompact = 64;
+
+	// 個別に確保するノードのキャッシュ（ノードの大きさが同じ型の間で共有する）
+	using Cache = NodeCache<sizeof(Node), alignof(Node)>;
+
+	// 基数ソートで1回に分配する桁のビット数とバケット数
+	static constexpr unsigned RadixBits = 11;
+	static constexpr size_t RadixBuckets = static_cast<size_t>(1) << RadixBits;
+
 	Node* mHead;
 	Node* mTail;
+	// トゥームストーンを除いた要素数
 	size_t mCount;
+	// リスト内に残っているトゥームストーンの数
+	size_t mTombstones;
+	// 遅延削除モードかどうか
+	bool mLazyRemove;
+	// 個別に確保するノードをノードキャッシュから確保するかどうか
+	bool mNodeCache;
+	// トゥームストーンが全ノードに占める割合がこの値以上になったら自動でコンパクションする（0以下なら自動では行わない）
+	double mCompactRatio;
+	// 段階的な再配置で次に移動するノード（再配置中でなければnullptr）
+	Node* mRelayoutCursor;
+	// ノードを再配置するたびに増える番号
+	size_t mLayoutVersion;
+	// このリストのノードだけを持つブロック（mOwnsBlocksがtrueの間だけ記録する）
+	std::vector<NodeBlock*> mBlocks;
+	// リストの全ノードがmBlocksのいずれかに属し、mBlocksの各ブロックの未解放のノードがすべてこのリストにあるか
+	// 1つずつ確保したノードを持つ場合や、他のリストとノードをやり取りした場合はfalseになり、空になるとtrueに戻る
+	bool mOwnsBlocks;
+	// ハンドルのスロット表（リストのオブジェクトに属し、中身と一緒に他のリストへ移ることはない）
+	std::vector<HandleSlot> mHandleSlots;
+	// 空きスロットの先頭（無ければNoHandleSlot）
+	uint32_t mFreeHandleSlot;
 
 public:
+	// 走査時に何ノード先まで先読みするかの既定値
+	static constexpr size_t DefaultPrefetchDistance = 8;
+
 	// コンストイテレータクラスの前方宣言
 	class ConstIterator;
 
@@ -44,6 +149,12 @@ public:
 		}
 
 	public:
+		using iterator_category = std::bidirectional_iterator_tag;
+		using value_type = T;
+		using difference_type = std::ptrdiff_t;
+		using pointer = T*;
+		using reference = T&;
+
 		Iterator() : mNode(nullptr)
 		{
 		}
@@ -55,7 +166,7 @@ public:
 		{
 			if (!mNode)
 			{
-				throw std::runtime_error("Invalid iterator");
+				ReportMisuse("Invalid iterator");
 			}
 			return mNode->data;
 		}
@@ -67,7 +178,7 @@ public:
 		{
 			if (!mNode)
 			{
-				throw std::runtime_error("Invalid iterator");
+				ReportMisuse("Invalid iterator");
 			}
 			return &(mNode->data);
 		}
@@ -79,9 +190,9 @@ public:
 		{
 			if (!mNode)
 			{
-				throw std::runtime_error("Invalid iterator");
+				ReportMisuse("Invalid iterator");
 			}
-			mNode = mNode->next;
+			mNode = NextLive(mNode->next);
 			return *this;
 		}
 
@@ -92,10 +203,10 @@ public:
 		{
 			if (!mNode)
 			{
-				throw std::runtime_error("Invalid iterator");
+				ReportMisuse("Invalid iterator");
 			}
 			Iterator temp = *this;
-			mNode = mNode->next;
+			mNode = NextLive(mNode->next);
 			return temp;
 		}
 
@@ -106,9 +217,9 @@ public:
 		{
 			if (!mNode)
 			{
-				throw std::runtime_error("Invalid iterator");
+				ReportMisuse("Invalid iterator");
 			}
-			mNode = mNode->prev;
+			mNode = PrevLive(mNode->prev);
 			return *this;
 		}
 
@@ -119,10 +230,10 @@ public:
 		{
 			if (!mNode)
 			{
-				throw std::runtime_error("Invalid iterator");
+				ReportMisuse("Invalid iterator");
 			}
 			Iterator temp = *this;
-			mNode = mNode->prev;
+			mNode = PrevLive(mNode->prev);
 			return temp;
 		}
 
@@ -157,10 +268,21 @@ public:
 		}
 
 	public:
+		using iterator_category = std::bidirectional_iterator_tag;
+		using value_type = T;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const T*;
+		using reference = const T&;
+
 		ConstIterator() : mNode(nullptr)
 		{
 		}
 
+		/// <summary>
+		/// コピーコンストラクタ
+		/// </summary>
+		ConstIterator(const ConstIterator&) = default;
+
 		/// <summary>
 		/// イテレータの指す要素を取得（const版）
 		/// </summary>
@@ -168,7 +290,7 @@ public:
 		{
 			if (!mNode)
 			{
-				throw std::runtime_error("Invalid iterator");
+				ReportMisuse("Invalid iterator");
 			}
 			return mNode->data;
 		}
@@ -180,7 +302,7 @@ public:
 		{
 			if (!mNode)
 			{
-				throw std::runtime_error("Invalid iterator");
+				ReportMisuse("Invalid iterator");
 			}
 			return &(mNode->data);
 		}
@@ -192,9 +314,9 @@ public:
 		{
 			if (!mNode)
 			{
-				throw std::runtime_error("Invalid iterator");
+				ReportMisuse("Invalid iterator");
 			}
-			mNode = mNode->next;
+			mNode = NextLive(mNode->next);
 			return *this;
 		}
 
@@ -205,10 +327,10 @@ public:
 		{
 			if (!mNode)
 			{
-				throw std::runtime_error("Invalid iterator");
+				ReportMisuse("Invalid iterator");
 			}
 			ConstIterator temp = *this;
-			mNode = mNode->next;
+			mNode = NextLive(mNode->next);
 			return temp;
 		}
 
@@ -219,9 +341,9 @@ public:
 		{
 			if (!mNode)
 			{
-				throw std::runtime_error("Invalid iterator");
+				ReportMisuse("Invalid iterator");
 			}
-			mNode = mNode->prev;
+			mNode = PrevLive(mNode->prev);
 			return *this;
 		}
 
@@ -232,10 +354,10 @@ public:
 		{
 			if (!mNode)
 			{
-				throw std::runtime_error("Invalid iterator");
+				ReportMisuse("Invalid iterator");
 			}
 			ConstIterator temp = *this;
-			mNode = mNode->prev;
+			mNode = PrevLive(mNode->prev);
 			return temp;
 		}
 
@@ -258,15 +380,87 @@ public:
 		/// <summary>
 		/// 代入演算子
 		/// </summary>
-		ConstIterator& operator=(const ConstIterator& other)
+		ConstIterator& operator=(const ConstIterator&) = default;
+	};
+
+	/// <summary>
+	/// 要素を指すハンドルクラス
+	/// イテレータと違い、要素が削除された後に使っても安全で、IsValid()/Resolve()で無効になったことを検出できる
+	/// ノードの再配置（Relayout/RelayoutStep）の後も同じ要素を指し続ける
+	/// </summary>
+	class Handle
+	{
+	private:
+		uint32_t mSlot;
+		uint32_t mGeneration;
+		friend class LinkedList<T>;
+
+		Handle(uint32_t slot, uint32_t generation) : mSlot(slot), mGeneration(generation)
+		{
+		}
+
+	public:
+		/// <summary>
+		/// どの要素も指さないハンドルを作成
+		/// </summary>
+		Handle() : mSlot(NoHandleSlot), mGeneration(0)
 		{
-			mNode = other.mNode;
-			return *this;
+		}
+
+		/// <summary>
+		/// 二つのハンドルが同じ要素を指すかどうか比較
+		/// </summary>
+		bool operator==(const Handle& other) const
+		{
+			return mSlot == other.mSlot && mGeneration == other.mGeneration;
+		}
+
+		/// <summary>
+		/// 二つのハンドルが異なる要素を指すかどうか比較
+		/// </summary>
+		bool operator!=(const Handle& other) const
+		{
+			return !(*this == other);
 		}
 	};
 
-	LinkedList() : mHead(nullptr), mTail(nullptr), mCount(0)
+	LinkedList() : mHead(nullptr), mTail(nullptr), mCount(0), mTombstones(0), mLazyRemove(false), mNodeCache(false), mCompactRatio(0.5),
+		mRelayoutCursor(nullptr), mLayoutVersion(0), mOwnsBlocks(true), mFreeHandleSlot(NoHandleSlot)
+	{
+	}
+
+	/// <summary>
+	/// コピーコンストラクタ
+	/// コピー元の全ノードを1つのブロックにまとめて確保して複製する
+	/// </summary>
+	LinkedList(const LinkedList& other)
+		: mHead(nullptr), mTail(nullptr), mCount(0), mTombstones(0), mLazyRemove(other.mLazyRemove), mNodeCache(other.mNodeCache), mCompactRatio(other.mCompactRatio),
+		mRelayoutCursor(nullptr), mLayoutVersion(0), mOwnsBlocks(true), mFreeHandleSlot(NoHandleSlot)
+	{
+		CopyFrom(other);
+	}
+
+	/// <summary>
+	/// ムーブコンストラクタ
+	/// ノードは移動せず、先頭・末尾・要素数を引き継ぐだけなので要素数に関係なく定数時間で終わる
+	/// </summary>
+	LinkedList(LinkedList&& other) noexcept
+		: mHead(other.mHead), mTail(other.mTail), mCount(other.mCount), mTombstones(other.mTombstones),
+		mLazyRemove(other.mLazyRemove), mNodeCache(other.mNodeCache), mCompactRatio(other.mCompactRatio),
+		mRelayoutCursor(other.mRelayoutCursor), mLayoutVersion(other.mLayoutVersion),
+		mBlocks(std::move(other.mBlocks)), mOwnsBlocks(other.mOwnsBlocks), mFreeHandleSlot(NoHandleSlot)
 	{
+		AdoptBlocks();
+		other.mBlocks.clear();
+		other.mOwnsBlocks = true;
+
+		// ハンドルはリストのオブジェクトに属するので、移動元で発行したものは無効にする
+		other.ReleaseAllHandles();
+		other.mRelayoutCursor = nullptr;
+		other.mHead = nullptr;
+		other.mTail = nullptr;
+		other.mCount = 0;
+		other.mTombstones = 0;
 	}
 
 	~LinkedList()
@@ -274,47 +468,359 @@ public:
 		Clean();
 	}
 
+	/// <summary>
+	/// コピー代入演算子
+	/// 複製を作り終えてから入れ替えるため、複製中に例外が発生しても元の内容は変更されない
+	/// コピーコンストラクタと同じく、遅延削除とノードキャッシュの設定もコピー元に合わせる
+	/// </summary>
+	LinkedList& operator=(const LinkedList& other)
+	{
+		if (this != &other)
+		{
+			LinkedList copy(other);
+			Swap(copy);
+			CopySettings(other);
+		}
+		return *this;
+	}
+
+	/// <summary>
+	/// ムーブ代入演算子
+	/// 元の要素を解放し、移動元のノードをそのまま引き継ぐ
+	/// トゥームストーンも引き継ぐため、ムーブコンストラクタと同じく遅延削除とノードキャッシュの設定も移動元に合わせる
+	/// </summary>
+	LinkedList& operator=(LinkedList&& other) noexcept
+	{
+		if (this != &other)
+		{
+			Clean();
+			CopySettings(other);
+			mBlocks = std::move(other.mBlocks);
+			mOwnsBlocks = other.mOwnsBlocks;
+			AdoptBlocks();
+			other.mBlocks.clear();
+			other.mOwnsBlocks = true;
+			other.ReleaseAllHandles();
+			mHead = other.mHead;
+			mTail = other.mTail;
+			mCount = other.mCount;
+			mTombstones = other.mTombstones;
+			mRelayoutCursor = other.mRelayoutCursor;
+			mLayoutVersion++;
+			other.mRelayoutCursor = nullptr;
+			other.mHead = nullptr;
+			other.mTail = nullptr;
+			other.mCount = 0;
+			other.mTombstones = 0;
+		}
+		return *this;
+	}
+
+	/// <summary>
+	/// 別のリストと内容を入れ替える（ノードは移動せず、遅延削除の設定も入れ替えない）
+	/// 遅延削除モードでないリストが受け取ったトゥームストーンは、その場でコンパクションする
+	/// ハンドルは入れ替えず、両方のリストで発行済みのハンドルが無効になる
+	/// </summary>
+	/// <param name="other">入れ替え先のリスト</param>
+	void Swap(LinkedList& other) noexcept
+	{
+		ReleaseAllHandles();
+		other.ReleaseAllHandles();
+
+		Node* head = mHead;
+		Node* tail = mTail;
+		size_t count = mCount;
+		size_t tombstones = mTombstones;
+		mHead = other.mHead;
+		mTail = other.mTail;
+		mCount = other.mCount;
+		mTombstones = other.mTombstones;
+		other.mHead = head;
+		other.mTail = tail;
+		other.mCount = count;
+		other.mTombstones = tombstones;
+
+		// 再配置の途中経過とブロックの記録は中身と一緒に入れ替える
+		Node* cursor = mRelayoutCursor;
+		mRelayoutCursor = other.mRelayoutCursor;
+		other.mRelayoutCursor = cursor;
+		mLayoutVersion++;
+		other.mLayoutVersion++;
+		mBlocks.swap(other.mBlocks);
+		std::swap(mOwnsBlocks, other.mOwnsBlocks);
+		AdoptBlocks();
+		other.AdoptBlocks();
+
+		if (!mLazyRemove)
+		{
+			Compact();
+		}
+		if (!other.mLazyRemove)
+		{
+			other.Compact();
+		}
+	}
+
 
 	/// <summary>
 	/// イテレータが指す位置の要素を削除
+	/// 遅延削除モードではノードに削除済みの印を付けるだけで、ノードの解放はCompact()まで遅らせる
 	/// </summary>
 	/// <param name="it">削除する要素を指すイテレータ</param>
 	/// <returns>削除された要素の次を指すイテレータ</returns>
 	Iterator Remove(Iterator it)
 	{
+		LINKEDLIST_TRACE_SCOPE(Remove);
+
 		if (!it.mNode)
 		{
 			return Iterator(nullptr);
 		}
 
 		Node* nodeToDelete = it.mNode;
-		Node* nextNode = nodeToDelete->next;
+		Node* nextNode = NextLive(nodeToDelete->next);
+
+		if (mLazyRemove)
+		{
+			if (!nodeToDelete->removed)
+			{
+				ReleaseHandle(nodeToDelete);
+				nodeToDelete->removed = true;
+				mCount--;
+				mTombstones++;
+			}
+
+			// 次の要素は削除済みではないので、コンパクションしても有効なまま
+			if (ShouldCompact())
+			{
+				Compact();
+			}
+			return Iterator(nextNode);
+		}
 
-		// 前後のノードを繋ぎ直す
-		if (nodeToDelete->prev)
+		UnlinkNode(nodeToDelete);
+		if (nodeToDelete->removed)
 		{
-			nodeToDelete->prev->next = nodeToDelete->next;
+			mTombstones--;
 		}
 		else
 		{
-			// 先頭ノードの場合
-			mHead = nodeToDelete->next;
+			mCount--;
+		}
+		ReleaseHandle(nodeToDelete);
+		DestroyNode(nodeToDelete);
+
+		return Iterator(nextNode);
+	}
+
+	/// <summary>
+	/// 範囲[first, last)の要素をまとめて削除
+	/// 連続して削除される要素の前後は1回だけ繋ぎ直し、ノードは最後にまとめて解放する
+	/// 遅延削除モードでも印を付けずにその場で解放し、範囲内のトゥームストーンも一緒に解放する
+	/// 削除された要素を指していたイテレータは無効になる
+	/// </summary>
+	/// <param name="first">削除する範囲の先頭</param>
+	/// <param name="last">削除する範囲の末尾の次</param>
+	/// <returns>削除した要素数</returns>
+	size_t Remove(Iterator first, Iterator last)
+	{
+		LINKEDLIST_TRACE_SCOPE(Remove);
+
+		return RemoveRangeIf(first.mNode, last.mNode, [](const T&) { return true; });
+	}
+
+	/// <summary>
+	/// 条件を満たす要素をまとめて削除
+	/// 先頭から1回だけ走査し、連続して削除される要素の前後は1回だけ繋ぎ直し、ノードは最後にまとめて解放する
+	/// 遅延削除モードでも印を付けずにその場で解放し、残っているトゥームストーンも一緒に解放する
+	/// 条件の判定中に例外が発生した場合は、それまでに条件を満たした要素だけを削除して例外を送出する
+	/// </summary>
+	/// <param name="pred">要素を削除する場合にtrueを返す関数（const T&を受け取る）</param>
+	/// <returns>削除した要素数</returns>
+	template <typename Pred>
+	size_t RemoveIf(Pred pred)
+	{
+		LINKEDLIST_TRACE_SCOPE(Remove);
+
+		return RemoveRangeIf(mHead, nullptr, pred);
+	}
+
+	/// <summary>
+	/// 別のリストの全要素を、ノードを繋ぎ替えてpositionの前へ移す（要素のコピーやメモリの確保は発生せず、ハンドルを使っていなければ定数時間で終わる）
+	/// このリストが遅延削除を使わない場合、移動元から移ってきたトゥームストーンはその場で解放する
+	/// 移した要素を指していたイテレータはこのリストの要素を指し、移動元のハンドルは無効になる
+	/// 別のスレッドで作ったリストのノードも移してよい（移した後はこのリストと同じスレッドで扱うこと）
+	/// </summary>
+	/// <param name="position">挿入位置を指すイテレータ</param>
+	/// <param name="other">移動元のリスト（空になる）</param>
+	void Splice(Iterator position, LinkedList& other)
+	{
+		if (&other == this || !other.mHead)
+		{
+			return;
+		}
+
+		other.ReleaseAllHandles();
+		TakeBlocks(other);
+		Node* first = other.mHead;
+		Node* last = other.mTail;
+		const size_t count = other.mCount;
+		const size_t tombstones = other.mTombstones;
+		other.mHead = nullptr;
+		other.mTail = nullptr;
+		other.mCount = 0;
+		other.mTombstones = 0;
+		other.mRelayoutCursor = nullptr;
+		other.mLayoutVersion++;
+
+		LinkChain(position.mNode, first, last, count);
+		mTombstones += tombstones;
+		CompactTransferred(first, last, tombstones);
+	}
+
+	/// <summary>
+	/// 別のリスト（このリストでもよい）の範囲[first, last)の要素を、ノードを繋ぎ替えてpositionの前へ移す
+	/// 範囲内のトゥームストーンも一緒に移し（このリストが遅延削除を使わない場合はその場で解放する）、範囲の要素数に比例した時間がかかる
+	/// 別のリストから移した場合、移した要素のハンドルは無効になる
+	/// </summary>
+	/// <param name="position">挿入位置を指すイテレータ（範囲内を指してはならない）</param>
+	/// <param name="other">移動元のリスト</param>
+	/// <param name="first">移す範囲の先頭</param>
+	/// <param name="last">移す範囲の末尾の次</param>
+	void Splice(Iterator position, LinkedList& other, Iterator first, Iterator last)
+	{
+		if (first.mNode == last.mNode || !first.mNode)
+		{
+			return;
+		}
+
+		// 範囲の外のノードと同じブロックのノードが両方のリストに分かれるので、どちらもブロックを記録しない
+		if (&other != this)
+		{
+			DisownBlocks();
+			other.DisownBlocks();
+		}
+
+		// 範囲の要素数を数えながら、移動元でだけ有効な情報を外す
+		size_t live = 0;
+		size_t tombstones = 0;
+		bool cursorInRange = false;
+		Node* rangeLast = nullptr;
+		for (Node* node = first.mNode; node != last.mNode; node = node->next)
+		{
+			if (node->removed)
+			{
+				tombstones++;
+			}
+			else
+			{
+				live++;
+			}
+			if (&other != this)
+			{
+				other.ReleaseHandle(node);
+			}
+			cursorInRange = cursorInRange || node == other.mRelayoutCursor;
+			rangeLast = node;
 		}
 
-		if (nodeToDelete->next)
+		// 移動元から範囲を外す
+		Node* before = first.mNode->prev;
+		if (before)
 		{
-			nodeToDelete->next->prev = nodeToDelete->prev;
+			before->next = last.mNode;
 		}
 		else
 		{
-			// 末尾ノードの場合
-			mTail = nodeToDelete->prev;
+			other.mHead = last.mNode;
+		}
+		if (last.mNode)
+		{
+			last.mNode->prev = before;
+		}
+		else
+		{
+			other.mTail = before;
+		}
+		if (cursorInRange)
+		{
+			other.mRelayoutCursor = last.mNode;
+		}
+		other.mCount -= live;
+		other.mTombstones -= tombstones;
+		if (&other != this)
+		{
+			other.mLayoutVersion++;
 		}
 
-		delete nodeToDelete;
-		mCount--;
+		LinkChain(position.mNode, first.mNode, rangeLast, live);
+		mTombstones += tombstones;
+		if (&other != this)
+		{
+			CompactTransferred(first.mNode, rangeLast, tombstones);
+		}
+	}
 
-		return Iterator(nextNode);
+	/// <summary>
+	/// 遅延削除モードを設定
+	/// 無効にした場合は残っているトゥームストーンをその場でコンパクションする
+	/// </summary>
+	/// <param name="enabled">遅延削除を有効にする場合はtrue</param>
+	/// <param name="compactRatio">
+	/// トゥームストーンが全ノードに占める割合がこの値以上になったらRemove()の中で自動的にコンパクションする（0以下なら自動では行わない）
+	/// </param>
+	void SetLazyRemove(bool enabled, double compactRatio = 0.5)
+	{
+		mLazyRemove = enabled;
+		mCompactRatio = compactRatio;
+		if (!enabled)
+		{
+			Compact();
+		}
+	}
+
+	/// <summary>
+	/// Insert()で1つずつ確保するノードを、スレッドごとのノードキャッシュから確保するかどうかを設定
+	/// 複数のスレッドがそれぞれのリストへ同時に挿入する場合に、共有のヒープの競合を避けられる
+	/// キャッシュから確保したノードは、どのリスト・どのスレッドで解放してもキャッシュへ返る（OSへは返さない）
+	/// 設定は今後確保するノードにだけ影響し、既存のノードはそのまま
+	/// </summary>
+	/// <param name="enabled">ノードキャッシュを使う場合はtrue</param>
+	void SetNodeCache(bool enabled)
+	{
+		mNodeCache = enabled;
+	}
+
+	/// <summary>
+	/// 削除済みの印が付いたノードをまとめてリストから外して解放
+	/// 削除済みの要素を指していたイテレータは無効になる（それ以外のイテレータは有効なまま）
+	/// </summary>
+	/// <returns>解放したノード数</returns>
+	size_t Compact()
+	{
+		const size_t released = mTombstones;
+		Node* node = mHead;
+		while (node && mTombstones > 0)
+		{
+			Node* next = node->next;
+			if (node->removed)
+			{
+				UnlinkNode(node);
+				DestroyNode(node);
+				mTombstones--;
+			}
+			node = next;
+		}
+		return released;
+	}
+
+	/// <summary>
+	/// まだ解放されていないトゥームストーンの数を取得
+	/// </summary>
+	/// <returns>トゥームストーンの数</returns>
+	size_t TombstoneCount() const
+	{
+		return mTombstones;
 	}
 
 	/// <summary>
@@ -325,10 +831,15 @@ public:
 	/// <returns>挿入された要素を指すイテレータ</returns>
 	Iterator Insert(Iterator it, const T& value)
 	{
+		LINKEDLIST_TRACE_SCOPE(Insert);
+
+		// 1つずつ確保したノードはブロックに属さない
+		DisownBlocks();
+
 		// 末尾への挿入、またはリストが空の場合
 		if (!it.mNode)
 		{
-			Node* newNode = new Node(value);
+			Node* newNode = NewNode(value);
 			if (mHead == nullptr)
 			{
 				mHead = newNode;
@@ -344,7 +855,7 @@ public:
 			return Iterator(mTail);
 		}
 
-		Node* newNode = new Node(value);
+		Node* newNode = NewNode(value);
 		Node* current = it.mNode;
 
 		newNode->next = current;
@@ -366,13 +877,84 @@ public:
 		return Iterator(newNode);
 	}
 
+	/// <summary>
+	/// イテレータが指す位置の前にcount個の要素をまとめて挿入
+	/// ノードは1つのブロックにまとめて確保され、連結後に一度だけ前後と繋ぎ直す
+	/// </summary>
+	/// <param name="it">挿入位置を指すイテレータ</param>
+	/// <param name="count">挿入する要素数</param>
+	/// <param name="generate">i番目(0からcount-1まで順に呼ばれる)の要素を返す関数</param>
+	/// <returns>挿入された最初の要素を指すイテレータ（count が0の場合は it）</returns>
+	template <typename Generator>
+	Iterator InsertBulk(Iterator it, size_t count, Generator generate)
+	{
+		LINKEDLIST_TRACE_SCOPE(InsertBulk);
+
+		if (count == 0)
+		{
+			return it;
+		}
+
+		ReserveBlock();
+		Node* first;
+		Node* last;
+		CreateChain(count, generate, first, last);
+		RegisterBlock(first->block);
+		LinkChain(it.mNode, first, last, count);
+
+		return Iterator(first);
+	}
+
+	/// <summary>
+	/// イテレータが指す位置の前に範囲[first, last)の要素をまとめて挿入
+	/// 前方向イテレータであれば要素数を先に数え、全ノードを1つのブロックにまとめて確保する
+	/// 入力イテレータの場合は一度値を集めてから同様に挿入する
+	/// </summary>
+	/// <param name="it">挿入位置を指すイテレータ</param>
+	/// <param name="first">挿入する範囲の先頭</param>
+	/// <param name="last">挿入する範囲の末尾の次</param>
+	/// <returns>挿入された最初の要素を指すイテレータ（範囲が空の場合は it）</returns>
+	template <typename InputIt>
+	Iterator InsertRange(Iterator it, InputIt first, InputIt last)
+	{
+		using Category = typename std::iterator_traits<InputIt>::iterator_category;
+		if constexpr (std::is_base_of_v<std::forward_iterator_tag, Category>)
+		{
+			const size_t count = static_cast<size_t>(std::distance(first, last));
+			return InsertBulk(it, count, [&first](size_t)
+			{
+				return *first++;
+			});
+		}
+		else
+		{
+			std::vector<T> values(first, last);
+			return InsertRange(it, std::make_move_iterator(values.begin()), std::make_move_iterator(values.end()));
+		}
+	}
+
+	/// <summary>
+	/// リストの内容を範囲[first, last)の要素で置き換える
+	/// 新しいノードをすべて構築し終えてから元の要素を解放するため、構築中に例外が発生してもリストは変更されない
+	/// </summary>
+	/// <param name="first">範囲の先頭</param>
+	/// <param name="last">範囲の末尾の次</param>
+	template <typename InputIt>
+	void Assign(InputIt first, InputIt last)
+	{
+		LinkedList<T> replacement;
+		replacement.InsertRange(replacement.End(), first, last);
+
+		Swap(replacement);
+	}
+
 	/// <summary>
 	/// 先頭イテレータ取得
 	/// </summary>
 	/// <returns>先頭を指すイテレータ</returns>
 	Iterator Begin()
 	{
-		return Iterator(mHead);
+		return Iterator(NextLive(mHead));
 	}
 
 	/// <summary>
@@ -390,7 +972,7 @@ public:
 	/// <returns>先頭を指すコンストイテレータ</returns>
 	ConstIterator CBegin() const
 	{
-		return ConstIterator(mHead);
+		return ConstIterator(NextLive(mHead));
 	}
 
 	/// <summary>
@@ -421,18 +1003,1312 @@ public:
 	}
 
 	/// <summary>
-	/// リストのすべての要素を削除してメモリを解放
+	/// 全要素を先頭から順に処理する
+	/// 処理中の要素よりprefetchDistance個先のノードを先読みし、ノードがメモリ上に散らばっていても読み込み待ちを処理と重ねる
+	/// 削除済みの要素は渡されない
 	/// </summary>
-	void Clean()
+	/// <param name="func">各要素を受け取る関数（T&を受け取る）</param>
+	/// <param name="prefetchDistance">先読みするノード数（0なら先読みしない、上限はMaxPrefetchDistance）</param>
+	template <typename Func>
+	void ForEach(Func func, size_t prefetchDistance = DefaultPrefetchDistance)
 	{
-		while (mHead)
+		LINKEDLIST_TRACE_SCOPE(ForEach);
+
+		PrefetchCursor<Node*> cursor(mHead, prefetchDistance);
+		while (Node* node = cursor.Next())
 		{
-			Node* temp = mHead;
-			mHead = mHead->next;
-			delete temp;
+			if (!node->removed)
+			{
+				func(node->data);
+			}
 		}
-		mHead = nullptr;
-		mTail = nullptr;
-		mCount = 0;
+	}
+
+	/// <summary>
+	/// 全要素を先頭から順に処理する（const版）
+	/// </summary>
+	/// <param name="func">各要素を受け取る関数（const T&を受け取る）</param>
+	/// <param name="prefetchDistance">先読みするノード数（0なら先読みしない、上限はMaxPrefetchDistance）</param>
+	template <typename Func>
+	void ForEach(Func func, size_t prefetchDistance = DefaultPrefetchDistance) const
+	{
+		LINKEDLIST_TRACE_SCOPE(ForEach);
+
+		PrefetchCursor<const Node*> cursor(mHead, prefetchDistance);
+		while (const Node* node = cursor.Next())
+		{
+			if (!node->removed)
+			{
+				func(node->data);
+			}
+		}
+	}
+
+	/// <summary>
+	/// 要素を安定ソートする
+	/// ノードへのポインタを集めて並べ替え、繋ぎ直すだけなので要素の移動は発生せず、既存のイテレータも有効なまま
+	/// トゥームストーンはソート前に解放する
+	/// </summary>
+	/// <param name="less">要素の比較関数（aがbより前に来る場合にtrue）</param>
+	template <typename Compare>
+	void Sort(Compare less)
+	{
+		LINKEDLIST_TRACE_SCOPE(Sort);
+
+		Compact();
+		if (mCount < 2)
+		{
+			return;
+		}
+
+		std::vector<Node*> nodes;
+		nodes.reserve(mCount);
+		PrefetchCursor<Node*> cursor(mHead, DefaultPrefetchDistance);
+		while (Node* node = cursor.Next())
+		{
+			nodes.push_back(node);
+		}
+
+		std::stable_sort(nodes.begin(), nodes.end(), [&less](const Node* a, const Node* b)
+		{
+			return less(a->data, b->data);
+		});
+
+		RelinkInOrder(nodes, [](Node* node) { return node; });
+
+		// 並び順が変わったので、段階的な再配置は先頭からやり直す
+		mRelayoutCursor = nullptr;
+	}
+
+	/// <summary>
+	/// 要素を昇順(operator&lt;)に安定ソートする
+	/// </summary>
+	void Sort()
+	{
+		Sort([](const T& a, const T& b) { return a < b; });
+	}
+
+	/// <summary>
+	/// 整数のキーで要素を安定ソートする（LSD基数ソート）
+	/// 各要素のキーを1回だけ取り出してノードへのポインタと組にし、キーの値の範囲に必要な桁数だけ分配を繰り返してから繋ぎ直す
+	/// 比較を行わないため、要素数が多くキーの範囲が狭いほどSort()より速い
+	/// Sort()と同様に要素の移動は発生せず、既存のイテレータも有効なまま
+	/// </summary>
+	/// <param name="keyFn">要素から整数のキー（負の値も可）を取り出す関数</param>
+	/// <param name="descending">trueの場合はキーの降順に並べる（キーが等しい要素の順番はどちらでも保たれる）</param>
+	template <typename KeyFn>
+	void RadixSortBy(KeyFn keyFn, bool descending = false)
+	{
+		LINKEDLIST_TRACE_SCOPE(Sort);
+
+		using Key = std::decay_t<decltype(keyFn(std::declval<const T&>()))>;
+		static_assert(std::is_integral_v<Key>, "RadixSortBy requires an integral key");
+		using UKey = std::make_unsigned_t<std::conditional_t<(sizeof(Key) < sizeof(uint32_t)), int32_t, Key>>;
+
+		Compact();
+		if (mCount < 2)
+		{
+			return;
+		}
+
+		struct Entry
+		{
+			UKey key;
+			Node* node;
+		};
+
+		// 符号付きのキーは符号ビットを反転して、符号なしの大小関係と一致させる
+		constexpr UKey SignFlip = std::is_signed_v<Key> ? (static_cast<UKey>(1) << (sizeof(UKey) * 8 - 1)) : 0;
+
+		std::vector<Entry> entries;
+		entries.reserve(mCount);
+		UKey minKey = std::numeric_limits<UKey>::max();
+		UKey maxKey = 0;
+		PrefetchCursor<Node*> cursor(mHead, DefaultPrefetchDistance);
+		while (Node* node = cursor.Next())
+		{
+			UKey key = static_cast<UKey>(static_cast<UKey>(keyFn(node->data)) ^ SignFlip);
+			if (descending)
+			{
+				key = static_cast<UKey>(~key);
+			}
+			minKey = std::min(minKey, key);
+			maxKey = std::max(maxKey, key);
+			entries.push_back({ key, node });
+		}
+
+		// 最小値との差で分配し、値の範囲に必要な桁だけを処理する
+		const UKey range = static_cast<UKey>(maxKey - minKey);
+		std::vector<Entry> buffer(entries.size());
+		std::vector<size_t> offsets(RadixBuckets);
+		for (unsigned shift = 0; shift < sizeof(UKey) * 8 && (range >> shift) != 0; shift += RadixBits)
+		{
+			std::fill(offsets.begin(), offsets.end(), 0);
+			for (const Entry& entry : entries)
+			{
+				offsets[static_cast<size_t>((static_cast<UKey>(entry.key - minKey) >> shift) & (RadixBuckets - 1))]++;
+			}
+
+			size_t total = 0;
+			for (size_t& offset : offsets)
+			{
+				const size_t count = offset;
+				offset = total;
+				total += count;
+			}
+
+			for (const Entry& entry : entries)
+			{
+				buffer[offsets[static_cast<size_t>((static_cast<UKey>(entry.key - minKey) >> shift) & (RadixBuckets - 1))]++] = entry;
+			}
+			entries.swap(buffer);
+		}
+
+		RelinkInOrder(entries, [](const Entry& entry) { return entry.node; });
+
+		// 並び順が変わったので、段階的な再配置は先頭からやり直す
+		mRelayoutCursor = nullptr;
+	}
+
+	/// <summary>
+	/// それぞれソート済みの複数のリストを1つのリストにマージする（k-wayマージ）
+	/// 各リストの先頭ノードをヒープで管理し、最も前に来るノードを取り出して繋ぎ直すことを繰り返すため、
+	/// 全要素数をn、リスト数をKとしてO(n log K)で、要素ごとのメモリ確保や要素の移動は発生しない
+	/// 元のリストのノードはすべて戻り値のリストへ移り、元のリストは空になる（元のリストを指していたイテレータは戻り値のリストの要素を指し、ハンドルは無効になる）
+	/// 比較が等しい要素は、lists内で前にあるリストの要素を先に並べ、同じリスト内の順番も保つ
+	/// </summary>
+	/// <param name="lists">マージするリスト（それぞれがlessの順にソート済みであること）</param>
+	/// <param name="less">要素の比較関数（aがbより前に来る場合にtrue）</param>
+	/// <returns>マージしたリスト</returns>
+	template <typename Compare>
+	static LinkedList<T> MergeK(std::vector<LinkedList<T>>& lists, Compare less)
+	{
+		LINKEDLIST_TRACE_SCOPE(Sort);
+
+		// 各リストの未マージの先頭ノード
+		std::vector<Node*> heads;
+		heads.reserve(lists.size());
+		size_t total = 0;
+		for (LinkedList<T>& list : lists)
+		{
+			list.Compact();
+			list.ReleaseAllHandles();
+			list.DisownBlocks();
+			heads.push_back(list.mHead);
+			total += list.mCount;
+		}
+
+		// 先頭ノードが後ろに来るリストほど下になるヒープ（等しい場合は前のリストを優先して安定性を保つ）
+		auto later = [&heads, &less](size_t a, size_t b)
+		{
+			if (less(heads[b]->data, heads[a]->data))
+			{
+				return true;
+			}
+			if (less(heads[a]->data, heads[b]->data))
+			{
+				return false;
+			}
+			return a > b;
+		};
+		std::vector<size_t> heap;
+		heap.reserve(lists.size());
+		for (size_t i = 0; i < heads.size(); i++)
+		{
+			if (heads[i])
+			{
+				heap.push_back(i);
+			}
+		}
+		std::make_heap(heap.begin(), heap.end(), later);
+
+		LinkedList<T> merged;
+		merged.DisownBlocks();
+		Node* prev = nullptr;
+		while (!heap.empty())
+		{
+			std::pop_heap(heap.begin(), heap.end(), later);
+			const size_t top = heap.back();
+			Node* node = heads[top];
+			heads[top] = node->next;
+			if (heads[top])
+			{
+				std::push_heap(heap.begin(), heap.end(), later);
+			}
+			else
+			{
+				heap.pop_back();
+			}
+
+			node->prev = prev;
+			if (prev)
+			{
+				prev->next = node;
+			}
+			else
+			{
+				merged.mHead = node;
+			}
+			prev = node;
+		}
+		if (prev)
+		{
+			prev->next = nullptr;
+		}
+		merged.mTail = prev;
+		merged.mCount = total;
+
+		// ノードはすべて移ったので、元のリストを空にする
+		for (LinkedList<T>& list : lists)
+		{
+			list.mHead = nullptr;
+			list.mTail = nullptr;
+			list.mCount = 0;
+			list.mRelayoutCursor = nullptr;
+			list.mLayoutVersion++;
+			list.mOwnsBlocks = true;
+		}
+		return merged;
+	}
+
+	/// <summary>
+	/// それぞれ昇順(operator&lt;)にソート済みの複数のリストを1つのリストにマージする
+	/// </summary>
+	/// <param name="lists">マージするリスト</param>
+	/// <returns>マージしたリスト</returns>
+	static LinkedList<T> MergeK(std::vector<LinkedList<T>>& lists)
+	{
+		return MergeK(lists, [](const T& a, const T& b) { return a < b; });
+	}
+
+	/// <summary>
+	/// 全ノードを現在のリスト順にメモリ上で連続するよう確保し直す
+	/// Insert/Removeを繰り返してノードがヒープ上に散らばったリストの走査性能を回復させる
+	/// 要素は新しいノードへムーブ（ムーブが例外を送出しうる型ではコピー）され、トゥームストーンは解放される
+	/// 全ノードが新しくなるため、この呼び出しの前に取得したイテレータはすべて無効になる（LayoutVersion()が変わる）
+	/// 新しいノードの構築中に例外が発生した場合、リストは変更されない
+	/// </summary>
+	void Relayout()
+	{
+		mRelayoutCursor = nullptr;
+		if (mHead)
+		{
+			RelocateSegment(mHead, mCount + mTombstones);
+		}
+	}
+
+	/// <summary>
+	/// 再配置を段階的に進める
+	/// 前回の続きから最大maxNodes個のノードを1つのブロックへ移し、1回あたりの停止時間を抑える
+	/// 移されたノードを指していたイテレータは無効になり、それ以外のイテレータは有効なまま
+	/// 途中でSort()した場合は先頭からやり直す
+	/// </summary>
+	/// <param name="maxNodes">今回移すノードの最大数（1以上）</param>
+	/// <returns>リストの末尾まで再配置し終えた場合はtrue</returns>
+	bool RelayoutStep(size_t maxNodes)
+	{
+		if (!mRelayoutCursor)
+		{
+			mRelayoutCursor = mHead;
+		}
+		if (!mRelayoutCursor || maxNodes == 0)
+		{
+			return !mRelayoutCursor;
+		}
+
+		mRelayoutCursor = RelocateSegment(mRelayoutCursor, maxNodes);
+		return !mRelayoutCursor;
+	}
+
+	/// <summary>
+	/// ノードの再配置が行われるたびに変わる番号を取得
+	/// 保存しておいた値と異なれば、その間に取得したイテレータが無効になった可能性がある
+	/// </summary>
+	/// <returns>レイアウトのバージョン番号</returns>
+	size_t LayoutVersion() const
+	{
+		return mLayoutVersion;
+	}
+
+	/// <summary>
+	/// イテレータが指す要素のハンドルを取得（初めて取得する要素にはスロットを割り当てる）
+	/// ハンドルは要素の削除、Clean()、Swap()、ムーブ、MergeK()で無効になる
+	/// </summary>
+	/// <param name="it">要素を指すイテレータ</param>
+	/// <returns>要素を指すハンドル</returns>
+	Handle GetHandle(Iterator it)
+	{
+		Node* node = it.mNode;
+		if (!node || node->removed)
+		{
+			ReportMisuse("Invalid iterator");
+		}
+
+		if (node->handleSlot == NoHandleSlot)
+		{
+			uint32_t slot = mFreeHandleSlot;
+			if (slot != NoHandleSlot)
+			{
+				mFreeHandleSlot = mHandleSlots[slot].nextFree;
+			}
+			else
+			{
+				if (mHandleSlots.size() >= NoHandleSlot)
+				{
+					LINKEDLIST_THROW(std::length_error("Too many handles"));
+				}
+				slot = static_cast<uint32_t>(mHandleSlots.size());
+				mHandleSlots.push_back(HandleSlot{ nullptr, 0, NoHandleSlot });
+			}
+			mHandleSlots[slot].node = node;
+			node->handleSlot = slot;
+		}
+		return Handle(node->handleSlot, mHandleSlots[node->handleSlot].generation);
+	}
+
+	/// <summary>
+	/// ハンドルが指す要素がまだリスト内に存在するかチェック
+	/// </summary>
+	/// <param name="handle">このリストのGetHandle()で取得したハンドル</param>
+	/// <returns>要素が存在する場合はtrue</returns>
+	bool IsValid(Handle handle) const
+	{
+		return FindHandleNode(handle) != nullptr;
+	}
+
+	/// <summary>
+	/// ハンドルが指す要素のイテレータを取得
+	/// </summary>
+	/// <param name="handle">このリストのGetHandle()で取得したハンドル</param>
+	/// <returns>要素を指すイテレータ（要素が削除済みの場合は末尾イテレータ）</returns>
+	Iterator Resolve(Handle handle)
+	{
+		return Iterator(FindHandleNode(handle));
+	}
+
+	/// <summary>
+	/// ハンドルが指す要素のコンストイテレータを取得
+	/// </summary>
+	/// <param name="handle">このリストのGetHandle()で取得したハンドル</param>
+	/// <returns>要素を指すコンストイテレータ（要素が削除済みの場合は末尾コンストイテレータ）</returns>
+	ConstIterator Resolve(Handle handle) const
+	{
+		return ConstIterator(FindHandleNode(handle));
+	}
+
+	/// <summary>
+	/// リストのすべての要素を削除してメモリを解放
+	/// </summary>
+	void Clean()
+	{
+		LINKEDLIST_TRACE_SCOPE(Clean);
+
+		ReleaseAllHandles();
+		if constexpr (std::is_trivially_destructible_v<T>)
+		{
+			// デストラクタを呼ぶ必要が無く、全ノードがこのリストだけのブロックにあれば、ノードをたどらずにブロックごと解放する
+			if (mOwnsBlocks)
+			{
+				for (NodeBlock* block : mBlocks)
+				{
+					::operator delete(block);
+				}
+				mBlocks.clear();
+				mHead = nullptr;
+			}
+		}
+
+		NodeReleaser releaser;
+		PrefetchCursor<Node*> cursor(mHead, DefaultPrefetchDistance);
+		while (Node* node = cursor.Next())
+		{
+			releaser.Release(node);
+		}
+		releaser.Flush();
+		// ブロックを記録していた場合、記録はノードの解放とともにすべて消えている
+		mOwnsBlocks = true;
+		mHead = nullptr;
+		mTail = nullptr;
+		mCount = 0;
+		mTombstones = 0;
+		mRelayoutCursor = nullptr;
+	}
+
+private:
+	/// <summary>
+	/// 先読みしながらノードを先頭から1つずつ返すカーソル
+	/// 返したノードより distance 個先のノードまでを先読み済みに保つ
+	/// Next()は返すノードの次を読み終えてから返すので、返されたノードはその場で解放してよい
+	/// </summary>
+	template <typename NodePtr>
+	class PrefetchCursor
+	{
+	private:
+		NodePtr mCurrent;
+		NodePtr mAhead;
+
+	public:
+		PrefetchCursor(NodePtr start, size_t distance) : mCurrent(start), mAhead(start)
+		{
+			distance = std::min(distance, MaxPrefetchDistance);
+			for (size_t i = 0; i < distance && mAhead; i++)
+			{
+				Prefetch(mAhead);
+				mAhead = mAhead->next;
+			}
+		}
+
+		NodePtr Next()
+		{
+			NodePtr node = mCurrent;
+			if (node)
+			{
+				mCurrent = node->next;
+				if (mAhead)
+				{
+					Prefetch(mAhead);
+					mAhead = mAhead->next;
+				}
+			}
+			return node;
+		}
+	};
+
+	/// <summary>
+	/// 指定アドレスをキャッシュに先読みするようCPUに伝える（対応していない環境では何もしない）
+	/// </summary>
+	static void Prefetch(const void* address)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		__builtin_prefetch(address, 0, 3);
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+		_mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#else
+		(void)address;
+#endif
+	}
+
+	/// <summary>
+	/// ノードを配列の順に繋ぎ直す（配列はリストの全ノードを含むこと）
+	/// </summary>
+	/// <param name="items">ノードを含む配列</param>
+	/// <param name="getNode">配列の要素からノードを取り出す関数</param>
+	template <typename Item, typename GetNode>
+	void RelinkInOrder(const std::vector<Item>& items, GetNode getNode)
+	{
+		Node* prev = nullptr;
+		for (const Item& item : items)
+		{
+			Node* node = getNode(item);
+			node->prev = prev;
+			if (prev)
+			{
+				prev->next = node;
+			}
+			prev = node;
+		}
+		prev->next = nullptr;
+		mHead = getNode(items.front());
+		mTail = prev;
+	}
+
+	/// <summary>
+	/// node自身を含めてそれ以降で最初の削除済みでないノードを取得
+	/// </summary>
+	template <typename NodePtr>
+	static NodePtr NextLive(NodePtr node)
+	{
+		while (node && node->removed)
+		{
+			node = node->next;
+		}
+		return node;
+	}
+
+	/// <summary>
+	/// node自身を含めてそれ以前で最初の削除済みでないノードを取得
+	/// </summary>
+	template <typename NodePtr>
+	static NodePtr PrevLive(NodePtr node)
+	{
+		while (node && node->removed)
+		{
+			node = node->prev;
+		}
+		return node;
+	}
+
+	/// <summary>
+	/// 自動コンパクションを行うべきかどうか
+	/// </summary>
+	bool ShouldCompact() const
+	{
+		return mCompactRatio > 0.0 && mTombstones >= MinTombstonesForCompact
+			&& static_cast<double>(mTombstones) >= mCompactRatio * static_cast<double>(mTombstones + mCount);
+	}
+
+	/// <summary>
+	/// 範囲[first, last)のノードのうち、トゥームストーンと条件を満たす要素のノードを解放する
+	/// </summary>
+	/// <returns>削除した要素数（トゥームストーンは数えない）</returns>
+	template <typename Pred>
+	size_t RemoveRangeIf(Node* first, Node* last, Pred&& pred)
+	{
+		// 削除しなかった直前のノード（範囲の前のノードから始める）
+		Node* kept = first ? first->prev : mTail;
+		NodeReleaser releaser;
+		// kept の後ろを外したまま、まだ繋ぎ直していないかどうか
+		bool unlinked = false;
+		bool cursorRemoved = false;
+		size_t removedCount = 0;
+
+		// kept と next を繋いで、その間のノードをリストから外す
+		auto stitch = [this, &kept](Node* next)
+		{
+			if (kept)
+			{
+				kept->next = next;
+			}
+			else
+			{
+				mHead = next;
+			}
+			if (next)
+			{
+				next->prev = kept;
+			}
+			else
+			{
+				mTail = kept;
+			}
+		};
+
+		PrefetchCursor<Node*> cursor(first, DefaultPrefetchDistance);
+		Node* node = nullptr;
+		LINKEDLIST_TRY
+		{
+			while ((node = cursor.Next()) != last)
+			{
+				if (node->removed || pred(static_cast<const T&>(node->data)))
+				{
+					if (node->removed)
+					{
+						mTombstones--;
+					}
+					else
+					{
+						mCount--;
+						removedCount++;
+						ReleaseHandle(node);
+					}
+					cursorRemoved = cursorRemoved || node == mRelayoutCursor;
+
+					// 前後のノードはまだこのノードを指しているが、繋ぎ直すまで辿らないのでこの場で解放してよい
+					releaser.Release(node);
+					unlinked = true;
+					continue;
+				}
+
+				if (unlinked)
+				{
+					stitch(node);
+					unlinked = false;
+				}
+				if (cursorRemoved)
+				{
+					mRelayoutCursor = node;
+					cursorRemoved = false;
+				}
+				kept = node;
+			}
+		}
+		LINKEDLIST_CATCH_ALL
+		{
+			// 判定中の要素は残すので、そこまでを繋ぎ直す
+			if (unlinked)
+			{
+				stitch(node);
+			}
+			if (cursorRemoved)
+			{
+				mRelayoutCursor = node;
+			}
+			LINKEDLIST_RETHROW;
+		}
+
+		if (unlinked)
+		{
+			stitch(last);
+		}
+		if (cursorRemoved)
+		{
+			mRelayoutCursor = last;
+		}
+		return removedCount;
+	}
+
+	/// <summary>
+	/// ハンドルが指すノードを取得（無効なハンドルならnullptr）
+	/// </summary>
+	Node* FindHandleNode(Handle handle) const
+	{
+		if (handle.mSlot >= mHandleSlots.size())
+		{
+			return nullptr;
+		}
+		const HandleSlot& slot = mHandleSlots[handle.mSlot];
+		return slot.generation == handle.mGeneration ? slot.node : nullptr;
+	}
+
+	/// <summary>
+	/// ノードのハンドルのスロットを解放し、発行済みのハンドルを無効にする
+	/// </summary>
+	void ReleaseHandle(Node* node) noexcept
+	{
+		const uint32_t slot = node->handleSlot;
+		if (slot == NoHandleSlot)
+		{
+			return;
+		}
+		node->handleSlot = NoHandleSlot;
+		mHandleSlots[slot].node = nullptr;
+		mHandleSlots[slot].generation++;
+		mHandleSlots[slot].nextFree = mFreeHandleSlot;
+		mFreeHandleSlot = slot;
+	}
+
+	/// <summary>
+	/// すべてのスロットを解放し、発行済みのハンドルをすべて無効にする
+	/// </summary>
+	void ReleaseAllHandles() noexcept
+	{
+		for (HandleSlot& slot : mHandleSlots)
+		{
+			if (slot.node)
+			{
+				ReleaseHandle(slot.node);
+			}
+		}
+	}
+
+	/// <summary>
+	/// 別のリストから移してきた[first, last]のノードのうち、トゥームストーンを解放する
+	/// 遅延削除を使わないリストにトゥームストーンが残らないようにするためで、遅延削除を使うリストでは何もしない
+	/// </summary>
+	void CompactTransferred(Node* first, Node* last, size_t tombstones)
+	{
+		if (mLazyRemove || tombstones == 0)
+		{
+			return;
+		}
+
+		Node* const end = last->next;
+		Node* node = first;
+		while (node != end && tombstones > 0)
+		{
+			Node* next = node->next;
+			if (node->removed)
+			{
+				UnlinkNode(node);
+				DestroyNode(node);
+				mTombstones--;
+				tombstones--;
+			}
+			node = next;
+		}
+	}
+
+	/// <summary>
+	/// ノードを前後のノードから外す（解放はしない）
+	/// </summary>
+	void UnlinkNode(Node* node)
+	{
+		if (node == mRelayoutCursor)
+		{
+			mRelayoutCursor = node->next;
+		}
+
+		if (node->prev)
+		{
+			node->prev->next = node->next;
+		}
+		else
+		{
+			// 先頭ノードの場合
+			mHead = node->next;
+		}
+
+		if (node->next)
+		{
+			node->next->prev = node->prev;
+		}
+		else
+		{
+			// 末尾ノードの場合
+			mTail = node->prev;
+		}
+	}
+
+	/// <summary>
+	/// firstから最大maxNodes個のノードを1つのブロックに確保し直して同じ位置に繋ぎ直す
+	/// </summary>
+	/// <returns>移した範囲の次のノード</returns>
+	Node* RelocateSegment(Node* first, size_t maxNodes)
+	{
+		// 範囲の終わりと、範囲内の削除済みでないノード数を求める
+		Node* end = first;
+		size_t nodes = 0;
+		size_t live = 0;
+		while (end && nodes < maxNodes)
+		{
+			if (!end->removed)
+			{
+				live++;
+			}
+			nodes++;
+			end = end->next;
+		}
+
+		Node* before = first->prev;
+		Node* newFirst = nullptr;
+		Node* newLast = nullptr;
+		// リスト全体を移す場合は、移した後のノードがすべて新しいブロックに収まる
+		const bool whole = (first == mHead && !end);
+		if (whole)
+		{
+			mBlocks.reserve(mBlocks.size() + 1);
+		}
+		else
+		{
+			ReserveBlock();
+		}
+		if (live > 0)
+		{
+			PrefetchCursor<Node*> source(first, DefaultPrefetchDistance);
+			CreateChain(live, [&source](size_t) -> decltype(auto)
+			{
+				Node* node = source.Next();
+				while (node->removed)
+				{
+					node = source.Next();
+				}
+				return std::move_if_noexcept(node->data);
+			}, newFirst, newLast);
+		}
+
+		// 古いノードを解放する（新しいノードの構築が終わるまでは元のリストに手を付けない）
+		// ハンドルのスロットは同じ要素の新しいノードへ引き継ぐ
+		PrefetchCursor<Node*> old(first, DefaultPrefetchDistance);
+		NodeReleaser releaser;
+		Node* moved = newFirst;
+		for (size_t i = 0; i < nodes; i++)
+		{
+			Node* node = old.Next();
+			if (node->removed)
+			{
+				mTombstones--;
+			}
+			else
+			{
+				if (node->handleSlot != NoHandleSlot)
+				{
+					moved->handleSlot = node->handleSlot;
+					mHandleSlots[node->handleSlot].node = moved;
+				}
+				moved = moved->next;
+			}
+			releaser.Release(node);
+		}
+		releaser.Flush();
+
+		// 新しいブロックを記録する（リスト全体を移した場合、古いブロックの記録は解放とともに消えるか、元々記録していない）
+		if (whole)
+		{
+			DisownBlocks();
+			mOwnsBlocks = true;
+		}
+		if (newFirst)
+		{
+			RegisterBlock(newFirst->block);
+		}
+
+		// 新しいノード列を元の範囲があった場所に繋ぐ
+		if (newFirst)
+		{
+			newFirst->prev = before;
+			newLast->next = end;
+		}
+		Node* segmentHead = newFirst ? newFirst : end;
+		Node* segmentTail = newLast ? newLast : before;
+		if (before)
+		{
+			before->next = segmentHead;
+		}
+		else
+		{
+			mHead = segmentHead;
+		}
+		if (end)
+		{
+			end->prev = segmentTail;
+		}
+		else
+		{
+			mTail = segmentTail;
+		}
+
+		mLayoutVersion++;
+		return end;
+	}
+
+	/// <summary>
+	/// 空のリストにotherの全要素を複製する
+	/// </summary>
+	void CopyFrom(const LinkedList& other)
+	{
+		if constexpr (std::is_trivially_copyable_v<T>)
+		{
+			if (other.CanCopyBlocks())
+			{
+				CopyBlocksFrom(other);
+				return;
+			}
+		}
+
+		PrefetchCursor<const Node*> source(other.mHead, DefaultPrefetchDistance);
+		InsertBulk(End(), other.mCount, [&source](size_t) -> const T&
+		{
+			const Node* node = source.Next();
+			while (node->removed)
+			{
+				node = source.Next();
+			}
+			return node->data;
+		});
+	}
+
+	/// <summary>
+	/// 遅延削除とノードキャッシュの設定をotherに合わせる
+	/// </summary>
+	void CopySettings(const LinkedList& other) noexcept
+	{
+		mLazyRemove = other.mLazyRemove;
+		mNodeCache = other.mNodeCache;
+		mCompactRatio = other.mCompactRatio;
+	}
+
+	/// <summary>
+	/// otherのノードをブロックの配列ごと複製できるか
+	/// 全ノードがotherだけのブロックにあり、ブロックに解放済みのノードもトゥームストーンも無い場合に限る
+	/// </summary>
+	bool CanCopyBlocks() const
+	{
+		if (!mOwnsBlocks || mTombstones > 0 || mCount == 0)
+		{
+			return false;
+		}
+		size_t nodes = 0;
+		for (const NodeBlock* block : mBlocks)
+		{
+			nodes += block->capacity;
+		}
+		return nodes == mCount;
+	}
+
+	/// <summary>
+	/// 空のリストにotherの全ノードを複製する（Tが trivially copyable の場合）
+	/// ノードをたどらず、otherの各ブロックのノード配列を1つの新しいブロックへmemcpyしてから、前後のリンクを新しいブロック内の位置に置き換える
+	/// </summary>
+	void CopyBlocksFrom(const LinkedList& other)
+	{
+		static_assert(std::is_trivially_copyable_v<Node>, "Node must be trivially copyable");
+
+		// コピー元のブロックのノード配列をアドレス順に並べ、リンクの置き換え先を二分探索できるようにする
+		// 置き換えはノード配列の先頭どうしのアドレスの差（バイト数）を足すだけで済ませる
+		struct Range
+		{
+			uintptr_t begin;
+			uintptr_t end;
+			uintptr_t delta;
+		};
+		std::vector<Range> ranges;
+		ranges.reserve(other.mBlocks.size());
+		ReserveBlock();
+
+		const size_t count = other.mCount;
+		char* memory = static_cast<char*>(::operator new(BlockHeaderSize + sizeof(Node) * count));
+		NodeBlock* block = new (memory) NodeBlock{ count, count, nullptr, 0 };
+		Node* nodes = reinterpret_cast<Node*>(memory + BlockHeaderSize);
+
+		size_t offset = 0;
+		for (const NodeBlock* source : other.mBlocks)
+		{
+			const uintptr_t begin = reinterpret_cast<uintptr_t>(source) + BlockHeaderSize;
+			ranges.push_back({ begin, begin + sizeof(Node) * source->capacity, reinterpret_cast<uintptr_t>(nodes + offset) - begin });
+			offset += source->capacity;
+		}
+		std::sort(ranges.begin(), ranges.end(), [](const Range& a, const Range& b) { return a.begin < b.begin; });
+
+		auto translate = [&ranges](Node* node) -> Node*
+		{
+			if (!node)
+			{
+				return nullptr;
+			}
+			const uintptr_t address = reinterpret_cast<uintptr_t>(node);
+			auto range = ranges.begin();
+			if (ranges.size() > 1)
+			{
+				range = std::upper_bound(ranges.begin(), ranges.end(), address, [](uintptr_t value, const Range& r) { return value < r.begin; }) - 1;
+			}
+			return reinterpret_cast<Node*>(address + range->delta);
+		};
+
+		// キャッシュに載っている間にリンクを置き換えられるよう、少しずつコピーしてはその分を置き換える
+		constexpr size_t Batch = 256;
+		offset = 0;
+		for (const NodeBlock* source : other.mBlocks)
+		{
+			const Node* begin = reinterpret_cast<const Node*>(reinterpret_cast<const char*>(source) + BlockHeaderSize);
+			for (size_t done = 0; done < source->capacity; done += Batch)
+			{
+				const size_t size = std::min(Batch, source->capacity - done);
+				Node* copied = nodes + offset + done;
+				std::memcpy(static_cast<void*>(copied), begin + done, sizeof(Node) * size);
+				for (size_t i = 0; i < size; i++)
+				{
+					copied[i].prev = translate(copied[i].prev);
+					copied[i].next = translate(copied[i].next);
+					copied[i].block = block;
+					copied[i].handleSlot = NoHandleSlot;
+				}
+			}
+			offset += source->capacity;
+		}
+
+		mHead = translate(other.mHead);
+		mTail = translate(other.mTail);
+		mCount = count;
+		RegisterBlock(block);
+	}
+
+	/// <summary>
+	/// 次に作るブロックを記録できるよう、mBlocksに1つ分の領域を確保しておく（記録しない状態なら何もしない）
+	/// </summary>
+	void ReserveBlock()
+	{
+		if (mOwnsBlocks)
+		{
+			mBlocks.reserve(mBlocks.size() + 1);
+		}
+	}
+
+	/// <summary>
+	/// このリストだけにノードを置く新しいブロックを記録する（ReserveBlock()で領域を確保してから呼ぶ）
+	/// </summary>
+	void RegisterBlock(NodeBlock* block) noexcept
+	{
+		if (mOwnsBlocks)
+		{
+			block->owner = this;
+			block->ownerIndex = mBlocks.size();
+			mBlocks.push_back(block);
+		}
+	}
+
+	/// <summary>
+	/// ブロックの記録をやめる（以降はノードを1つずつたどって解放する）
+	/// </summary>
+	void DisownBlocks() noexcept
+	{
+		for (NodeBlock* block : mBlocks)
+		{
+			block->owner = nullptr;
+		}
+		mBlocks.clear();
+		mOwnsBlocks = false;
+	}
+
+	/// <summary>
+	/// mBlocksの各ブロックの記録先をこのリストに合わせる（ムーブや入れ替えの後に呼ぶ）
+	/// </summary>
+	void AdoptBlocks() noexcept
+	{
+		for (NodeBlock* block : mBlocks)
+		{
+			block->owner = this;
+		}
+	}
+
+	/// <summary>
+	/// otherの全ノードを受け取る前に、otherのブロックの記録を引き継ぐ（どちらかが記録していなければ記録をやめる）
+	/// </summary>
+	void TakeBlocks(LinkedList& other) noexcept
+	{
+		if (mOwnsBlocks && other.mOwnsBlocks)
+		{
+			LINKEDLIST_TRY
+			{
+				mBlocks.reserve(mBlocks.size() + other.mBlocks.size());
+			}
+			LINKEDLIST_CATCH_ALL
+			{
+				// 記録する領域を確保できなくても、記録をやめれば受け取れる
+				DisownBlocks();
+			}
+		}
+
+		if (mOwnsBlocks && other.mOwnsBlocks)
+		{
+			for (NodeBlock* block : other.mBlocks)
+			{
+				RegisterBlock(block);
+			}
+		}
+		else
+		{
+			DisownBlocks();
+		}
+		other.mBlocks.clear();
+		other.mOwnsBlocks = true;
+	}
+
+	/// <summary>
+	/// 空になったブロックを解放する（記録しているリストがあれば記録から外す）
+	/// </summary>
+	static void FreeBlock(NodeBlock* block) noexcept
+	{
+		if (LinkedList* owner = block->owner)
+		{
+			NodeBlock* moved = owner->mBlocks.back();
+			moved->ownerIndex = block->ownerIndex;
+			owner->mBlocks[block->ownerIndex] = moved;
+			owner->mBlocks.pop_back();
+		}
+		::operator delete(block);
+	}
+
+	/// <summary>
+	/// ノードのデストラクタを呼ぶ（Tが trivially destructible なら何もしない）
+	/// </summary>
+	static void DestructNode(Node* node)
+	{
+		if constexpr (!std::is_trivially_destructible_v<T>)
+		{
+			node->~Node();
+		}
+		else
+		{
+			(void)node;
+		}
+	}
+
+	/// <summary>
+	/// ノードを破棄してメモリを解放
+	/// まとめて確保されたノードは、ブロック内の全ノードが解放された時点でブロックごと解放する
+	/// </summary>
+	static void DestroyNode(Node* node)
+	{
+		if (node->cached)
+		{
+			DestructNode(node);
+			Cache::Deallocate(node);
+			return;
+		}
+
+		NodeBlock* block = node->block;
+		if (!block)
+		{
+			delete node;
+			return;
+		}
+
+		DestructNode(node);
+		if (block->liveCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			FreeBlock(block);
+		}
+	}
+
+	/// <summary>
+	/// ノードを1つ確保して値をコピーする（ノードキャッシュを使う設定ならキャッシュから確保する）
+	/// </summary>
+	Node* NewNode(const T& value)
+	{
+		if (!mNodeCache)
+		{
+			return new Node(value);
+		}
+
+		void* memory = Cache::Allocate();
+		Node* node = nullptr;
+		LINKEDLIST_TRY
+		{
+			node = new (memory) Node(value);
+		}
+		LINKEDLIST_CATCH_ALL
+		{
+			Cache::Deallocate(memory);
+			LINKEDLIST_RETHROW;
+		}
+		node->cached = true;
+		return node;
+	}
+
+	/// <summary>
+	/// ノードを続けて解放するクラス
+	/// 同じブロックのノードが続く間は残りのノード数の更新をまとめ、ブロックを解放するかどうかはブロックが変わるときと破棄時にだけ判定する
+	/// </summary>
+	class NodeReleaser
+	{
+	private:
+		NodeBlock* mBlock;
+		size_t mReleased;
+
+	public:
+		NodeReleaser() : mBlock(nullptr), mReleased(0)
+		{
+		}
+
+		NodeReleaser(const NodeReleaser&) = delete;
+		NodeReleaser& operator=(const NodeReleaser&) = delete;
+
+		~NodeReleaser()
+		{
+			Flush();
+		}
+
+		/// <summary>
+		/// ノードを解放する（ブロックの領域は同じブロックのノードが続く間は解放しない）
+		/// </summary>
+		void Release(Node* node)
+		{
+			if (node->cached || !node->block)
+			{
+				DestroyNode(node);
+				return;
+			}
+			if (node->block != mBlock)
+			{
+				Flush();
+				mBlock = node->block;
+			}
+			DestructNode(node);
+			mReleased++;
+		}
+
+		/// <summary>
+		/// まとめておいた分をブロックの残りのノード数に反映し、空になったブロックを解放する
+		/// </summary>
+		void Flush()
+		{
+			if (mBlock && mBlock->liveCount.fetch_sub(mReleased, std::memory_order_acq_rel) == mReleased)
+			{
+				FreeBlock(mBlock);
+			}
+			mBlock = nullptr;
+			mReleased = 0;
+		}
+	};
+
+	/// <summary>
+	/// count個(1以上)のノードを1つのブロックに構築し、互いに連結する
+	/// </summary>
+	template <typename Generator>
+	static void CreateChain(size_t count, Generator&& generate, Node*& first, Node*& last)
+	{
+		char* memory = static_cast<char*>(::operator new(BlockHeaderSize + sizeof(Node) * count));
+		NodeBlock* block = new (memory) NodeBlock{ 0, count, nullptr, 0 };
+		Node* nodes = reinterpret_cast<Node*>(memory + BlockHeaderSize);
+
+		if constexpr (std::is_trivially_copyable_v<T>)
+		{
+			// 値のコピーは例外を送出しないので、前後のリンクを添字から求め、各ノードを1回の書き込みで構築する
+			LINKEDLIST_TRY
+			{
+				for (size_t i = 0; i < count; i++)
+				{
+					new (nodes + i) Node(generate(i), i > 0 ? nodes + i - 1 : nullptr, i + 1 < count ? nodes + i + 1 : nullptr, block);
+				}
+			}
+			LINKEDLIST_CATCH_ALL
+			{
+				// 例外を送出し得るのは値の生成だけで、構築済みのノードは破棄の必要が無い
+				::operator delete(memory);
+				LINKEDLIST_RETHROW;
+			}
+			block->liveCount.store(count, std::memory_order_relaxed);
+			first = nodes;
+			last = nodes + count - 1;
+			return;
+		}
+
+		Node* prev = nullptr;
+		size_t constructed = 0;
+		LINKEDLIST_TRY
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				Node* node = new (nodes + i) Node(generate(i));
+				node->block = block;
+				node->prev = prev;
+				if (prev)
+				{
+					prev->next = node;
+				}
+				prev = node;
+				constructed++;
+			}
+		}
+		LINKEDLIST_CATCH_ALL
+		{
+			// 構築済みのノードを破棄してから例外を再送出
+			for (size_t i = 0; i < constructed; i++)
+			{
+				DestructNode(nodes + i);
+			}
+			::operator delete(memory);
+			LINKEDLIST_RETHROW;
+		}
+		block->liveCount.store(count, std::memory_order_relaxed);
+
+		first = nodes;
+		last = prev;
+	}
+
+	/// <summary>
+	/// 連結済みのノード列をpositionの前（nullptrなら末尾）に繋ぐ
+	/// </summary>
+	void LinkChain(Node* position, Node* first, Node* last, size_t count)
+	{
+		if (!position)
+		{
+			first->prev = mTail;
+			last->next = nullptr;
+			if (mTail)
+			{
+				mTail->next = first;
+			}
+			else
+			{
+				mHead = first;
+			}
+			mTail = last;
+		}
+		else
+		{
+			first->prev = position->prev;
+			last->next = position;
+			if (position->prev)
+			{
+				position->prev->next = first;
+			}
+			else
+			{
+				mHead = first;
+			}
+			position->prev = last;
+		}
+		mCount += count;
 	}
 };
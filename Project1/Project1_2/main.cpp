@@ -1,50 +1,102 @@
-﻿#include <fstream>
-#include <iostream>
-#include <sstream>
+﻿#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <string>
 
+#include "externalSort.h"
 #include "linkedList.h"
 #include "playerScore.h"
+#include "scoreFollower.h"
+#include "scoreIngest.h"
+#include "scoreWriter.h"
 
 
-int main()
+int main(int argc, char* argv[])
 {
-	auto linkedList = new LinkedList<PlayerScore>();
-
-	std::ifstream file("Scores.txt");
-
-	// スコアファイルを開く
-	if (!file.is_open())
+	// --sort <入力> <出力> [メモリ上限(MB)] 指定時は、メモリに収まらないファイルも外部ソートでスコア順に並べ替えて書き出す
+	if (argc > 3 && std::strcmp(argv[1], "--sort") == 0)
 	{
-		return 1;
+		ExternalSortOptions options;
+		if (argc > 4)
+		{
+			// 数字以外を含む値や0、桁あふれする値は受け付けない
+			size_t megabytes = 0;
+			const char* end = argv[4] + std::strlen(argv[4]);
+			const auto parsed = std::from_chars(argv[4], end, megabytes);
+			if (parsed.ec != std::errc() || parsed.ptr != end || megabytes == 0 || megabytes > (SIZE_MAX >> 20))
+			{
+				std::fprintf(stderr, "--sort: invalid memory budget (MB): %s\n", argv[4]);
+				return 1;
+			}
+			options.memoryBudget = megabytes << 20;
+		}
+		return ExternalSortScores(argv[2], argv[3], options) ? 0 : 1;
 	}
 
-	// ファイルから1行ずつ読み込み
-	std::string line;
-	while (std::getline(file, line))
-	{
-		std::stringstream info(line);
+	// --follow 指定時はファイルへの追記を監視し、追加された行だけを読み込んで出力し続ける
+	const bool follow = (argc > 1 && std::strcmp(argv[1], "--follow") == 0);
 
-		std::string scoreStr;
-		std::string id;
+	LinkedList<PlayerScore> linkedList;
+
+	if (!follow)
+	{
+		// 読み込み・解析・リストへの追加を並行に行ってスコアファイルを取り込む
+		// 解析できない行は行番号と理由を標準エラー出力へ書き出して読み飛ばす
+		ScoreIngestPipeline ingest;
+		auto loaded = ingest.TryRun("Scores.txt", linkedList, [](const ScoreError& error)
+		{
+			std::fprintf(stderr, "Scores.txt:%zu: %s\n", error.line, ToString(error.reason));
+			return ScoreErrorAction::Skip;
+		});
+		if (!loaded)
+		{
+			std::fprintf(stderr, "Scores.txt: %s\n", ToString(loaded.Error().reason));
+			return 1;
+		}
 
-		std::getline(info, scoreStr, '	');
-		std::getline(info, id);
+		// 1行ごとにフラッシュせず、まとめて標準出力へ書き出す
+		{
+			ScoreWriter writer(stdout);
+			writer.WriteAll(linkedList);
+		}
 
-		auto playerScore = PlayerScore(std::stoi(scoreStr), id);
+#ifdef LINKEDLIST_TRACING
+		// 計測を有効にしてビルドした場合は、操作ごとの処理時間の集計を書き出す
+		LatencyTracer::Instance().WriteSummary("Latency.tsv");
+#endif
 
-		// PlayerScoreを作成してリストに追加
-		linkedList->Insert(linkedList->End(), playerScore);
+		return 0;
 	}
 
-	file.close();
+	ScoreFileFollower follower("Scores.txt");
+	ScoreWriter writer(stdout);
 
-	for (auto it = linkedList->CBegin(); it != linkedList->CEnd(); ++it)
-	{
-		std::cout << "Score: " << it->score << "	ID: " << it->id << std::endl;
-	}
+	// 出力済みの最後の要素
+	auto printed = linkedList.End();
 
-	delete linkedList;
+	while (true)
+	{
+		// 追加された要素だけを出力する
+		const size_t added = follower.Poll(linkedList);
+		if (follower.Reloaded())
+		{
+			// ファイルが作り直されたため、リストは空にされ、先頭から読み直された
+			printed = linkedList.End();
+		}
+		if (added > 0)
+		{
+			auto it = (printed == linkedList.End()) ? linkedList.Begin() : ++printed;
+			for (; it != linkedList.End(); ++it)
+			{
+				writer.Write(*it);
+				printed = it;
+			}
+			writer.Flush();
+		}
 
-	return 0;
+		follower.WaitForChange(std::chrono::seconds(1));
+	}
 }
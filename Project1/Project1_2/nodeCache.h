@@ -0,0 +1,238 @@
+#pragma once
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "errorPolicy.h"
+
+/// <summary>
+/// 同じ大きさの領域（リストのノード）を使い回すスレッドセーフなアロケータ
+/// スレッドごとに空き領域の束（マガジン）を2つ持ち、確保と解放はほとんどの場合そのスレッドのマガジンだけで済ませる
+/// マガジンを使い切った、または一杯にした場合だけ、共有の置き場（デポ）とマガジン単位でまとめてやり取りする
+/// デポにも空き領域が無い場合は、MagazineSize個分の領域（スラブ）をまとめて確保する
+/// 確保したスレッドと別のスレッドで解放してよい（解放したスレッドのマガジンに入る）
+/// 解放された領域はOSへは返さず、プロセスの終了まで使い回す
+/// </summary>
+/// <typeparam name="Size">1つの領域のバイト数</typeparam>
+/// <typeparam name="Align">領域のアライメント（alignof(std::max_align_t)以下）</typeparam>
+template <size_t Size, size_t Align>
+class NodeCache
+{
+public:
+	// 1つのマガジンに入る領域の数（デポとのやり取りやスラブの確保はこの単位で行う）
+	static constexpr size_t MagazineSize = 64;
+
+	static_assert(Align <= alignof(std::max_align_t), "over-aligned nodes are not supported");
+
+	/// <summary>
+	/// 領域を1つ確保
+	/// </summary>
+	/// <returns>Sizeバイトの未初期化の領域</returns>
+	static void* Allocate()
+	{
+		ThreadCache& cache = Local();
+		if (!cache.loaded || cache.loaded->count == 0)
+		{
+			Reload(cache);
+		}
+		return cache.loaded->items[--cache.loaded->count];
+	}
+
+	/// <summary>
+	/// Allocate()で確保した領域を返す（どのスレッドから呼んでもよい）
+	/// </summary>
+	/// <param name="pointer">返す領域</param>
+	static void Deallocate(void* pointer)
+	{
+		ThreadCache& cache = Local();
+		if (!cache.loaded || cache.loaded->count == MagazineSize)
+		{
+			Unload(cache);
+		}
+		cache.loaded->items[cache.loaded->count++] = pointer;
+	}
+
+	/// <summary>
+	/// デポに置かれている空き領域の数を取得（各スレッドが手元のマガジンに持っている空き領域は含まない）
+	/// </summary>
+	static size_t DepotFreeCount()
+	{
+		Depot& depot = GetDepot();
+		std::lock_guard<std::mutex> lock(depot.mutex);
+		size_t count = 0;
+		for (const Magazine* magazine : depot.filled)
+		{
+			count += magazine->count;
+		}
+		return count;
+	}
+
+private:
+	// 1つの領域の大きさ
+	static constexpr size_t SlotSize = (Size + Align - 1) / Align * Align;
+
+	// 空き領域の束
+	struct Magazine
+	{
+		size_t count;
+		void* items[MagazineSize];
+	};
+
+	// スレッド間で共有する置き場
+	struct Depot
+	{
+		std::mutex mutex;
+		// 空き領域が1つ以上入ったマガジン
+		std::vector<Magazine*> filled;
+		// 空のマガジン
+		std::vector<Magazine*> empty;
+	};
+
+	// スレッドごとのマガジン（loadedから確保・解放し、previousは直前に使っていたマガジン）
+	// スレッドの終了処理の後に呼ばれても使えるよう、デストラクタを持たせない
+	struct ThreadCache
+	{
+		Magazine* loaded = nullptr;
+		Magazine* previous = nullptr;
+	};
+
+	// スレッドの終了時に、手元のマガジンをデポへ返して他のスレッドが使えるようにするクラス
+	struct ThreadCacheRetirer
+	{
+		ThreadCache* cache;
+
+		~ThreadCacheRetirer()
+		{
+			Depot& depot = GetDepot();
+			std::lock_guard<std::mutex> lock(depot.mutex);
+			for (Magazine* magazine : { cache->loaded, cache->previous })
+			{
+				if (magazine)
+				{
+					(magazine->count > 0 ? depot.filled : depot.empty).push_back(magazine);
+				}
+			}
+			cache->loaded = nullptr;
+			cache->previous = nullptr;
+		}
+	};
+
+	/// <summary>
+	/// 共有の置き場を取得
+	/// 静的なオブジェクトの破棄中にもノードが返ってくる場合があるので、置き場は破棄しない
+	/// </summary>
+	static Depot& GetDepot()
+	{
+		static Depot* depot = new Depot();
+		return *depot;
+	}
+
+	/// <summary>
+	/// このスレッドのマガジンを取得
+	/// </summary>
+	static ThreadCache& Local()
+	{
+		thread_local ThreadCache cache;
+		thread_local ThreadCacheRetirer retirer{ &cache };
+		return cache;
+	}
+
+	/// <summary>
+	/// 空き領域のあるマガジンをloadedに用意する
+	/// </summary>
+	static void Reload(ThreadCache& cache)
+	{
+		if (cache.previous && cache.previous->count > 0)
+		{
+			std::swap(cache.loaded, cache.previous);
+			return;
+		}
+
+		Depot& depot = GetDepot();
+		Magazine* refill = nullptr;
+		{
+			std::lock_guard<std::mutex> lock(depot.mutex);
+			if (!depot.filled.empty())
+			{
+				refill = depot.filled.back();
+				depot.filled.pop_back();
+			}
+		}
+		if (!refill)
+		{
+			refill = AllocateSlab();
+		}
+
+		// 使い切ったマガジンはpreviousに残し、それまでのpreviousはデポへ返す
+		if (cache.previous)
+		{
+			std::lock_guard<std::mutex> lock(depot.mutex);
+			depot.empty.push_back(cache.previous);
+		}
+		cache.previous = cache.loaded;
+		cache.loaded = refill;
+	}
+
+	/// <summary>
+	/// 空きのあるマガジンをloadedに用意する
+	/// </summary>
+	static void Unload(ThreadCache& cache)
+	{
+		if (cache.previous && cache.previous->count < MagazineSize)
+		{
+			std::swap(cache.loaded, cache.previous);
+			return;
+		}
+
+		// 一杯のpreviousをデポへ置き、代わりに空のマガジンを受け取る
+		Depot& depot = GetDepot();
+		Magazine* empty = nullptr;
+		{
+			std::lock_guard<std::mutex> lock(depot.mutex);
+			if (!depot.empty.empty())
+			{
+				empty = depot.empty.back();
+				depot.empty.pop_back();
+			}
+		}
+		if (!empty)
+		{
+			empty = new Magazine{ 0, {} };
+		}
+		if (cache.previous)
+		{
+			std::lock_guard<std::mutex> lock(depot.mutex);
+			depot.filled.push_back(cache.previous);
+		}
+		cache.previous = cache.loaded;
+		cache.loaded = empty;
+	}
+
+	/// <summary>
+	/// スラブを確保し、その領域をすべて入れたマガジンを作る
+	/// </summary>
+	static Magazine* AllocateSlab()
+	{
+		Magazine* magazine = new Magazine{ 0, {} };
+		char* slab = nullptr;
+		LINKEDLIST_TRY
+		{
+			slab = static_cast<char*>(::operator new(SlotSize * MagazineSize));
+		}
+		LINKEDLIST_CATCH_ALL
+		{
+			delete magazine;
+			LINKEDLIST_RETHROW;
+		}
+
+		// 先頭の領域から順に取り出されるよう、逆順に入れる
+		for (size_t i = 0; i < MagazineSize; i++)
+		{
+			magazine->items[i] = slab + SlotSize * (MagazineSize - 1 - i);
+		}
+		magazine->count = MagazineSize;
+		return magazine;
+	}
+};
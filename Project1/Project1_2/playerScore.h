@@ -1,4 +1,8 @@
 #pragma once
+#include <string>
+#include <utility>
+
+#include "intrusiveList.h"
 
 struct PlayerScore
 {
@@ -6,7 +10,27 @@ struct PlayerScore
 	std::string id;
 
 
-	PlayerScore(int score, std::string id) : score(score), id(id)
+	PlayerScore(int score, std::string id) : score(score), id(std::move(id))
 	{
 	}
 };
+
+/// <summary>
+/// IntrusiveListに繋ぐためのフックを埋め込んだPlayerScore
+/// プレイヤーの一覧などに置いたまま、コピーせずにランキングと更新待ちの2つのリストへ同時に繋げられる
+/// </summary>
+struct PlayerScoreEntry : PlayerScore
+{
+	ListHook<PlayerScoreEntry> rankingHook;
+	ListHook<PlayerScoreEntry> updateHook;
+
+
+	PlayerScoreEntry(int score, std::string id) : PlayerScore(score, std::move(id))
+	{
+	}
+};
+
+// スコア順のランキングなどに使うリスト
+using PlayerRankingList = IntrusiveList<PlayerScoreEntry, &PlayerScoreEntry::rankingHook>;
+// 更新待ちのプレイヤーを繋ぐリスト
+using PlayerUpdateList = IntrusiveList<PlayerScoreEntry, &PlayerScoreEntry::updateHook>;
@@ -0,0 +1,312 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "linkedList.h"
+#include "playerScore.h"
+#include "scoreLoader.h"
+
+/// <summary>
+/// 追記され続けるスコアファイルを追従して読み込むクラス
+/// 最後に解析し終えた行の終端オフセットを覚えておき、Poll()ではそれ以降に追記された分だけを解析する
+/// ファイルが切り詰められたり、別のファイルに置き換えられたり（ローテーション）した場合は、リストを空にして先頭から読み直す
+/// </summary>
+class ScoreFileFollower
+{
+public:
+	/// <summary>
+	/// 追従するファイルを指定して作成（この時点ではまだ読み込まない）
+	/// </summary>
+	/// <param name="path">スコアファイルのパス</param>
+	/// <param name="pollInterval">変更通知が使えない環境での確認間隔</param>
+	explicit ScoreFileFollower(const std::string& path,
+		std::chrono::milliseconds pollInterval = std::chrono::milliseconds(200))
+		: mPath(path), mOffset(0), mPollInterval(pollInterval), mBuffer(ReadChunkSize), mObserved(), mFollowing(), mReloaded(false)
+	{
+#ifdef __linux__
+		// ファイルを置き換えられても追従できるよう、ファイルではなくディレクトリを監視し、イベントをファイル名で絞り込む
+		const size_t slash = mPath.rfind('/');
+		const std::string directory = (slash == std::string::npos) ? "." : (slash == 0 ? "/" : mPath.substr(0, slash));
+		mFileName = (slash == std::string::npos) ? mPath : mPath.substr(slash + 1);
+
+		mNotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		mWatch = -1;
+		if (mNotifyFd >= 0)
+		{
+			mWatch = inotify_add_watch(mNotifyFd, directory.c_str(),
+				IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_ATTRIB);
+		}
+#endif
+	}
+
+	ScoreFileFollower(const ScoreFileFollower&) = delete;
+	ScoreFileFollower& operator=(const ScoreFileFollower&) = delete;
+
+	~ScoreFileFollower()
+	{
+#ifdef __linux__
+		if (mNotifyFd >= 0)
+		{
+			close(mNotifyFd);
+		}
+#endif
+	}
+
+	/// <summary>
+	/// 前回以降に追記された完全な行を解析してリスト末尾に追加
+	/// 改行で終わっていない末尾の行は、次回のPoll()で改行が届いてから解析する
+	/// ファイルが前回より短くなっていた、または別のファイルに置き換えられていた場合は、リストを空にして先頭から読み直す
+	/// （読み直したかどうかはReloaded()で分かる。その場合、リストを指していたイテレータは無効になる）
+	/// </summary>
+	/// <param name="list">追加先のリスト（このファイルの内容だけを持つこと）</param>
+	/// <returns>追加した要素数</returns>
+	size_t Poll(LinkedList<PlayerScore>& list)
+	{
+		mReloaded = false;
+
+		// 読み込み中の追記を取りこぼさないよう、読み込む前の状態を記録する
+		mObserved = Observe();
+		if (!mObserved.exists)
+		{
+			return 0;
+		}
+
+		const bool replaced = mFollowing.exists && !mObserved.SameFile(mFollowing);
+		mFollowing = mObserved;
+		if (replaced || mObserved.size < mOffset)
+		{
+			// 切り詰め・作り直し・置き換えられた
+			list.Clean();
+			mOffset = 0;
+			mReloaded = true;
+		}
+		if (mObserved.size == mOffset)
+		{
+			return 0;
+		}
+
+		std::ifstream file(mPath, std::ios::binary);
+		if (!file.is_open())
+		{
+			return 0;
+		}
+
+		file.seekg(static_cast<std::streamoff>(mOffset));
+
+		const size_t before = list.Count();
+		size_t pending = 0;
+		while (true)
+		{
+			if (pending == mBuffer.size())
+			{
+				// 1行がバッファより長い場合のみ拡張する
+				mBuffer.resize(mBuffer.size() * 2);
+			}
+
+			file.read(mBuffer.data() + pending, static_cast<std::streamsize>(mBuffer.size() - pending));
+			const size_t size = pending + static_cast<size_t>(file.gcount());
+
+			const size_t consumed = ParseScoreLines(mBuffer.data(), size, list, false);
+			mOffset += consumed;
+			pending = size - consumed;
+
+			if (!file)
+			{
+				break;
+			}
+			std::copy(mBuffer.begin() + consumed, mBuffer.begin() + size, mBuffer.begin());
+		}
+
+		return list.Count() - before;
+	}
+
+	/// <summary>
+	/// ファイルが変更されるまで待機
+	/// Linuxではディレクトリをinotifyで監視し、それ以外の環境や監視に失敗した場合は、
+	/// 前回のPoll()の時点からファイルのサイズ・更新日時・実体が変わったかを定期的に確認する
+	/// （改行で終わっていない行が末尾に残っていても、ファイルが変わらない限り待ち続ける）
+	/// </summary>
+	/// <param name="timeout">最大待機時間</param>
+	/// <returns>変更があった（可能性がある）場合はtrue、タイムアウトした場合はfalse</returns>
+	bool WaitForChange(std::chrono::milliseconds timeout)
+	{
+		const auto deadline = std::chrono::steady_clock::now() + timeout;
+#ifdef __linux__
+		if (mWatch >= 0)
+		{
+			while (true)
+			{
+				const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+				pollfd fds = { mNotifyFd, POLLIN, 0 };
+				if (remaining.count() <= 0 || poll(&fds, 1, static_cast<int>(remaining.count())) <= 0)
+				{
+					return false;
+				}
+				if (ReadNotifications())
+				{
+					return true;
+				}
+			}
+		}
+#endif
+		while (std::chrono::steady_clock::now() < deadline)
+		{
+			if (Observe() != mObserved)
+			{
+				return true;
+			}
+			std::this_thread::sleep_for(mPollInterval);
+		}
+		return Observe() != mObserved;
+	}
+
+	/// <summary>
+	/// 直前のPoll()で、ファイルが切り詰められた・置き換えられたためにリストを空にして先頭から読み直したか
+	/// </summary>
+	bool Reloaded() const
+	{
+		return mReloaded;
+	}
+
+	/// <summary>
+	/// 最後に解析し終えた行の終端のバイトオフセットを取得
+	/// </summary>
+	/// <returns>バイトオフセット</returns>
+	uint64_t Offset() const
+	{
+		return mOffset;
+	}
+
+private:
+	static constexpr size_t ReadChunkSize = 1 << 16;
+
+	// ある時点でのファイルの状態
+	struct FileState
+	{
+		bool exists = false;
+		uint64_t size = 0;
+		// 更新日時（単位は環境による）
+		int64_t modified = 0;
+		// ファイルの実体を識別する値（置き換えられると変わる）
+		uint64_t volume = 0;
+		uint64_t index = 0;
+
+		bool SameFile(const FileState& other) const
+		{
+			return volume == other.volume && index == other.index;
+		}
+
+		bool operator==(const FileState& other) const
+		{
+			return exists == other.exists && size == other.size && modified == other.modified && SameFile(other);
+		}
+
+		bool operator!=(const FileState& other) const
+		{
+			return !(*this == other);
+		}
+	};
+
+	std::string mPath;
+	uint64_t mOffset;
+	std::chrono::milliseconds mPollInterval;
+	std::vector<char> mBuffer;
+	// 最後のPoll()の開始時に観測したファイルの状態
+	FileState mObserved;
+	// mOffsetが指しているファイルの状態（まだ読んでいなければexistsがfalse）
+	FileState mFollowing;
+	bool mReloaded;
+#ifdef __linux__
+	std::string mFileName;
+	int mNotifyFd;
+	int mWatch;
+
+	/// <summary>
+	/// 溜まっているイベントをすべて読み、追従しているファイルに関するものがあったかを返す
+	/// </summary>
+	bool ReadNotifications()
+	{
+		alignas(inotify_event) char events[4096];
+		bool relevant = false;
+		ssize_t length;
+		while ((length = read(mNotifyFd, events, sizeof(events))) > 0)
+		{
+			for (ssize_t offset = 0; offset < length;)
+			{
+				const inotify_event* event = reinterpret_cast<const inotify_event*>(events + offset);
+				if ((event->mask & IN_Q_OVERFLOW) || (event->len > 0 && mFileName == event->name))
+				{
+					relevant = true;
+				}
+				offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+			}
+		}
+		return relevant;
+	}
+#endif
+
+	/// <summary>
+	/// 現在のファイルの状態を取得
+	/// </summary>
+	FileState Observe() const
+	{
+		FileState state;
+#ifdef _WIN32
+		HANDLE file = CreateFileA(mPath.c_str(), 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			return state;
+		}
+		BY_HANDLE_FILE_INFORMATION info;
+		if (GetFileInformationByHandle(file, &info))
+		{
+			state.exists = true;
+			state.size = (static_cast<uint64_t>(info.nFileSizeHigh) << 32) | info.nFileSizeLow;
+			state.modified = static_cast<int64_t>((static_cast<uint64_t>(info.ftLastWriteTime.dwHighDateTime) << 32) | info.ftLastWriteTime.dwLowDateTime);
+			state.volume = info.dwVolumeSerialNumber;
+			state.index = (static_cast<uint64_t>(info.nFileIndexHigh) << 32) | info.nFileIndexLow;
+		}
+		CloseHandle(file);
+#else
+		struct stat info;
+		if (stat(mPath.c_str(), &info) != 0)
+		{
+			return state;
+		}
+		state.exists = true;
+		state.size = static_cast<uint64_t>(info.st_size);
+#ifdef __linux__
+		state.modified = static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+#else
+		state.modified = static_cast<int64_t>(info.st_mtime);
+#endif
+		state.volume = static_cast<uint64_t>(info.st_dev);
+		state.index = static_cast<uint64_t>(info.st_ino);
+#endif
+		return state;
+	}
+};
@@ -0,0 +1,238 @@
+#pragma once
+#include <cstddef>
+#include <map>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "errorPolicy.h"
+#include "linkedList.h"
+#include "playerScore.h"
+
+/// <summary>
+/// スコアの範囲とIDの前方一致で要素を検索できるPlayerScoreのリスト
+/// リスト本体に加えて、スコア順とID順の2つの索引を持ち、Insert/Remove/UpdateScoreのたびに更新する
+/// 検索は索引を二分探索してから該当する要素だけを辿るため、コストは O(log n + 結果の件数)
+/// 索引が壊れないよう、要素のscoreはUpdateScore()でのみ変更し、idは変更しないこと
+/// </summary>
+class IndexedScoreList
+{
+public:
+	using Iterator = LinkedList<PlayerScore>::Iterator;
+	using ConstIterator = LinkedList<PlayerScore>::ConstIterator;
+
+	IndexedScoreList() = default;
+
+	// 索引がリストのノードを直接指しているため、コピーは許可しない
+	IndexedScoreList(const IndexedScoreList&) = delete;
+	IndexedScoreList& operator=(const IndexedScoreList&) = delete;
+
+	/// <summary>
+	/// イテレータが指す位置の前に要素を挿入し、索引に登録
+	/// </summary>
+	/// <param name="it">挿入位置を指すイテレータ</param>
+	/// <param name="value">挿入する値</param>
+	/// <returns>挿入された要素を指すイテレータ</returns>
+	Iterator Insert(Iterator it, const PlayerScore& value)
+	{
+		Iterator inserted = mList.Insert(it, value);
+		LINKEDLIST_TRY
+		{
+			AddToIndex(inserted);
+		}
+		LINKEDLIST_CATCH_ALL
+		{
+			mList.Remove(inserted);
+			LINKEDLIST_RETHROW;
+		}
+		return inserted;
+	}
+
+	/// <summary>
+	/// イテレータが指す位置の要素を削除し、索引からも取り除く
+	/// </summary>
+	/// <param name="it">削除する要素を指すイテレータ</param>
+	/// <returns>削除された要素の次を指すイテレータ</returns>
+	Iterator Remove(Iterator it)
+	{
+		if (it == mList.End())
+		{
+			return mList.End();
+		}
+
+		auto handle = mHandles.find(&*it);
+		if (handle != mHandles.end())
+		{
+			mByScore.erase(handle->second.score);
+			mById.erase(handle->second.id);
+			mHandles.erase(handle);
+		}
+		return mList.Remove(it);
+	}
+
+	/// <summary>
+	/// 要素のスコアを変更し、スコア順の索引を更新
+	/// </summary>
+	/// <param name="it">変更する要素を指すイテレータ（このリストの要素でなければ誤った使い方として通知する）</param>
+	/// <param name="score">新しいスコア</param>
+	void UpdateScore(Iterator it, int score)
+	{
+		auto found = mHandles.find(&*it);
+		if (found == mHandles.end())
+		{
+			ReportMisuse("Iterator does not belong to this list");
+		}
+		Handles& handle = found->second;
+		auto moved = mByScore.emplace(score, it);
+		mByScore.erase(handle.score);
+		handle.score = moved;
+		it->score = score;
+	}
+
+	/// <summary>
+	/// スコアが lo 以上 hi 以下の要素を検索
+	/// </summary>
+	/// <param name="lo">スコアの下限</param>
+	/// <param name="hi">スコアの上限</param>
+	/// <returns>該当する要素を指すイテレータ（スコアの昇順、同点は登録またはスコアを変更した順）</returns>
+	std::vector<Iterator> RangeByScore(int lo, int hi) const
+	{
+		std::vector<Iterator> result;
+		if (lo > hi)
+		{
+			return result;
+		}
+
+		const auto last = mByScore.upper_bound(hi);
+		for (auto entry = mByScore.lower_bound(lo); entry != last; ++entry)
+		{
+			result.push_back(entry->second);
+		}
+		return result;
+	}
+
+	/// <summary>
+	/// IDが prefix で始まる要素を検索
+	/// </summary>
+	/// <param name="prefix">IDの先頭部分（空の場合はすべての要素）</param>
+	/// <returns>該当する要素を指すイテレータ（IDの辞書順、同じIDは登録順）</returns>
+	std::vector<Iterator> ByIdPrefix(std::string_view prefix) const
+	{
+		std::vector<Iterator> result;
+		for (auto entry = mById.lower_bound(prefix); entry != mById.end() && entry->first.substr(0, prefix.size()) == prefix; ++entry)
+		{
+			result.push_back(entry->second);
+		}
+		return result;
+	}
+
+	/// <summary>
+	/// 先頭イテレータ取得
+	/// </summary>
+	Iterator Begin()
+	{
+		return mList.Begin();
+	}
+
+	/// <summary>
+	/// 末尾の次を指すイテレータ取得
+	/// </summary>
+	Iterator End()
+	{
+		return mList.End();
+	}
+
+	/// <summary>
+	/// 先頭コンストイテレータ取得
+	/// </summary>
+	ConstIterator CBegin() const
+	{
+		return mList.CBegin();
+	}
+
+	/// <summary>
+	/// 末尾の次を指すコンストイテレータ取得
+	/// </summary>
+	ConstIterator CEnd() const
+	{
+		return mList.CEnd();
+	}
+
+	/// <summary>
+	/// リスト内の要素数を取得
+	/// </summary>
+	size_t Count() const
+	{
+		return mList.Count();
+	}
+
+	/// <summary>
+	/// リストに要素が存在するかチェック
+	/// </summary>
+	bool Any() const
+	{
+		return mList.Any();
+	}
+
+	/// <summary>
+	/// リスト本体を取得（ノードを移動する操作ができないよう、読み取り専用で公開する）
+	/// </summary>
+	const LinkedList<PlayerScore>& List() const
+	{
+		return mList;
+	}
+
+	/// <summary>
+	/// リストと索引のすべての要素を削除
+	/// </summary>
+	void Clean()
+	{
+		mByScore.clear();
+		mById.clear();
+		mHandles.clear();
+		mList.Clean();
+	}
+
+private:
+	using ScoreIndex = std::multimap<int, Iterator>;
+	// キーはノード内のIDを指す（ノードは移動しないので、要素が削除されるまで有効）
+	using IdIndex = std::multimap<std::string_view, Iterator>;
+
+	// 要素ごとの索引内の位置（削除時に同じキーの要素を探さずに済むよう保持する）
+	struct Handles
+	{
+		ScoreIndex::iterator score;
+		IdIndex::iterator id;
+	};
+
+	LinkedList<PlayerScore> mList;
+	ScoreIndex mByScore;
+	IdIndex mById;
+	std::unordered_map<const PlayerScore*, Handles> mHandles;
+
+	/// <summary>
+	/// 要素を両方の索引に登録（途中で失敗した場合は登録しなかったことにする）
+	/// </summary>
+	void AddToIndex(Iterator it)
+	{
+		auto score = mByScore.emplace(it->score, it);
+		LINKEDLIST_TRY
+		{
+			auto id = mById.emplace(std::string_view(it->id), it);
+			LINKEDLIST_TRY
+			{
+				mHandles.emplace(&*it, Handles{ score, id });
+			}
+			LINKEDLIST_CATCH_ALL
+			{
+				mById.erase(id);
+				LINKEDLIST_RETHROW;
+			}
+		}
+		LINKEDLIST_CATCH_ALL
+		{
+			mByScore.erase(score);
+			LINKEDLIST_RETHROW;
+		}
+	}
+};
@@ -0,0 +1,557 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "boundedQueue.h"
+#include "errorPolicy.h"
+#include "linkedList.h"
+#include "playerScore.h"
+#include "scoreLoader.h"
+
+/// <summary>
+/// パイプラインの1段の処理量
+/// </summary>
+struct IngestStageStats
+{
+	// 処理した単位数（読み込み段はチャンク数、解析段と構築段は行数）
+	uint64_t items = 0;
+	// 処理したバイト数
+	uint64_t bytes = 0;
+	// 実際に処理していた時間（待ち時間を除く、解析段は全ワーカーの合計）
+	double busySeconds = 0.0;
+
+	/// <summary>
+	/// 処理中の時間あたりの単位数
+	/// </summary>
+	double ItemsPerSecond() const
+	{
+		return busySeconds > 0.0 ? static_cast<double>(items) / busySeconds : 0.0;
+	}
+
+	/// <summary>
+	/// 処理中の時間あたりのバイト数
+	/// </summary>
+	double BytesPerSecond() const
+	{
+		return busySeconds > 0.0 ? static_cast<double>(bytes) / busySeconds : 0.0;
+	}
+};
+
+/// <summary>
+/// 段と段をつなぐキューの状態
+/// </summary>
+struct IngestQueueStats
+{
+	size_t depth = 0;
+	size_t maxDepth = 0;
+	size_t capacity = 0;
+};
+
+/// <summary>
+/// 取り込みパイプライン全体の計測値
+/// </summary>
+struct IngestStats
+{
+	IngestStageStats reader;
+	IngestStageStats parser;
+	IngestStageStats builder;
+	// 読み込み段から解析段へのキュー
+	IngestQueueStats readQueue;
+	// 解析段から構築段へのキュー
+	IngestQueueStats parseQueue;
+	// 構築段で順番待ちしているチャンク数
+	size_t reorderDepth = 0;
+	// Run()の開始からの経過時間（終了後は全体の所要時間）
+	double elapsedSeconds = 0.0;
+};
+
+/// <summary>
+/// 取り込みパイプラインの設定
+/// </summary>
+struct IngestOptions
+{
+	// 1回に読み込むバイト数（行の途中で切れた分は次のチャンクに回す）
+	size_t chunkSize = 4 << 20;
+	// 解析ワーカー数（0の場合はハードウェアスレッド数から決める）
+	unsigned parserCount = 0;
+	// 各キューの容量（0の場合は解析ワーカー数の2倍）
+	size_t queueCapacity = 0;
+};
+
+/// <summary>
+/// スコアファイルを読み込み段・解析段・構築段に分けて並行に処理し、リストへ取り込むパイプライン
+/// 読み込みスレッドが大きな単位で順に読み、複数の解析ワーカーがチャンクを並列に解析し、
+/// 呼び出し元のスレッドがチャンクを元の順番に並べ直してリスト末尾に繋ぐ
+/// 段の間は容量付きのキューでつなぎ、処理中のチャンク数にも上限を設けるため、後段が遅ければ読み込みも止まる
+/// </summary>
+class ScoreIngestPipeline
+{
+public:
+	explicit ScoreIngestPipeline(IngestOptions options = IngestOptions())
+		: mOptions(NormalizeOptions(options)),
+		mMaxInFlight(mOptions.queueCapacity * 2 + mOptions.parserCount),
+		mReadQueue(mOptions.queueCapacity),
+		mParseQueue(mOptions.queueCapacity)
+	{
+	}
+
+	ScoreIngestPipeline(const ScoreIngestPipeline&) = delete;
+	ScoreIngestPipeline& operator=(const ScoreIngestPipeline&) = delete;
+
+	/// <summary>
+	/// スコアファイルを読み込んで、ファイル内の順番どおりにリスト末尾へ追加
+	/// 解析できない行は読み飛ばす
+	/// </summary>
+	/// <param name="path">スコアファイルのパス</param>
+	/// <param name="list">追加先のリスト</param>
+	/// <returns>ファイルを開けなかった、または読み込み中にエラーが発生した場合はfalse</returns>
+	bool Run(const std::string& path, LinkedList<PlayerScore>& list)
+	{
+		return TryRun(path, list, [](const ScoreError&) { return ScoreErrorAction::Skip; }).HasValue();
+	}
+
+	/// <summary>
+	/// スコアファイルを読み込んで、ファイル内の順番どおりにリスト末尾へ追加し、解析できない行をファイル内の順番どおりに onError(error) で通知する
+	/// onErrorは ScoreErrorAction を返し、Stopの場合はその行の手前までを追加して読み込みをやめる
+	/// 各段で例外が発生した場合は、全段を止めてから呼び出し元のスレッドで送出し直す
+	/// </summary>
+	/// <param name="path">スコアファイルのパス</param>
+	/// <param name="list">追加先のリスト</param>
+	/// <param name="onError">解析できない行で呼ぶ関数（行番号と理由を受け取る、呼び出し元のスレッドで呼ばれる）</param>
+	/// <returns>追加した行数か、読み込みをやめた原因（ファイルを開けない、読み込みエラー、またはStopを返した行）</returns>
+	template <typename OnError>
+	Expected<size_t, ScoreError> TryRun(const std::string& path, LinkedList<PlayerScore>& list, OnError&& onError)
+	{
+		LINKEDLIST_TRACE_SCOPE(LoadScores);
+
+		std::ifstream file(path, std::ios::binary);
+		if (!file.is_open())
+		{
+			return Unexpected(ScoreError{ 0, ScoreErrorReason::OpenFailed });
+		}
+
+		Reset();
+
+		std::thread reader([this, &file]() { ReaderStage(file); });
+		std::vector<std::thread> parsers;
+		parsers.reserve(mOptions.parserCount);
+		for (unsigned i = 0; i < mOptions.parserCount; i++)
+		{
+			parsers.emplace_back([this]() { ParserStage(); });
+		}
+
+		// 構築段は呼び出し元のスレッドで処理する
+		LINKEDLIST_TRY
+		{
+			BuilderStage(list, onError);
+		}
+		LINKEDLIST_CATCH_ALL
+		{
+			Fail(CapturedException::Current());
+		}
+
+		reader.join();
+		for (auto& parser : parsers)
+		{
+			parser.join();
+		}
+		mEndNanos.store(NowNanos(), std::memory_order_relaxed);
+
+		mError.RethrowIfAny();
+		if (mStoppedAt)
+		{
+			return Unexpected(*mStoppedAt);
+		}
+		if (mReadFailed)
+		{
+			return Unexpected(ScoreError{ 0, ScoreErrorReason::ReadFailed });
+		}
+		return mAdded;
+	}
+
+	/// <summary>
+	/// 計測値を取得（Run()の実行中に別スレッドから呼んでもよい）
+	/// </summary>
+	IngestStats Stats() const
+	{
+		IngestStats stats;
+		stats.reader = mReaderCounters.Get();
+		stats.parser = mParserCounters.Get();
+		stats.builder = mBuilderCounters.Get();
+		stats.readQueue = { mReadQueue.Depth(), mReadQueue.MaxDepth(), mReadQueue.Capacity() };
+		stats.parseQueue = { mParseQueue.Depth(), mParseQueue.MaxDepth(), mParseQueue.Capacity() };
+		stats.reorderDepth = mReorderDepth.load(std::memory_order_relaxed);
+
+		const int64_t start = mStartNanos.load(std::memory_order_relaxed);
+		const int64_t end = mEndNanos.load(std::memory_order_relaxed);
+		if (start != 0)
+		{
+			stats.elapsedSeconds = static_cast<double>((end != 0 ? end : NowNanos()) - start) * 1e-9;
+		}
+		return stats;
+	}
+
+	/// <summary>
+	/// 実際に使われる設定を取得
+	/// </summary>
+	const IngestOptions& Options() const
+	{
+		return mOptions;
+	}
+
+private:
+	// 読み込み段から解析段へ渡すチャンク（最後のチャンク以外は必ず改行で終わる）
+	struct RawChunk
+	{
+		size_t sequence = 0;
+		std::string data;
+	};
+
+	// 解析できなかった行
+	struct RowError
+	{
+		// チャンク内の1から始まる行番号
+		size_t line = 0;
+		// チャンク内でこの行より前に解析できた行数
+		size_t rowsBefore = 0;
+		ScoreErrorReason reason = ScoreErrorReason::InvalidScore;
+	};
+
+	// 解析段から構築段へ渡すチャンク
+	struct ParsedChunk
+	{
+		size_t sequence = 0;
+		uint64_t bytes = 0;
+		// チャンク内の行数（解析できなかった行を含む）
+		size_t lines = 0;
+		std::vector<PlayerScore> rows;
+		std::vector<RowError> errors;
+	};
+
+	// 1段ぶんの計測値（複数スレッドから加算される）
+	struct StageCounters
+	{
+		std::atomic<uint64_t> items{ 0 };
+		std::atomic<uint64_t> bytes{ 0 };
+		std::atomic<int64_t> busyNanos{ 0 };
+
+		void Add(uint64_t addItems, uint64_t addBytes, int64_t startNanos)
+		{
+			items.fetch_add(addItems, std::memory_order_relaxed);
+			bytes.fetch_add(addBytes, std::memory_order_relaxed);
+			busyNanos.fetch_add(NowNanos() - startNanos, std::memory_order_relaxed);
+		}
+
+		void Clear()
+		{
+			items.store(0, std::memory_order_relaxed);
+			bytes.store(0, std::memory_order_relaxed);
+			busyNanos.store(0, std::memory_order_relaxed);
+		}
+
+		IngestStageStats Get() const
+		{
+			IngestStageStats stats;
+			stats.items = items.load(std::memory_order_relaxed);
+			stats.bytes = bytes.load(std::memory_order_relaxed);
+			stats.busySeconds = static_cast<double>(busyNanos.load(std::memory_order_relaxed)) * 1e-9;
+			return stats;
+		}
+	};
+
+	IngestOptions mOptions;
+	// 読み込み済みでまだリストに繋いでいないチャンク数の上限
+	size_t mMaxInFlight;
+	BoundedQueue<RawChunk> mReadQueue;
+	BoundedQueue<ParsedChunk> mParseQueue;
+
+	std::mutex mInFlightMutex;
+	std::condition_variable mInFlightCondition;
+	size_t mInFlight = 0;
+	bool mCancelled = false;
+
+	// まだ終了していない解析ワーカー数（最後のワーカーが構築段へのキューを閉じる）
+	std::atomic<unsigned> mActiveParsers{ 0 };
+	std::atomic<size_t> mReorderDepth{ 0 };
+
+	StageCounters mReaderCounters;
+	StageCounters mParserCounters;
+	StageCounters mBuilderCounters;
+	std::atomic<int64_t> mStartNanos{ 0 };
+	std::atomic<int64_t> mEndNanos{ 0 };
+
+	std::mutex mErrorMutex;
+	CapturedException mError;
+	bool mReadFailed = false;
+	// 呼び出し元がStopを返した行
+	std::optional<ScoreError> mStoppedAt;
+	// リストに追加した行数
+	size_t mAdded = 0;
+
+	static int64_t NowNanos()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	/// <summary>
+	/// 0が指定された設定を既定値で埋める
+	/// </summary>
+	static IngestOptions NormalizeOptions(IngestOptions options)
+	{
+		if (options.parserCount == 0)
+		{
+			// 読み込みスレッドと構築スレッドの分を残す
+			const unsigned hardware = std::thread::hardware_concurrency();
+			options.parserCount = hardware > 2 ? hardware - 2 : 1;
+		}
+		if (options.queueCapacity == 0)
+		{
+			options.queueCapacity = static_cast<size_t>(options.parserCount) * 2;
+		}
+		if (options.chunkSize == 0)
+		{
+			options.chunkSize = IngestOptions().chunkSize;
+		}
+		return options;
+	}
+
+	/// <summary>
+	/// 前回の実行の状態を消す
+	/// </summary>
+	void Reset()
+	{
+		mReadQueue.Reopen();
+		mParseQueue.Reopen();
+		mInFlight = 0;
+		mCancelled = false;
+		mActiveParsers.store(mOptions.parserCount, std::memory_order_relaxed);
+		mReorderDepth.store(0, std::memory_order_relaxed);
+		mReaderCounters.Clear();
+		mParserCounters.Clear();
+		mBuilderCounters.Clear();
+		mEndNanos.store(0, std::memory_order_relaxed);
+		mStartNanos.store(NowNanos(), std::memory_order_relaxed);
+		mError = CapturedException();
+		mReadFailed = false;
+		mStoppedAt.reset();
+		mAdded = 0;
+	}
+
+	/// <summary>
+	/// 例外を記録して全段を止める
+	/// </summary>
+	void Fail(CapturedException error)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mErrorMutex);
+			if (!mError)
+			{
+				mError = error;
+			}
+		}
+		Cancel();
+	}
+
+	/// <summary>
+	/// 全段を止める
+	/// </summary>
+	void Cancel()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mInFlightMutex);
+			mCancelled = true;
+		}
+		mInFlightCondition.notify_all();
+		mReadQueue.Close();
+		mParseQueue.Close();
+	}
+
+	/// <summary>
+	/// 読み込み段：ファイルを大きな単位で順に読み、改行で区切ったチャンクを解析段へ送る
+	/// </summary>
+	void ReaderStage(std::ifstream& file)
+	{
+		LINKEDLIST_TRY
+		{
+			std::string carry;
+			size_t sequence = 0;
+			bool eof = false;
+
+			while (!eof)
+			{
+				// 処理中のチャンクが多すぎる場合は、構築段が追いつくまで待つ
+				{
+					std::unique_lock<std::mutex> lock(mInFlightMutex);
+					mInFlightCondition.wait(lock, [this]() { return mCancelled || mInFlight < mMaxInFlight; });
+					if (mCancelled)
+					{
+						break;
+					}
+					mInFlight++;
+				}
+
+				const int64_t start = NowNanos();
+				RawChunk chunk;
+				chunk.sequence = sequence++;
+				chunk.data.swap(carry);
+				carry.clear();
+
+				// 改行が1つも含まれない場合は、見つかるまで読み足す（持ち越した分には改行は含まれない）
+				size_t lastNewline = std::string::npos;
+				uint64_t bytesRead = 0;
+				while (lastNewline == std::string::npos && !eof)
+				{
+					const size_t oldSize = chunk.data.size();
+					chunk.data.resize(oldSize + mOptions.chunkSize);
+					file.read(&chunk.data[oldSize], static_cast<std::streamsize>(mOptions.chunkSize));
+					const size_t got = static_cast<size_t>(file.gcount());
+					chunk.data.resize(oldSize + got);
+					bytesRead += got;
+
+					if (!file)
+					{
+						eof = true;
+						mReadFailed = file.bad();
+					}
+					else
+					{
+						lastNewline = chunk.data.rfind('\n');
+					}
+				}
+
+				// 行の途中で切れた分は次のチャンクに回す
+				if (!eof && lastNewline + 1 < chunk.data.size())
+				{
+					carry.assign(chunk.data, lastNewline + 1, std::string::npos);
+					chunk.data.resize(lastNewline + 1);
+				}
+				mReaderCounters.Add(1, bytesRead, start);
+
+				if (!mReadQueue.Push(std::move(chunk)))
+				{
+					break;
+				}
+			}
+		}
+		LINKEDLIST_CATCH_ALL
+		{
+			Fail(CapturedException::Current());
+		}
+
+		mReadQueue.Close();
+	}
+
+	/// <summary>
+	/// 解析段：チャンク内の行をすべて解析して構築段へ送る
+	/// 解析できなかった行は、行番号を決められる構築段で通知するよう、チャンク内の位置と理由を記録しておく
+	/// </summary>
+	void ParserStage()
+	{
+		LINKEDLIST_TRY
+		{
+			RawChunk chunk;
+			while (mReadQueue.Pop(chunk))
+			{
+				const int64_t start = NowNanos();
+				ParsedChunk parsed;
+				parsed.sequence = chunk.sequence;
+				parsed.bytes = chunk.data.size();
+				parsed.rows.reserve(chunk.data.size() / 16);
+				ForEachScoreLine(chunk.data.data(), chunk.data.size(), true, [&parsed](int score, std::string_view id)
+				{
+					parsed.lines++;
+					parsed.rows.emplace_back(score, std::string(id));
+				}, [&parsed](ScoreErrorReason reason)
+				{
+					parsed.lines++;
+					parsed.errors.push_back(RowError{ parsed.lines, parsed.rows.size(), reason });
+					return true;
+				});
+				mParserCounters.Add(parsed.rows.size(), parsed.bytes, start);
+
+				if (!mParseQueue.Push(std::move(parsed)))
+				{
+					break;
+				}
+			}
+		}
+		LINKEDLIST_CATCH_ALL
+		{
+			Fail(CapturedException::Current());
+		}
+
+		if (mActiveParsers.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			mParseQueue.Close();
+		}
+	}
+
+	/// <summary>
+	/// 構築段：解析済みのチャンクを元の順番に並べ直してリスト末尾に繋ぐ
+	/// 解析できなかった行もこの順番で通知し、Stopが返された場合はその行の手前までを繋いで全段を止める
+	/// </summary>
+	template <typename OnError>
+	void BuilderStage(LinkedList<PlayerScore>& list, OnError& onError)
+	{
+		std::map<size_t, ParsedChunk> pending;
+		size_t next = 0;
+		// 繋ぎ終えたチャンクの行数の合計
+		size_t linesBefore = 0;
+
+		ParsedChunk parsed;
+		while (mParseQueue.Pop(parsed))
+		{
+			pending.emplace(parsed.sequence, std::move(parsed));
+
+			auto it = pending.begin();
+			while (it != pending.end() && it->first == next)
+			{
+				const int64_t start = NowNanos();
+				std::vector<PlayerScore>& rows = it->second.rows;
+				size_t accepted = rows.size();
+				for (const RowError& error : it->second.errors)
+				{
+					const ScoreError reported{ linesBefore + error.line, error.reason };
+					if (onError(reported) == ScoreErrorAction::Stop)
+					{
+						mStoppedAt = reported;
+						accepted = error.rowsBefore;
+						break;
+					}
+				}
+
+				list.InsertRange(list.End(), std::make_move_iterator(rows.begin()), std::make_move_iterator(rows.begin() + accepted));
+				mAdded += accepted;
+				linesBefore += it->second.lines;
+				mBuilderCounters.Add(accepted, it->second.bytes, start);
+
+				if (mStoppedAt)
+				{
+					Cancel();
+					return;
+				}
+
+				it = pending.erase(it);
+				next++;
+
+				{
+					std::lock_guard<std::mutex> lock(mInFlightMutex);
+					mInFlight--;
+				}
+				mInFlightCondition.notify_one();
+			}
+			mReorderDepth.store(pending.size(), std::memory_order_relaxed);
+		}
+	}
+};
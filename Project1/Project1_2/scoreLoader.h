@@ -0,0 +1,481 @@
+#pragma once
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "errorPolicy.h"
+#include "linkedList.h"
+#include "playerScore.h"
+
+/// <summary>
+/// 読み込み中のバッファ内の1行を指す軽量なスコア
+/// idは次の行へ進めるまでの間だけ有効
+/// </summary>
+struct ScoreView
+{
+	int score;
+	std::string_view id;
+
+	/// <summary>
+	/// idを複製してPlayerScoreに変換
+	/// </summary>
+	PlayerScore ToPlayerScore() const
+	{
+		return PlayerScore(score, std::string(id));
+	}
+};
+
+/// <summary>
+/// スコアファイルを読み込めなかった理由
+/// </summary>
+enum class ScoreErrorReason
+{
+	// スコアとIDを区切るタブが無い
+	MissingTab,
+	// スコアが整数として解釈できない
+	InvalidScore,
+	// スコアがintの範囲に収まらない
+	ScoreOutOfRange,
+	// ファイルを開けない
+	OpenFailed,
+	// ファイルの読み込み中にエラーが発生した
+	ReadFailed,
+};
+
+/// <summary>
+/// 読み込めなかった理由の説明を取得
+/// </summary>
+inline const char* ToString(ScoreErrorReason reason)
+{
+	switch (reason)
+	{
+	case ScoreErrorReason::MissingTab:
+		return "missing tab";
+	case ScoreErrorReason::InvalidScore:
+		return "invalid score";
+	case ScoreErrorReason::ScoreOutOfRange:
+		return "score out of range";
+	case ScoreErrorReason::OpenFailed:
+		return "cannot open file";
+	case ScoreErrorReason::ReadFailed:
+		return "read error";
+	}
+	return "unknown";
+}
+
+/// <summary>
+/// 読み込めなかった行とその理由
+/// </summary>
+struct ScoreError
+{
+	// 1から始まる行番号（ファイル全体に関わるエラーの場合は0）
+	size_t line;
+	ScoreErrorReason reason;
+};
+
+/// <summary>
+/// 解析できない行を見つけた際の扱い
+/// </summary>
+enum class ScoreErrorAction
+{
+	// その行を読み飛ばして続ける
+	Skip,
+	// その行の手前で読み込みをやめる
+	Stop,
+};
+
+/// <summary>
+/// "スコア<TAB>ID" 形式の1行を解析
+/// </summary>
+/// <param name="line">改行を含まない1行（末尾の'\r'は取り除く）</param>
+/// <returns>解析したスコア（idはlineを指す）か、解析できない理由</returns>
+inline Expected<ScoreView, ScoreErrorReason> TryParseScoreLine(std::string_view line)
+{
+	if (!line.empty() && line.back() == '\r')
+	{
+		line.remove_suffix(1);
+	}
+
+	const size_t tab = line.find('	');
+	if (tab == std::string_view::npos)
+	{
+		return Unexpected(ScoreErrorReason::MissingTab);
+	}
+
+	const char* first = line.data();
+	const char* last = line.data() + tab;
+
+	// std::stoiと同様に先頭の空白と'+'を許容する
+	while (first != last && (*first == ' ' || *first == '	'))
+	{
+		first++;
+	}
+	if (first != last && *first == '+')
+	{
+		first++;
+	}
+
+	ScoreView view;
+	auto result = std::from_chars(first, last, view.score);
+	if (result.ec == std::errc::result_out_of_range)
+	{
+		return Unexpected(ScoreErrorReason::ScoreOutOfRange);
+	}
+	if (result.ec != std::errc() || result.ptr == first)
+	{
+		return Unexpected(ScoreErrorReason::InvalidScore);
+	}
+
+	view.id = line.substr(tab + 1);
+	return view;
+}
+
+/// <summary>
+/// "スコア<TAB>ID" 形式の1行を解析
+/// </summary>
+/// <param name="line">改行を含まない1行（末尾の'\r'は取り除く）</param>
+/// <param name="score">解析したスコアの格納先</param>
+/// <param name="id">解析したIDの格納先</param>
+/// <returns>解析に成功した場合はtrue</returns>
+inline bool ParseScoreLine(std::string_view line, int& score, std::string_view& id)
+{
+	auto parsed = TryParseScoreLine(line);
+	if (!parsed)
+	{
+		return false;
+	}
+
+	score = parsed->score;
+	id = parsed->id;
+	return true;
+}
+
+/// <summary>
+/// バッファ内の改行で終わっている行をすべて解析し、解析できた行ごとに func(score, id) を、解析できない行ごとに onError(reason) を呼ぶ
+/// onErrorがfalseを返した場合は、その行の手前で解析をやめる
+/// </summary>
+/// <param name="data">解析するデータ</param>
+/// <param name="size">データのバイト数</param>
+/// <param name="finalChunk">trueの場合、改行で終わっていない最後の行も解析する</param>
+/// <param name="func">各行で呼ぶ関数（idはdataを指すので、呼び出しの間だけ有効）</param>
+/// <param name="onError">解析できない行で呼ぶ関数（続ける場合はtrueを返す）</param>
+/// <returns>解析済みとして消費したバイト数（途中の行と、解析をやめた行は含まない）</returns>
+template <typename Func, typename OnError>
+size_t ForEachScoreLine(const char* data, size_t size, bool finalChunk, Func&& func, OnError&& onError)
+{
+	size_t consumed = 0;
+	while (consumed < size)
+	{
+		std::string_view rest(data + consumed, size - consumed);
+		size_t newline = rest.find('\n');
+		if (newline == std::string_view::npos)
+		{
+			if (!finalChunk)
+			{
+				break;
+			}
+			newline = rest.size();
+		}
+
+		auto parsed = TryParseScoreLine(rest.substr(0, newline));
+		if (parsed)
+		{
+			func(parsed->score, parsed->id);
+		}
+		else if (!onError(parsed.Error()))
+		{
+			break;
+		}
+
+		consumed += (newline < rest.size()) ? newline + 1 : newline;
+	}
+
+	return consumed;
+}
+
+/// <summary>
+/// バッファ内の改行で終わっている行をすべて解析し、解析できた行ごとに func(score, id) を呼ぶ
+/// 解析できない行は読み飛ばす
+/// </summary>
+/// <param name="data">解析するデータ</param>
+/// <param name="size">データのバイト数</param>
+/// <param name="finalChunk">trueの場合、改行で終わっていない最後の行も解析する</param>
+/// <param name="func">各行で呼ぶ関数（idはdataを指すので、呼び出しの間だけ有効）</param>
+/// <returns>解析済みとして消費したバイト数（途中の行は含まない）</returns>
+template <typename Func>
+size_t ForEachScoreLine(const char* data, size_t size, bool finalChunk, Func&& func)
+{
+	return ForEachScoreLine(data, size, finalChunk, func, [](ScoreErrorReason) { return true; });
+}
+
+/// <summary>
+/// バッファ内の改行で終わっている行をすべて解析して配列末尾に追加
+/// 解析できない行は読み飛ばす
+/// </summary>
+/// <param name="data">解析するデータ</param>
+/// <param name="size">データのバイト数</param>
+/// <param name="rows">追加先の配列</param>
+/// <param name="finalChunk">trueの場合、改行で終わっていない最後の行も解析する</param>
+/// <returns>解析済みとして消費したバイト数（途中の行は含まない）</returns>
+inline size_t ParseScoreRows(const char* data, size_t size, std::vector<PlayerScore>& rows, bool finalChunk)
+{
+	return ForEachScoreLine(data, size, finalChunk, [&rows](int score, std::string_view id)
+	{
+		rows.emplace_back(score, std::string(id));
+	});
+}
+
+/// <summary>
+/// バッファ内の改行で終わっている行をすべて解析してリスト末尾に追加
+/// 解析できない行は読み飛ばす
+/// </summary>
+/// <param name="data">解析するデータ</param>
+/// <param name="size">データのバイト数</param>
+/// <param name="list">追加先のリスト</param>
+/// <param name="finalChunk">trueの場合、改行で終わっていない最後の行も解析する</param>
+/// <returns>解析済みとして消費したバイト数（途中の行は含まない）</returns>
+inline size_t ParseScoreLines(const char* data, size_t size, LinkedList<PlayerScore>& list, bool finalChunk)
+{
+	// 解析結果を一度ためてから、ノードをまとめて確保してリストに繋ぐ
+	std::vector<PlayerScore> parsed;
+	const size_t consumed = ParseScoreRows(data, size, parsed, finalChunk);
+
+	list.InsertRange(list.End(), std::make_move_iterator(parsed.begin()), std::make_move_iterator(parsed.end()));
+	return consumed;
+}
+
+/// <summary>
+/// ファイルを大きな単位で読み込み、読み込むたびに onChunk(data, size, eof) を呼ぶ
+/// onChunkは消費したバイト数を返し、行の途中で切れて消費されなかった分は次の呼び出しの先頭へ送られる
+/// onChunkがstd::nulloptを返した場合は、残りを読まずに終える
+/// </summary>
+/// <param name="path">読み込むファイルのパス</param>
+/// <param name="onChunk">読み込んだデータを処理する関数</param>
+/// <returns>ファイルを開けなかった場合はfalse</returns>
+template <typename OnChunk>
+bool ReadScoreChunks(const std::string& path, OnChunk&& onChunk)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	constexpr size_t chunkSize = 1 << 20;
+	std::vector<char> buffer(chunkSize);
+	size_t pending = 0;
+
+	while (true)
+	{
+		if (pending == buffer.size())
+		{
+			buffer.resize(buffer.size() * 2);
+		}
+
+		file.read(buffer.data() + pending, static_cast<std::streamsize>(buffer.size() - pending));
+		const size_t size = pending + static_cast<size_t>(file.gcount());
+		const bool eof = !file;
+
+		const std::optional<size_t> consumed = onChunk(buffer.data(), size, eof);
+		if (!consumed || eof)
+		{
+			break;
+		}
+		pending = size - *consumed;
+		std::copy(buffer.begin() + *consumed, buffer.begin() + size, buffer.begin());
+	}
+
+	return true;
+}
+
+/// <summary>
+/// スコアファイルを読み込んでリスト末尾に追加
+/// </summary>
+/// <param name="path">スコアファイルのパス</param>
+/// <param name="list">追加先のリスト</param>
+/// <returns>ファイルを開けなかった場合はfalse</returns>
+inline bool LoadScores(const std::string& path, LinkedList<PlayerScore>& list)
+{
+	LINKEDLIST_TRACE_SCOPE(LoadScores);
+
+	// 大きな単位で読み込み、行の途中で切れた分は次の読み込みの先頭へ送る
+	return ReadScoreChunks(path, [&list](const char* data, size_t size, bool eof)
+	{
+		return ParseScoreLines(data, size, list, eof);
+	});
+}
+
+/// <summary>
+/// スコアファイルを読み込んでリスト末尾に追加し、解析できない行をすべて onError(error) で通知する
+/// onErrorは ScoreErrorAction を返し、Stopの場合はその行の手前までを追加して読み込みをやめる
+/// 例外を使わずに結果を返すため、-fno-exceptions のビルドでも使える
+/// </summary>
+/// <param name="path">スコアファイルのパス</param>
+/// <param name="list">追加先のリスト</param>
+/// <param name="onError">解析できない行で呼ぶ関数（行番号と理由を受け取る）</param>
+/// <returns>追加した行数か、読み込みをやめた原因（ファイルを開けない、またはStopを返した行）</returns>
+template <typename OnError>
+Expected<size_t, ScoreError> TryLoadScores(const std::string& path, LinkedList<PlayerScore>& list, OnError&& onError)
+{
+	LINKEDLIST_TRACE_SCOPE(LoadScores);
+
+	size_t line = 0;
+	size_t added = 0;
+	std::optional<ScoreError> stoppedAt;
+	std::vector<PlayerScore> parsed;
+	const bool opened = ReadScoreChunks(path, [&](const char* data, size_t size, bool eof) -> std::optional<size_t>
+	{
+		parsed.clear();
+		const size_t consumed = ForEachScoreLine(data, size, eof, [&](int score, std::string_view id)
+		{
+			line++;
+			parsed.emplace_back(score, std::string(id));
+		}, [&](ScoreErrorReason reason)
+		{
+			line++;
+			const ScoreError error{ line, reason };
+			if (onError(error) == ScoreErrorAction::Stop)
+			{
+				stoppedAt = error;
+				return false;
+			}
+			return true;
+		});
+
+		added += parsed.size();
+		list.InsertRange(list.End(), std::make_move_iterator(parsed.begin()), std::make_move_iterator(parsed.end()));
+		if (stoppedAt)
+		{
+			return std::nullopt;
+		}
+		return consumed;
+	});
+
+	if (!opened)
+	{
+		return Unexpected(ScoreError{ 0, ScoreErrorReason::OpenFailed });
+	}
+	if (stoppedAt)
+	{
+		return Unexpected(*stoppedAt);
+	}
+	return added;
+}
+
+/// <summary>
+/// 同じIDのスコアが複数あった場合の扱い
+/// </summary>
+enum class DuplicatePolicy
+{
+	// 最も高いスコアを残す
+	Max,
+	// 最も低いスコアを残す
+	Min,
+	// 最後に現れたスコアを残す
+	Latest,
+	// スコアを合計する（intの範囲に収まるよう飽和させる）
+	Sum,
+};
+
+/// <summary>
+/// IDごとに1つのノードだけを残しながらリストへスコアを追加するクラス
+/// IDからノードへのハッシュ表を持ち、既にあるIDはノードのスコアをポリシーに従って更新する
+/// ハッシュ表のキーはノード内のIDを指すため、追加のたびにIDを複製しない
+/// 使用中は対象のリストから要素を削除したり、再配置したりしないこと
+/// </summary>
+class ScoreMerger
+{
+public:
+	/// <summary>
+	/// リストの既存の要素を登録して作成（既存の要素どうしの重複はそのまま残す）
+	/// </summary>
+	/// <param name="list">追加先のリスト</param>
+	/// <param name="policy">重複したIDの扱い</param>
+	ScoreMerger(LinkedList<PlayerScore>& list, DuplicatePolicy policy) : mList(list), mPolicy(policy)
+	{
+		mIndex.reserve(list.Count());
+		for (auto it = list.Begin(); it != list.End(); ++it)
+		{
+			mIndex.emplace(std::string_view(it->id), it);
+		}
+	}
+
+	ScoreMerger(const ScoreMerger&) = delete;
+	ScoreMerger& operator=(const ScoreMerger&) = delete;
+
+	/// <summary>
+	/// スコアを1件追加（新しいIDであればリスト末尾にノードを追加する）
+	/// </summary>
+	/// <param name="score">スコア</param>
+	/// <param name="id">ID</param>
+	void Add(int score, std::string_view id)
+	{
+		auto found = mIndex.find(id);
+		if (found == mIndex.end())
+		{
+			auto it = mList.Insert(mList.End(), PlayerScore(score, std::string(id)));
+			mIndex.emplace(std::string_view(it->id), it);
+			return;
+		}
+
+		int& current = found->second->score;
+		switch (mPolicy)
+		{
+		case DuplicatePolicy::Max:
+			current = std::max(current, score);
+			break;
+		case DuplicatePolicy::Min:
+			current = std::min(current, score);
+			break;
+		case DuplicatePolicy::Latest:
+			current = score;
+			break;
+		case DuplicatePolicy::Sum:
+			current = static_cast<int>(std::clamp<long long>(static_cast<long long>(current) + score,
+				std::numeric_limits<int>::min(), std::numeric_limits<int>::max()));
+			break;
+		}
+	}
+
+	/// <summary>
+	/// 登録されているIDの数を取得
+	/// </summary>
+	size_t Count() const
+	{
+		return mIndex.size();
+	}
+
+private:
+	LinkedList<PlayerScore>& mList;
+	DuplicatePolicy mPolicy;
+	std::unordered_map<std::string_view, LinkedList<PlayerScore>::Iterator> mIndex;
+};
+
+/// <summary>
+/// スコアファイルを読み込み、IDごとに1つのノードにまとめながらリスト末尾に追加
+/// 各IDのノードは最初に現れた位置に置かれ、スコアはポリシーに従って1回の走査で確定する
+/// </summary>
+/// <param name="path">スコアファイルのパス</param>
+/// <param name="list">追加先のリスト</param>
+/// <param name="policy">重複したIDの扱い</param>
+/// <returns>ファイルを開けなかった場合はfalse</returns>
+inline bool LoadScores(const std::string& path, LinkedList<PlayerScore>& list, DuplicatePolicy policy)
+{
+	LINKEDLIST_TRACE_SCOPE(LoadScores);
+
+	ScoreMerger merger(list, policy);
+	return ReadScoreChunks(path, [&merger](const char* data, size_t size, bool eof)
+	{
+		return ForEachScoreLine(data, size, eof, [&merger](int score, std::string_view id)
+		{
+			merger.Add(score, id);
+		});
+	});
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "generator.h"
+#include "playerScore.h"
+#include "scoreLoader.h"
+
+/// <summary>
+/// スコアファイルを先頭から1行ずつ解析して返すジェネレータ
+/// ファイル全体を読み込まず、一定サイズのバッファだけで処理するため、使用メモリはファイルサイズに依存しない
+/// （バッファより長い行がある場合のみ、その行が収まるまでバッファを広げる）
+/// 走査を途中でやめた場合、残りの部分は読み込まない
+/// 解析できない行は読み飛ばし、ファイルを開けない場合は何も返さない
+/// </summary>
+/// <param name="path">スコアファイルのパス</param>
+/// <param name="bufferSize">読み込みバッファのサイズ</param>
+/// <returns>各行のスコアを返すジェネレータ</returns>
+inline Generator<ScoreView> ReadScores(std::string path, size_t bufferSize = 64 << 10)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open())
+	{
+		co_return;
+	}
+
+	std::vector<char> buffer(bufferSize > 0 ? bufferSize : 1);
+	size_t pending = 0;
+
+	while (true)
+	{
+		if (pending == buffer.size())
+		{
+			buffer.resize(buffer.size() * 2);
+		}
+
+		file.read(buffer.data() + pending, static_cast<std::streamsize>(buffer.size() - pending));
+		const size_t size = pending + static_cast<size_t>(file.gcount());
+		const bool eof = !file;
+
+		size_t consumed = 0;
+		while (consumed < size)
+		{
+			std::string_view rest(buffer.data() + consumed, size - consumed);
+			size_t newline = rest.find('\n');
+			if (newline == std::string_view::npos)
+			{
+				if (!eof)
+				{
+					break;
+				}
+				newline = rest.size();
+			}
+
+			ScoreView view;
+			if (ParseScoreLine(rest.substr(0, newline), view.score, view.id))
+			{
+				co_yield view;
+			}
+
+			consumed += (newline < rest.size()) ? newline + 1 : newline;
+		}
+
+		if (eof)
+		{
+			break;
+		}
+
+		// 行の途中で切れた分はバッファの先頭へ送る
+		pending = size - consumed;
+		std::memmove(buffer.data(), buffer.data() + consumed, pending);
+	}
+}
@@ -0,0 +1,357 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "linkedList.h"
+#include "playerScore.h"
+#include "scoreWriter.h"
+
+/// <summary>
+/// スナップショットファイルのヘッダ
+/// 全フィールドをリトルエンディアンで格納し、直後にScoreFormat::Binary形式のレコードが count 件続く
+/// </summary>
+struct SnapshotHeader
+{
+	static constexpr char Magic[8] = { 'L', 'L', 'S', 'N', 'A', 'P', '\0', '\0' };
+	static constexpr uint32_t CurrentVersion = 1;
+	static constexpr size_t Size = 40;
+
+	uint32_t version;
+	uint64_t count;
+	uint64_t payloadSize;
+	uint64_t checksum;
+};
+
+namespace SnapshotDetail
+{
+	inline void StoreUInt(char* out, uint64_t value, int bytes)
+	{
+		for (int b = 0; b < bytes; b++)
+		{
+			out[b] = static_cast<char>((value >> (8 * b)) & 0xFF);
+		}
+	}
+
+	/// <summary>
+	/// リトルエンディアンで格納された bytes バイト(8以下)の符号なし整数を読み込む
+	/// </summary>
+	inline uint64_t LoadUInt(const char* in, int bytes)
+	{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+		uint64_t value = 0;
+		for (int b = bytes - 1; b >= 0; b--)
+		{
+			value = (value << 8) | static_cast<unsigned char>(in[b]);
+		}
+		return value;
+#else
+		// リトルエンディアン環境ではそのままコピーするだけでよい
+		uint64_t value = 0;
+		std::memcpy(&value, in, static_cast<size_t>(bytes));
+		return value;
+#endif
+	}
+
+	inline void EncodeHeader(char* out, const SnapshotHeader& header)
+	{
+		std::memcpy(out, SnapshotHeader::Magic, 8);
+		StoreUInt(out + 8, header.version, 4);
+		StoreUInt(out + 12, 0, 4);
+		StoreUInt(out + 16, header.count, 8);
+		StoreUInt(out + 24, header.payloadSize, 8);
+		StoreUInt(out + 32, header.checksum, 8);
+	}
+}
+
+/// <summary>
+/// スナップショット用の64bitチェックサム
+/// 8バイト単位で処理するため、Update()には最後の呼び出し以外8の倍数のサイズを渡すこと
+/// </summary>
+class SnapshotChecksum
+{
+public:
+	void Update(const char* data, size_t size)
+	{
+		size_t i = 0;
+		for (; i + 8 <= size; i += 8)
+		{
+			Mix(LoadUInt64(data + i));
+		}
+
+		// 端数は0で埋めた1ワードとして扱う
+		if (i < size)
+		{
+			char tail[8] = {};
+			std::memcpy(tail, data + i, size - i);
+			Mix(LoadUInt64(tail));
+		}
+	}
+
+	uint64_t Value() const
+	{
+		return mState;
+	}
+
+private:
+	uint64_t mState = 0xcbf29ce484222325ULL;
+
+	void Mix(uint64_t word)
+	{
+		mState = (mState ^ word) * 0x100000001b3ULL;
+		mState ^= mState >> 29;
+	}
+
+	static uint64_t LoadUInt64(const char* p)
+	{
+		return SnapshotDetail::LoadUInt(p, 8);
+	}
+};
+
+/// <summary>
+/// 読み取り専用でファイル全体をメモリにマップするクラス
+/// </summary>
+class MappedFile
+{
+public:
+	explicit MappedFile(const std::string& path)
+	{
+#ifdef _WIN32
+		mFile = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+			FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (mFile == INVALID_HANDLE_VALUE)
+		{
+			return;
+		}
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(mFile, &size) || size.QuadPart == 0)
+		{
+			return;
+		}
+		mMapping = CreateFileMappingA(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mMapping)
+		{
+			return;
+		}
+		mData = static_cast<const char*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+		mSize = mData ? static_cast<size_t>(size.QuadPart) : 0;
+#else
+		mFd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (mFd < 0)
+		{
+			return;
+		}
+		struct stat st;
+		if (fstat(mFd, &st) != 0 || st.st_size == 0)
+		{
+			return;
+		}
+#ifdef MAP_POPULATE
+		// 復元時は全体を必ず読むので、ページをまとめて読み込んでおく
+		const int flags = MAP_PRIVATE | MAP_POPULATE;
+#else
+		const int flags = MAP_PRIVATE;
+#endif
+		void* data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, flags, mFd, 0);
+		if (data == MAP_FAILED)
+		{
+			return;
+		}
+		mData = static_cast<const char*>(data);
+		mSize = static_cast<size_t>(st.st_size);
+#endif
+	}
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	~MappedFile()
+	{
+#ifdef _WIN32
+		if (mData)
+		{
+			UnmapViewOfFile(mData);
+		}
+		if (mMapping)
+		{
+			CloseHandle(mMapping);
+		}
+		if (mFile != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(mFile);
+		}
+#else
+		if (mData)
+		{
+			munmap(const_cast<char*>(mData), mSize);
+		}
+		if (mFd >= 0)
+		{
+			close(mFd);
+		}
+#endif
+	}
+
+	const char* Data() const
+	{
+		return mData;
+	}
+
+	size_t Size() const
+	{
+		return mSize;
+	}
+
+private:
+	const char* mData = nullptr;
+	size_t mSize = 0;
+#ifdef _WIN32
+	HANDLE mFile = INVALID_HANDLE_VALUE;
+	HANDLE mMapping = nullptr;
+#else
+	int mFd = -1;
+#endif
+};
+
+/// <summary>
+/// リストの内容を走査順にスナップショットファイルへ保存
+/// </summary>
+/// <param name="list">保存するリスト</param>
+/// <param name="path">保存先のパス</param>
+/// <returns>保存に成功した場合はtrue</returns>
+inline bool SaveSnapshot(const LinkedList<PlayerScore>& list, const std::string& path)
+{
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	// ヘッダはチェックサムが確定してから書き直すので、先に場所だけ確保する
+	char headerBytes[SnapshotHeader::Size] = {};
+	file.write(headerBytes, sizeof(headerBytes));
+
+	SnapshotChecksum checksum;
+	uint64_t payloadSize = 0;
+	std::string buffer;
+	buffer.reserve(ScoreWriter::DefaultBufferSize + 64);
+
+	list.ForEach([&](const PlayerScore& playerScore)
+	{
+		ScoreWriter::AppendRow(buffer, playerScore, ScoreFormat::Binary);
+		if (buffer.size() >= ScoreWriter::DefaultBufferSize)
+		{
+			// チェックサムは8バイト単位で計算するため、端数は次のチャンクへ持ち越す
+			const size_t flushSize = buffer.size() & ~static_cast<size_t>(7);
+			checksum.Update(buffer.data(), flushSize);
+			file.write(buffer.data(), static_cast<std::streamsize>(flushSize));
+			payloadSize += flushSize;
+			buffer.erase(0, flushSize);
+		}
+	});
+
+	checksum.Update(buffer.data(), buffer.size());
+	file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+	payloadSize += buffer.size();
+
+	SnapshotHeader header = { SnapshotHeader::CurrentVersion, list.Count(), payloadSize, checksum.Value() };
+	SnapshotDetail::EncodeHeader(headerBytes, header);
+
+	file.seekp(0);
+	file.write(headerBytes, sizeof(headerBytes));
+	file.close();
+
+	return !file.fail();
+}
+
+/// <summary>
+/// スナップショットファイルからリストを復元
+/// ファイルをマップし、ヘッダ・チェックサム・レコード構造を検証してから全ノードを1つのブロックにまとめて構築する
+/// 別のリストへ構築し終えてから入れ替えるため、検証に失敗した場合も構築中に例外が発生した場合もリストは変更しない
+/// </summary>
+/// <param name="list">復元先のリスト（成功時は元の内容を破棄して置き換える）</param>
+/// <param name="path">スナップショットファイルのパス</param>
+/// <returns>復元に成功した場合はtrue</returns>
+inline bool LoadSnapshot(LinkedList<PlayerScore>& list, const std::string& path)
+{
+	MappedFile file(path);
+	const char* data = file.Data();
+	if (!data || file.Size() < SnapshotHeader::Size || std::memcmp(data, SnapshotHeader::Magic, 8) != 0)
+	{
+		return false;
+	}
+
+	SnapshotHeader header;
+	header.version = static_cast<uint32_t>(SnapshotDetail::LoadUInt(data + 8, 4));
+	header.count = SnapshotDetail::LoadUInt(data + 16, 8);
+	header.payloadSize = SnapshotDetail::LoadUInt(data + 24, 8);
+	header.checksum = SnapshotDetail::LoadUInt(data + 32, 8);
+
+	if (header.version != SnapshotHeader::CurrentVersion || header.payloadSize != file.Size() - SnapshotHeader::Size)
+	{
+		return false;
+	}
+
+	const char* payload = data + SnapshotHeader::Size;
+	const size_t payloadSize = static_cast<size_t>(header.payloadSize);
+
+	SnapshotChecksum checksum;
+	checksum.Update(payload, payloadSize);
+	if (checksum.Value() != header.checksum)
+	{
+		return false;
+	}
+
+	// レコードの長さがペイロードに収まり、件数がヘッダと一致するか確認する
+	size_t offset = 0;
+	uint64_t records = 0;
+	while (offset < payloadSize)
+	{
+		if (payloadSize - offset < 8)
+		{
+			return false;
+		}
+		const size_t idLength = static_cast<size_t>(SnapshotDetail::LoadUInt(payload + offset + 4, 4));
+		if (payloadSize - offset - 8 < idLength)
+		{
+			return false;
+		}
+		offset += 8 + idLength;
+		records++;
+	}
+	if (records != header.count)
+	{
+		return false;
+	}
+
+	LinkedList<PlayerScore> restored;
+	offset = 0;
+	restored.InsertBulk(restored.End(), static_cast<size_t>(header.count), [payload, &offset](size_t)
+	{
+		const int score = static_cast<int>(static_cast<uint32_t>(SnapshotDetail::LoadUInt(payload + offset, 4)));
+		const size_t idLength = static_cast<size_t>(SnapshotDetail::LoadUInt(payload + offset + 4, 4));
+		const char* id = payload + offset + 8;
+		offset += 8 + idLength;
+		return PlayerScore(score, std::string(id, idLength));
+	});
+
+	// 入れ替えではリストの設定は変わらず、元の要素はrestoredと一緒に解放される
+	list.Swap(restored);
+	return true;
+}
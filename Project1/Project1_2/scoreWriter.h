@@ -0,0 +1,428 @@
+#pragma once
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "boundedQueue.h"
+#include "errorPolicy.h"
+#include "linkedList.h"
+#include "playerScore.h"
+
+/// <summary>
+/// スコア出力フォーマット
+/// </summary>
+enum class ScoreFormat
+{
+	// "Score: <score>	ID: <id>" 形式（従来の標準出力と同じ）
+	Text,
+	// "<score>,<id>" 形式
+	Csv,
+	// "<score>	<id>" 形式（Scores.txtと同じで、LoadScoresで読み込める）
+	Tsv,
+	// [int32 score][uint32 idの長さ][idのバイト列] をリトルエンディアンで連結した形式
+	Binary,
+};
+
+/// <summary>
+/// PlayerScoreを大きなバッファにまとめて書き出すライター
+/// 1行ごとのフラッシュやiostreamの書式処理を避け、std::to_charsで整形してからまとめて書き込む
+/// 並列に整形する際のスレッドは最初のWriteAllで作成し、ライターを破棄するまで使い回す
+/// </summary>
+class ScoreWriter
+{
+public:
+	static constexpr size_t DefaultBufferSize = 1 << 20;
+
+	/// <summary>
+	/// ファイルディスクリプタへ書き出すライターを作成
+	/// </summary>
+	/// <param name="fd">書き込み先のファイルディスクリプタ（所有権は移らない）</param>
+	/// <param name="format">出力フォーマット</param>
+	/// <param name="bufferSize">書き込み単位となるバッファサイズ</param>
+	ScoreWriter(int fd, ScoreFormat format = ScoreFormat::Text, size_t bufferSize = DefaultBufferSize)
+		: mFd(fd), mFile(nullptr), mFormat(format), mBufferSize(bufferSize), mGood(fd >= 0), mJobs(JobQueueCapacity)
+	{
+		mBuffer.reserve(mBufferSize);
+	}
+
+	/// <summary>
+	/// FILEへ書き出すライターを作成
+	/// </summary>
+	/// <param name="file">書き込み先のファイル（所有権は移らない）</param>
+	/// <param name="format">出力フォーマット</param>
+	/// <param name="bufferSize">書き込み単位となるバッファサイズ</param>
+	ScoreWriter(std::FILE* file, ScoreFormat format = ScoreFormat::Text, size_t bufferSize = DefaultBufferSize)
+		: mFd(-1), mFile(file), mFormat(format), mBufferSize(bufferSize), mGood(file != nullptr), mJobs(JobQueueCapacity)
+	{
+		mBuffer.reserve(mBufferSize);
+	}
+
+	ScoreWriter(const ScoreWriter&) = delete;
+	ScoreWriter& operator=(const ScoreWriter&) = delete;
+
+	~ScoreWriter()
+	{
+		Flush();
+
+		mJobs.Close();
+		for (auto& worker : mWorkers)
+		{
+			worker.join();
+		}
+	}
+
+	/// <summary>
+	/// 1件のスコアをバッファに追加し、バッファが一杯になったら書き出す
+	/// </summary>
+	/// <param name="playerScore">出力するスコア</param>
+	void Write(const PlayerScore& playerScore)
+	{
+		AppendRow(mBuffer, playerScore, mFormat);
+		if (mBuffer.size() >= mBufferSize)
+		{
+			Flush();
+		}
+	}
+
+	/// <summary>
+	/// リストの全要素をリスト順に書き出す
+	/// 並列時は整形済みのチャンクを呼び出しスレッドが順に書き出し、その間も後続のチャンクの整形を続ける
+	/// </summary>
+	/// <param name="list">出力するリスト</param>
+	/// <param name="threadCount">整形に使うスレッド数（1以下なら呼び出しスレッドのみで処理）</param>
+	void WriteAll(const LinkedList<PlayerScore>& list, unsigned threadCount = 1)
+	{
+		if (threadCount <= 1 || list.Count() < ParallelChunkRows * 2)
+		{
+			list.ForEach([this](const PlayerScore& playerScore)
+			{
+				Write(playerScore);
+			});
+			return;
+		}
+
+		// リストは分割できないので、先に要素へのポインタを集めてからチャンク単位で並列に整形する
+		std::vector<const PlayerScore*> rows;
+		rows.reserve(list.Count());
+		list.ForEach([&rows](const PlayerScore& playerScore)
+		{
+			rows.push_back(&playerScore);
+		});
+
+		Flush();
+		StartWorkers(threadCount);
+
+		// 書き出し待ちのチャンクを整形スレッド数の2倍まで先行させる
+		// i番目のチャンクは mSlots[i % mSlots.size()] に整形され、書き出し終えた枠に次のチャンクを割り当てる
+		mSlots.resize(threadCount * 2);
+		const size_t chunkCount = (rows.size() + ParallelChunkRows - 1) / ParallelChunkRows;
+		size_t submitted = 0;
+		SlotDrainer drainer{ *this, submitted };
+		auto submit = [this, &rows, &submitted]()
+		{
+			FormatSlot& slot = mSlots[submitted % mSlots.size()];
+			slot.ready = false;
+			slot.error = CapturedException();
+			const size_t begin = submitted * ParallelChunkRows;
+			mJobs.Push(FormatJob{ rows.data() + begin, rows.data() + std::min(begin + ParallelChunkRows, rows.size()), &slot });
+			submitted++;
+		};
+		while (submitted < std::min(chunkCount, mSlots.size()))
+		{
+			submit();
+		}
+
+		// 整形に失敗した場合は新たな割り当てをやめ、割り当て済みのチャンクが終わるのを待ってから送り直す
+		CapturedException error;
+		for (size_t chunk = 0; chunk < submitted; chunk++)
+		{
+			FormatSlot& slot = mSlots[chunk % mSlots.size()];
+			{
+				std::unique_lock<std::mutex> lock(mSlotMutex);
+				mSlotReady.wait(lock, [&slot]() { return slot.ready; });
+			}
+
+			if (slot.error && !error)
+			{
+				error = slot.error;
+			}
+			if (error)
+			{
+				continue;
+			}
+
+			WriteRaw(slot.buffer.data(), slot.buffer.size());
+			if (submitted < chunkCount && mGood)
+			{
+				submit();
+			}
+		}
+		error.RethrowIfAny();
+	}
+
+	/// <summary>
+	/// バッファに溜まっているデータを書き出す
+	/// </summary>
+	/// <returns>これまでの書き込みがすべて成功していればtrue</returns>
+	bool Flush()
+	{
+		if (!mBuffer.empty())
+		{
+			WriteRaw(mBuffer.data(), mBuffer.size());
+			mBuffer.clear();
+		}
+		if (mFile)
+		{
+			mGood = (std::fflush(mFile) == 0) && mGood;
+		}
+		return mGood;
+	}
+
+	/// <summary>
+	/// 書き込みエラーが発生していないかチェック
+	/// </summary>
+	/// <returns>エラーが無ければtrue</returns>
+	bool Good() const
+	{
+		return mGood;
+	}
+
+	/// <summary>
+	/// 1件のスコアを指定フォーマットで文字列の末尾に追加
+	/// </summary>
+	/// <param name="out">追加先</param>
+	/// <param name="playerScore">整形するスコア</param>
+	/// <param name="format">出力フォーマット</param>
+	static void AppendRow(std::string& out, const PlayerScore& playerScore, ScoreFormat format)
+	{
+		switch (format)
+		{
+		case ScoreFormat::Text:
+			out.append("Score: ");
+			AppendInt(out, playerScore.score);
+			out.append("	ID: ");
+			out.append(playerScore.id);
+			out.push_back('\n');
+			break;
+
+		case ScoreFormat::Csv:
+			AppendInt(out, playerScore.score);
+			out.push_back(',');
+			AppendCsvField(out, playerScore.id);
+			out.push_back('\n');
+			break;
+
+		case ScoreFormat::Tsv:
+			AppendInt(out, playerScore.score);
+			out.push_back('	');
+			out.append(playerScore.id);
+			out.push_back('\n');
+			break;
+
+		case ScoreFormat::Binary:
+			AppendUInt32(out, static_cast<uint32_t>(playerScore.score));
+			AppendUInt32(out, static_cast<uint32_t>(playerScore.id.size()));
+			out.append(playerScore.id);
+			break;
+		}
+	}
+
+private:
+	// 並列整形時の1チャンクあたりの行数
+	static constexpr size_t ParallelChunkRows = 64 * 1024;
+	// 整形スレッドへ渡す仕事のキューの容量
+	static constexpr size_t JobQueueCapacity = 16;
+
+	// 整形結果を書き出しまで保持する枠
+	struct FormatSlot
+	{
+		std::string buffer;
+		// 整形を終えたか（mSlotMutexで保護する）
+		bool ready = false;
+		CapturedException error;
+	};
+
+	// 整形スレッドへ渡す仕事（[begin, end) の行をslotへ整形する）
+	struct FormatJob
+	{
+		const PlayerScore* const* begin = nullptr;
+		const PlayerScore* const* end = nullptr;
+		FormatSlot* slot = nullptr;
+	};
+
+	// WriteAllを抜ける際に、整形スレッドへ渡したチャンクがすべて整形を終えるまで待つ
+	// 仕事の追加や書き出しが例外で中断しても、整形スレッドがmSlotsへ書き込んでいる間に抜けないようにする
+	struct SlotDrainer
+	{
+		ScoreWriter& writer;
+		// 整形スレッドへ渡したチャンクの数（各枠を最後に使ったチャンクだけを待てばよい）
+		const size_t& submitted;
+
+		~SlotDrainer()
+		{
+			const size_t slotCount = writer.mSlots.size();
+			std::unique_lock<std::mutex> lock(writer.mSlotMutex);
+			for (size_t chunk = submitted > slotCount ? submitted - slotCount : 0; chunk < submitted; chunk++)
+			{
+				const FormatSlot& slot = writer.mSlots[chunk % slotCount];
+				writer.mSlotReady.wait(lock, [&slot]() { return slot.ready; });
+			}
+		}
+	};
+
+	int mFd;
+	std::FILE* mFile;
+	ScoreFormat mFormat;
+	size_t mBufferSize;
+	bool mGood;
+	std::string mBuffer;
+
+	BoundedQueue<FormatJob> mJobs;
+	std::vector<std::thread> mWorkers;
+	// WriteAllの呼び出しをまたいで使い回し、整形用のバッファを再確保しないようにする
+	std::vector<FormatSlot> mSlots;
+	std::mutex mSlotMutex;
+	std::condition_variable mSlotReady;
+
+	/// <summary>
+	/// 整形スレッドがthreadCount個に満たなければ追加で起動する
+	/// </summary>
+	void StartWorkers(unsigned threadCount)
+	{
+		while (mWorkers.size() < threadCount)
+		{
+			mWorkers.emplace_back([this]() { FormatWorker(); });
+		}
+	}
+
+	/// <summary>
+	/// 整形スレッドの処理（キューが閉じられるまで仕事を受け取って整形する）
+	/// </summary>
+	void FormatWorker()
+	{
+		FormatJob job;
+		while (mJobs.Pop(job))
+		{
+			CapturedException error;
+			LINKEDLIST_TRY
+			{
+				job.slot->buffer.clear();
+				for (const PlayerScore* const* row = job.begin; row != job.end; row++)
+				{
+					AppendRow(job.slot->buffer, **row, mFormat);
+				}
+			}
+			LINKEDLIST_CATCH_ALL
+			{
+				error = CapturedException::Current();
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(mSlotMutex);
+				job.slot->error = error;
+				job.slot->ready = true;
+			}
+			mSlotReady.notify_all();
+		}
+	}
+
+	/// <summary>
+	/// 整数を10進数で追加
+	/// </summary>
+	static void AppendInt(std::string& out, int value)
+	{
+		char digits[16];
+		auto result = std::to_chars(digits, digits + sizeof(digits), value);
+		out.append(digits, result.ptr);
+	}
+
+	/// <summary>
+	/// 32bit値をリトルエンディアンで追加
+	/// </summary>
+	static void AppendUInt32(std::string& out, uint32_t value)
+	{
+		const char bytes[4] =
+		{
+			static_cast<char>(value & 0xFF),
+			static_cast<char>((value >> 8) & 0xFF),
+			static_cast<char>((value >> 16) & 0xFF),
+			static_cast<char>((value >> 24) & 0xFF),
+		};
+		out.append(bytes, sizeof(bytes));
+	}
+
+	/// <summary>
+	/// CSVのフィールドを追加（区切り文字や引用符を含む場合のみ引用符で囲む）
+	/// </summary>
+	static void AppendCsvField(std::string& out, const std::string& field)
+	{
+		if (field.find_first_of(",\"\r\n") == std::string::npos)
+		{
+			out.append(field);
+			return;
+		}
+
+		out.push_back('"');
+		for (char c : field)
+		{
+			if (c == '"')
+			{
+				out.push_back('"');
+			}
+			out.push_back(c);
+		}
+		out.push_back('"');
+	}
+
+	/// <summary>
+	/// 書き込み先へバイト列をそのまま書き出す
+	/// </summary>
+	void WriteRaw(const char* data, size_t size)
+	{
+		if (!mGood)
+		{
+			return;
+		}
+
+		if (mFile)
+		{
+			mGood = std::fwrite(data, 1, size, mFile) == size;
+			return;
+		}
+
+		// 部分書き込みに備えて全て書き終わるまで繰り返す
+		while (size > 0)
+		{
+#ifdef _WIN32
+			const unsigned int request = static_cast<unsigned int>(std::min<size_t>(size, 1u << 30));
+			const int written = _write(mFd, data, request);
+#else
+			const ssize_t written = ::write(mFd, data, size);
+			if (written < 0 && errno == EINTR)
+			{
+				continue;
+			}
+#endif
+			if (written <= 0)
+			{
+				mGood = false;
+				return;
+			}
+			data += written;
+			size -= static_cast<size_t>(written);
+		}
+	}
+};
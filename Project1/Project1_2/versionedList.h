@@ -0,0 +1,698 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#include "errorPolicy.h"
+
+/// <summary>
+/// 読み取り側が不変のスナップショットを取得して走査できる、バージョン管理付きのリスト
+/// 要素は最大ChunkCapacity個ずつの葉に格納され、葉は各子の要素数を持つ木でまとめる（位置の検索はO(log n)）
+/// 書き込み時は根から変更する葉までの経路にあるノードだけを複製し、それ以外のノードは新旧のバージョンで共有する
+/// 古いバージョンは最後のスナップショットが解放された時点で破棄される
+/// </summary>
+/// <typeparam name="T">リストに格納する要素の型</typeparam>
+/// <typeparam name="ChunkCapacity">1つの葉あたりの最大要素数</typeparam>
+template <typename T, size_t ChunkCapacity = 64>
+class VersionedList
+{
+private:
+	static_assert(ChunkCapacity >= 2, "ChunkCapacity must be at least 2");
+
+	// 内部ノードあたりの最大の子の数
+	static constexpr size_t BranchCapacity = 16;
+
+	// 木のノード（葉はitemsに要素を、内部ノードはchildrenとcountsに子と子ごとの要素数を持つ）
+	// ownerと同じ番号の書き込みトランザクションだけが書き換えてよく、公開後は変更しない
+	struct Node
+	{
+		uint64_t owner = 0;
+		bool leaf = true;
+		size_t count = 0;
+		std::vector<T> items;
+		std::vector<std::shared_ptr<Node>> children;
+		std::vector<size_t> counts;
+	};
+
+	// ある時点のリスト全体
+	struct Version
+	{
+		std::shared_ptr<Node> root;
+		size_t count = 0;
+		uint64_t number = 0;
+	};
+
+	std::atomic<std::shared_ptr<const Version>> mCurrent;
+	std::mutex mWriteMutex;
+
+	/// <summary>
+	/// 内部ノードの中からindex番目の要素を含む子を求め、indexを子の中での位置に直す
+	/// indexがノードの要素数と等しい場合は最後の子を返す
+	/// </summary>
+	static size_t ChildAt(const Node& node, size_t& index)
+	{
+		size_t child = 0;
+		while (child + 1 < node.counts.size() && index >= node.counts[child])
+		{
+			index -= node.counts[child];
+			child++;
+		}
+		return child;
+	}
+
+	/// <summary>
+	/// index番目の要素を含む葉を求め、indexを葉の中での位置に直す
+	/// </summary>
+	static const Node* FindLeaf(const Node* node, size_t& index)
+	{
+		while (!node->leaf)
+		{
+			node = node->children[ChildAt(*node, index)].get();
+		}
+		return node;
+	}
+
+public:
+	/// <summary>
+	/// スナップショットの要素を先頭から走査するコンストイテレータ
+	/// 葉の中は順に進み、次の葉へ移るときだけ木をたどり直す
+	/// </summary>
+	class ConstIterator
+	{
+	private:
+		const Version* mVersion;
+		size_t mIndex;
+		const Node* mLeaf;
+		size_t mOffset;
+		friend class VersionedList<T, ChunkCapacity>;
+
+		ConstIterator(const Version* version, size_t index) : mVersion(version), mIndex(index), mLeaf(nullptr), mOffset(0)
+		{
+			Seek();
+		}
+
+		void Seek()
+		{
+			mLeaf = nullptr;
+			mOffset = mIndex;
+			if (mIndex < mVersion->count)
+			{
+				mLeaf = FindLeaf(mVersion->root.get(), mOffset);
+			}
+		}
+
+	public:
+		ConstIterator() : mVersion(nullptr), mIndex(0), mLeaf(nullptr), mOffset(0)
+		{
+		}
+
+		/// <summary>
+		/// イテレータの指す要素を取得
+		/// </summary>
+		const T& operator*() const
+		{
+			if (!mLeaf)
+			{
+				ReportMisuse("Invalid iterator");
+			}
+			return mLeaf->items[mOffset];
+		}
+
+		/// <summary>
+		/// アロー演算子
+		/// </summary>
+		const T* operator->() const
+		{
+			return &**this;
+		}
+
+		/// <summary>
+		/// 前置インクリメント
+		/// </summary>
+		ConstIterator& operator++()
+		{
+			if (!mLeaf)
+			{
+				ReportMisuse("Invalid iterator");
+			}
+			mIndex++;
+			if (++mOffset == mLeaf->items.size())
+			{
+				Seek();
+			}
+			return *this;
+		}
+
+		/// <summary>
+		/// 後置インクリメント
+		/// </summary>
+		ConstIterator operator++(int)
+		{
+			ConstIterator temp = *this;
+			++*this;
+			return temp;
+		}
+
+		/// <summary>
+		/// 等価比較
+		/// </summary>
+		bool operator==(const ConstIterator& other) const
+		{
+			return mVersion == other.mVersion && mIndex == other.mIndex;
+		}
+
+		/// <summary>
+		/// 非等価比較
+		/// </summary>
+		bool operator!=(const ConstIterator& other) const
+		{
+			return !(*this == other);
+		}
+	};
+
+	/// <summary>
+	/// ある時点のリストへの不変なハンドル
+	/// 保持している間は対応するバージョンが解放されず、書き込みの影響も受けない
+	/// </summary>
+	class Snapshot
+	{
+	private:
+		std::shared_ptr<const Version> mVersion;
+		friend class VersionedList<T, ChunkCapacity>;
+
+		explicit Snapshot(std::shared_ptr<const Version> version) : mVersion(std::move(version))
+		{
+		}
+
+	public:
+		/// <summary>
+		/// 先頭コンストイテレータ取得
+		/// </summary>
+		ConstIterator CBegin() const
+		{
+			return ConstIterator(mVersion.get(), 0);
+		}
+
+		/// <summary>
+		/// 末尾の次を指すコンストイテレータ取得
+		/// </summary>
+		ConstIterator CEnd() const
+		{
+			return ConstIterator(mVersion.get(), mVersion->count);
+		}
+
+		/// <summary>
+		/// スナップショット内の要素数を取得
+		/// </summary>
+		size_t Count() const
+		{
+			return mVersion->count;
+		}
+
+		/// <summary>
+		/// スナップショットのバージョン番号を取得（コミットごとに1ずつ増える）
+		/// </summary>
+		uint64_t VersionNumber() const
+		{
+			return mVersion->number;
+		}
+
+		/// <summary>
+		/// 木の高さを取得（空なら0、葉だけなら1）
+		/// </summary>
+		size_t Height() const
+		{
+			size_t height = 0;
+			for (const Node* node = mVersion->root.get(); node; node = node->leaf ? nullptr : node->children.front().get())
+			{
+				height++;
+			}
+			return height;
+		}
+
+		/// <summary>
+		/// 木のノード数を取得（全ノードをたどる）
+		/// </summary>
+		size_t NodeCount() const
+		{
+			return mVersion->root ? CountNodes(*mVersion->root) : 0;
+		}
+
+	private:
+		static size_t CountNodes(const Node& node)
+		{
+			size_t count = 1;
+			for (const std::shared_ptr<Node>& child : node.children)
+			{
+				count += CountNodes(*child);
+			}
+			return count;
+		}
+	};
+
+	/// <summary>
+	/// 書き込みトランザクション
+	/// 生存中は他の書き込みを待たせるが、読み取り側は一切待たせない
+	/// Commit()するまで変更は読み取り側から見えず、Commit()せずに破棄すると変更は捨てられる
+	/// 編集中の木は最初の変更まで公開済みのバージョンと共有し、変更のたびに必要な経路だけを複製する
+	/// 同じトランザクション内で一度複製したノードは、それ以降は複製せずにそのまま書き換える
+	/// </summary>
+	class Writer
+	{
+	private:
+		VersionedList* mList;
+		std::unique_lock<std::mutex> mLock;
+		std::shared_ptr<Node> mRoot;
+		size_t mCount;
+		// 次に公開するバージョンの番号（ownerがこの番号のノードはこのトランザクションで作ったもの）
+		uint64_t mNumber;
+		friend class VersionedList<T, ChunkCapacity>;
+
+		explicit Writer(VersionedList* list) : mList(list), mLock(list->mWriteMutex)
+		{
+			std::shared_ptr<const Version> current = mList->mCurrent.load(std::memory_order_acquire);
+			mRoot = current->root;
+			mCount = current->count;
+			mNumber = current->number + 1;
+		}
+
+	public:
+		Writer(Writer&&) = default;
+
+		/// <summary>
+		/// 編集中のリストの要素数を取得
+		/// </summary>
+		size_t Count() const
+		{
+			return mCount;
+		}
+
+		/// <summary>
+		/// 編集中のリストのindex番目の要素を取得
+		/// </summary>
+		const T& At(size_t index) const
+		{
+			CheckIndex(index, mCount);
+			const Node* leaf = FindLeaf(mRoot.get(), index);
+			return leaf->items[index];
+		}
+
+		/// <summary>
+		/// 末尾に要素を追加
+		/// </summary>
+		void PushBack(const T& value)
+		{
+			Insert(mCount, value);
+		}
+
+		/// <summary>
+		/// index番目の位置の前に要素を挿入（indexがCount()の場合は末尾に追加）
+		/// </summary>
+		void Insert(size_t index, const T& value)
+		{
+			CheckIndex(index, mCount + 1);
+			if (!mRoot)
+			{
+				mRoot = NewNode(true);
+			}
+
+			std::shared_ptr<Node> sibling = InsertInto(mRoot, index, value);
+			if (sibling)
+			{
+				// 根があふれたら1段高くする
+				std::shared_ptr<Node> root = NewNode(false);
+				root->count = mRoot->count + sibling->count;
+				root->counts.push_back(mRoot->count);
+				root->counts.push_back(sibling->count);
+				root->children.push_back(std::move(mRoot));
+				root->children.push_back(std::move(sibling));
+				mRoot = std::move(root);
+			}
+			mCount++;
+		}
+
+		/// <summary>
+		/// index番目の要素を削除
+		/// </summary>
+		void Remove(size_t index)
+		{
+			CheckIndex(index, mCount);
+			RemoveFrom(mRoot, index);
+			mCount--;
+
+			// 空になった木や、子が1つだけになった根は取り除く
+			if (mCount == 0)
+			{
+				mRoot.reset();
+			}
+			while (mRoot && !mRoot->leaf && mRoot->children.size() == 1)
+			{
+				mRoot = mRoot->children.front();
+			}
+		}
+
+		/// <summary>
+		/// index番目の要素を書き換える
+		/// </summary>
+		void Set(size_t index, const T& value)
+		{
+			CheckIndex(index, mCount);
+			std::shared_ptr<Node>* slot = &mRoot;
+			while (true)
+			{
+				Node& node = Mutable(*slot);
+				if (node.leaf)
+				{
+					node.items[index] = value;
+					return;
+				}
+				slot = &node.children[ChildAt(node, index)];
+			}
+		}
+
+		/// <summary>
+		/// 変更を新しいバージョンとして公開
+		/// 公開後もトランザクションは続けて使え、以降の変更は次のバージョンになる
+		/// 公開した木はそのまま次の変更の起点になり、複製はしない
+		/// </summary>
+		/// <returns>公開したバージョンのスナップショット</returns>
+		Snapshot Commit()
+		{
+			auto published = std::make_shared<Version>();
+			published->root = mRoot;
+			published->count = mCount;
+			published->number = mNumber;
+			std::shared_ptr<const Version> version = std::move(published);
+			mList->mCurrent.store(version, std::memory_order_release);
+
+			// 公開したノードは読み取り側と共有されるので、番号を進めて次の変更では再び複製させる
+			mNumber++;
+
+			return Snapshot(std::move(version));
+		}
+
+	private:
+		static void CheckIndex(size_t index, size_t limit)
+		{
+			if (index >= limit)
+			{
+				LINKEDLIST_THROW(std::out_of_range("Invalid index"));
+			}
+		}
+
+		/// <summary>
+		/// このトランザクションが持つ空のノードを作成
+		/// 分割前に1つあふれるまでの領域を確保しておき、挿入の途中で確保に失敗しないようにする
+		/// </summary>
+		std::shared_ptr<Node> NewNode(bool leaf) const
+		{
+			auto node = std::make_shared<Node>();
+			node->owner = mNumber;
+			node->leaf = leaf;
+			if (leaf)
+			{
+				node->items.reserve(ChunkCapacity + 1);
+			}
+			else
+			{
+				node->children.reserve(BranchCapacity + 1);
+				node->counts.reserve(BranchCapacity + 1);
+			}
+			return node;
+		}
+
+		/// <summary>
+		/// 書き換え可能なノードを取得（共有中のノードであれば複製してslotを差し替えてから返す）
+		/// </summary>
+		Node& Mutable(std::shared_ptr<Node>& slot)
+		{
+			if (slot->owner != mNumber)
+			{
+				std::shared_ptr<Node> copy = NewNode(slot->leaf);
+				copy->count = slot->count;
+				copy->items.assign(slot->items.begin(), slot->items.end());
+				copy->children.assign(slot->children.begin(), slot->children.end());
+				copy->counts.assign(slot->counts.begin(), slot->counts.end());
+				slot = std::move(copy);
+			}
+			return *slot;
+		}
+
+		/// <summary>
+		/// slot以下のindex番目の位置に要素を挿入
+		/// </summary>
+		/// <returns>あふれて分割した場合は後ろ半分のノード、そうでなければnullptr</returns>
+		std::shared_ptr<Node> InsertInto(std::shared_ptr<Node>& slot, size_t index, const T& value)
+		{
+			Node& node = Mutable(slot);
+			if (node.leaf)
+			{
+				node.items.insert(node.items.begin() + index, value);
+				node.count++;
+				if (node.items.size() <= ChunkCapacity)
+				{
+					return nullptr;
+				}
+				return Split(node, index + 1 == node.items.size());
+			}
+
+			const size_t child = ChildAt(node, index);
+			std::shared_ptr<Node> sibling = InsertInto(node.children[child], index, value);
+			node.count++;
+			node.counts[child]++;
+			if (!sibling)
+			{
+				return nullptr;
+			}
+
+			node.counts[child] = node.children[child]->count;
+			node.counts.insert(node.counts.begin() + child + 1, sibling->count);
+			node.children.insert(node.children.begin() + child + 1, std::move(sibling));
+			if (node.children.size() <= BranchCapacity)
+			{
+				return nullptr;
+			}
+			return Split(node, child + 2 == node.children.size());
+		}
+
+		/// <summary>
+		/// あふれたノードを2つに分割
+		/// 末尾への追加であふれた場合は最後の1つだけを移し、末尾への追加が続いてもノードが満杯のまま並ぶようにする
+		/// </summary>
+		/// <returns>後ろ側のノード</returns>
+		std::shared_ptr<Node> Split(Node& node, bool appended)
+		{
+			std::shared_ptr<Node> tail = NewNode(node.leaf);
+			if (node.leaf)
+			{
+				const size_t at = appended ? node.items.size() - 1 : node.items.size() / 2;
+				tail->items.assign(std::make_move_iterator(node.items.begin() + at), std::make_move_iterator(node.items.end()));
+				node.items.erase(node.items.begin() + at, node.items.end());
+				tail->count = tail->items.size();
+			}
+			else
+			{
+				const size_t at = appended ? node.children.size() - 1 : node.children.size() / 2;
+				tail->children.assign(std::make_move_iterator(node.children.begin() + at), std::make_move_iterator(node.children.end()));
+				tail->counts.assign(node.counts.begin() + at, node.counts.end());
+				node.children.erase(node.children.begin() + at, node.children.end());
+				node.counts.erase(node.counts.begin() + at, node.counts.end());
+				for (size_t count : tail->counts)
+				{
+					tail->count += count;
+				}
+			}
+			node.count -= tail->count;
+			return tail;
+		}
+
+		/// <summary>
+		/// slot以下のindex番目の要素を削除
+		/// 子が容量の半分を下回ったら隣の子から1つ借りるか、借りられなければ隣の子と併合する
+		/// </summary>
+		void RemoveFrom(std::shared_ptr<Node>& slot, size_t index)
+		{
+			Node& node = Mutable(slot);
+			if (node.leaf)
+			{
+				node.items.erase(node.items.begin() + index);
+				node.count--;
+				return;
+			}
+
+			const size_t child = ChildAt(node, index);
+			RemoveFrom(node.children[child], index);
+			node.count--;
+			node.counts[child]--;
+			if (Width(*node.children[child]) < MinWidth(*node.children[child]) && node.children.size() > 1)
+			{
+				Rebalance(node, child);
+			}
+		}
+
+		/// <summary>
+		/// ノードの幅（葉は要素数、内部ノードは子の数）
+		/// </summary>
+		static size_t Width(const Node& node)
+		{
+			return node.leaf ? node.items.size() : node.children.size();
+		}
+
+		/// <summary>
+		/// 削除後に保つ最小の幅（容量の半分）
+		/// </summary>
+		static size_t MinWidth(const Node& node)
+		{
+			return (node.leaf ? ChunkCapacity : BranchCapacity) / 2;
+		}
+
+		/// <summary>
+		/// 容量の半分を下回ったchild番目の子を隣の子とならす
+		/// 隣に余裕があれば端の1つを借り、なければ2つを前側の子に併合する（併合後も容量を超えない）
+		/// </summary>
+		void Rebalance(Node& node, size_t child)
+		{
+			const size_t left = child > 0 ? child - 1 : child;
+			const size_t right = left + 1;
+			// 書き換える前に両方を複製しておき、複製に失敗しても木は整合したまま残す
+			Node& front = Mutable(node.children[left]);
+			Node& back = Mutable(node.children[right]);
+			const Node& sibling = child == left ? back : front;
+
+			if (Width(sibling) > MinWidth(sibling))
+			{
+				if (child == left)
+				{
+					MoveFront(back, front);
+				}
+				else
+				{
+					MoveBack(front, back);
+				}
+				node.counts[left] = front.count;
+				node.counts[right] = back.count;
+				return;
+			}
+
+			if (front.leaf)
+			{
+				front.items.insert(front.items.end(), std::make_move_iterator(back.items.begin()), std::make_move_iterator(back.items.end()));
+			}
+			else
+			{
+				front.children.insert(front.children.end(), std::make_move_iterator(back.children.begin()), std::make_move_iterator(back.children.end()));
+				front.counts.insert(front.counts.end(), back.counts.begin(), back.counts.end());
+			}
+			front.count += back.count;
+			node.counts[left] = front.count;
+			node.children.erase(node.children.begin() + right);
+			node.counts.erase(node.counts.begin() + right);
+		}
+
+		/// <summary>
+		/// fromの先頭の要素（または子）をtoの末尾へ移す
+		/// </summary>
+		static void MoveFront(Node& from, Node& to)
+		{
+			size_t moved;
+			if (from.leaf)
+			{
+				to.items.push_back(std::move(from.items.front()));
+				from.items.erase(from.items.begin());
+				moved = 1;
+			}
+			else
+			{
+				moved = from.counts.front();
+				to.children.push_back(std::move(from.children.front()));
+				to.counts.push_back(moved);
+				from.children.erase(from.children.begin());
+				from.counts.erase(from.counts.begin());
+			}
+			from.count -= moved;
+			to.count += moved;
+		}
+
+		/// <summary>
+		/// fromの末尾の要素（または子）をtoの先頭へ移す
+		/// </summary>
+		static void MoveBack(Node& from, Node& to)
+		{
+			size_t moved;
+			if (from.leaf)
+			{
+				to.items.insert(to.items.begin(), std::move(from.items.back()));
+				from.items.pop_back();
+				moved = 1;
+			}
+			else
+			{
+				moved = from.counts.back();
+				to.children.insert(to.children.begin(), std::move(from.children.back()));
+				to.counts.insert(to.counts.begin(), moved);
+				from.children.pop_back();
+				from.counts.pop_back();
+			}
+			from.count -= moved;
+			to.count += moved;
+		}
+	};
+
+	VersionedList() : mCurrent(std::make_shared<const Version>())
+	{
+	}
+
+	VersionedList(const VersionedList&) = delete;
+	VersionedList& operator=(const VersionedList&) = delete;
+
+	/// <summary>
+	/// 最新バージョンのスナップショットを取得
+	/// 書き込み中でも待たされず、参照カウントを1つ増やすだけで済む
+	/// </summary>
+	/// <returns>スナップショット</returns>
+	Snapshot GetSnapshot() const
+	{
+		return Snapshot(mCurrent.load(std::memory_order_acquire));
+	}
+
+	/// <summary>
+	/// 書き込みトランザクションを開始（他の書き込みトランザクションが終わるまで待つ）
+	/// </summary>
+	/// <returns>書き込みトランザクション</returns>
+	Writer BeginWrite()
+	{
+		return Writer(this);
+	}
+
+	/// <summary>
+	/// 末尾に要素を1つ追加して即座に公開
+	/// </summary>
+	void PushBack(const T& value)
+	{
+		Writer writer = BeginWrite();
+		writer.PushBack(value);
+		writer.Commit();
+	}
+
+	/// <summary>
+	/// index番目の要素を削除して即座に公開
+	/// </summary>
+	void Remove(size_t index)
+	{
+		Writer writer = BeginWrite();
+		writer.Remove(index);
+		writer.Commit();
+	}
+
+	/// <summary>
+	/// 最新バージョンの要素数を取得
+	/// </summary>
+	size_t Count() const
+	{
+		return mCurrent.load(std::memory_order_acquire)->count;
+	}
+};
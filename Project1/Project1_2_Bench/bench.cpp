@@ -0,0 +1,385 @@
+﻿#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "compactPlayerScore.h"
+#include "linkedList.h"
+#include "playerScore.h"
+
+namespace
+{
+	/// <summary>
+	/// 処理時間を計測して1行出力
+	/// </summary>
+	template <typename Func>
+	void Measure(const char* name, size_t n, Func func)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		func();
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		std::printf("%-40s %10.3f ms  %8.2f ns/elem\n", name, seconds * 1e3, seconds * 1e9 / static_cast<double>(n));
+	}
+
+	/// <summary>
+	/// リスト上の順序とメモリ上の配置が無関係になるよう、ランダムな位置へ挿入してリストを作る
+	/// </summary>
+	template <typename T, typename Make>
+	void BuildScattered(LinkedList<T>& list, size_t n, Make make, std::mt19937& rng)
+	{
+		std::vector<typename LinkedList<T>::Iterator> positions;
+		positions.reserve(n);
+		for (size_t i = 0; i < n; i++)
+		{
+			auto position = positions.empty() ? list.End() : positions[rng() % positions.size()];
+			positions.push_back(list.Insert(position, make(i)));
+		}
+	}
+
+	// 最適化で計算が消されないよう結果を書き込む先
+	volatile long long gSink;
+
+	/// <summary>
+	/// 走査系の計測
+	/// </summary>
+	void BenchTraversal(size_t n)
+	{
+		std::printf("== traversal: LinkedList<int>, %zu scattered nodes ==\n", n);
+
+		std::mt19937 rng(12345);
+		LinkedList<int> list;
+		BuildScattered(list, n, [](size_t i) { return static_cast<int>(i); }, rng);
+
+		Measure("ConstIterator scan", n, [&]()
+		{
+			long long sum = 0;
+			for (auto it = list.CBegin(); it != list.CEnd(); ++it)
+			{
+				sum += *it;
+			}
+			gSink = sum;
+		});
+
+		for (size_t distance : { 0, 4, 8, 16, 32 })
+		{
+			const std::string name = "ForEach prefetch=" + std::to_string(distance);
+			Measure(name.c_str(), n, [&]()
+			{
+				long long sum = 0;
+				const LinkedList<int>& constList = list;
+				constList.ForEach([&sum](const int& value) { sum += value; }, distance);
+				gSink = sum;
+			});
+		}
+
+		Measure("Sort", n, [&]()
+		{
+			list.Sort([](int a, int b) { return a > b; });
+		});
+
+		// 直前のソートで降順に並んでいるので、昇順に並べ替えて計測する
+		Measure("RadixSortBy", n, [&]()
+		{
+			list.RadixSortBy([](int value) { return value; });
+		});
+
+		Measure("Relayout", n, [&]()
+		{
+			list.Relayout();
+		});
+
+		Measure("ConstIterator scan after Relayout", n, [&]()
+		{
+			long long sum = 0;
+			for (auto it = list.CBegin(); it != list.CEnd(); ++it)
+			{
+				sum += *it;
+			}
+			gSink = sum;
+		});
+
+		Measure("copy constructor", n, [&]()
+		{
+			LinkedList<int> copy(list);
+			gSink = static_cast<long long>(copy.Count());
+		});
+
+		Measure("Clean", n, [&]()
+		{
+			list.Clean();
+		});
+	}
+
+	/// <summary>
+	/// PlayerScoreを格納したリストの計測
+	/// </summary>
+	void BenchPlayerScore(size_t n)
+	{
+		std::printf("== traversal: LinkedList<PlayerScore>, %zu scattered nodes ==\n", n);
+
+		std::mt19937 rng(54321);
+		LinkedList<PlayerScore> list;
+		BuildScattered(list, n, [](size_t i) { return PlayerScore(static_cast<int>(i % 50000), "player" + std::to_string(i % 1000)); }, rng);
+
+		for (size_t distance : { 0, 8 })
+		{
+			const std::string name = "ForEach prefetch=" + std::to_string(distance);
+			Measure(name.c_str(), n, [&]()
+			{
+				long long sum = 0;
+				list.ForEach([&sum](const PlayerScore& playerScore) { sum += playerScore.score + playerScore.id.size(); }, distance);
+				gSink = sum;
+			});
+		}
+
+		Measure("Sort by score", n, [&]()
+		{
+			list.Sort([](const PlayerScore& a, const PlayerScore& b) { return a.score > b.score; });
+		});
+
+		// 直前のソートで降順に並んでいるので、昇順に並べ替えて計測する
+		Measure("RadixSortBy score", n, [&]()
+		{
+			list.RadixSortBy([](const PlayerScore& playerScore) { return playerScore.score; });
+		});
+
+		// スコアが下位半分の要素を削除する（ソート済みなので削除対象は先頭側に固まっている）
+		const int cutoff = 25000;
+		{
+			LinkedList<PlayerScore> copy(list);
+			Measure("Remove loop (score < cutoff)", n, [&]()
+			{
+				for (auto it = copy.Begin(); it != copy.End();)
+				{
+					it = (it->score < cutoff) ? copy.Remove(it) : ++it;
+				}
+			});
+		}
+		{
+			LinkedList<PlayerScore> copy(list);
+			Measure("RemoveIf (score < cutoff)", n, [&]()
+			{
+				gSink = static_cast<long long>(copy.RemoveIf([cutoff](const PlayerScore& playerScore) { return playerScore.score < cutoff; }));
+			});
+		}
+
+		Measure("Clean", n, [&]()
+		{
+			list.Clean();
+		});
+	}
+
+	/// <summary>
+	/// コピー・再配置・解放の計測（要素型が trivially copyable / trivially destructible かどうかで処理が変わる部分）
+	/// 散らばったリストはノードを1つずつたどって処理し、ブロックにまとまったリストは trivially copyable ならブロックごとmemcpyで複製し、
+	/// trivially destructible ならノードをたどらずにブロックごと解放する
+	/// 差が大きく出るのはソート後のようにリストの順序とメモリ上の配置が一致しない場合（shuffled の行）
+	/// </summary>
+	template <typename T, typename Make>
+	void BenchCopy(const char* typeName, size_t n, Make make)
+	{
+		std::printf("== copy: LinkedList<%s>, %zu nodes ==\n", typeName, n);
+
+		std::mt19937 rng(2468);
+		LinkedList<T> list;
+		BuildScattered(list, n, make, rng);
+
+		std::unique_ptr<LinkedList<T>> packed;
+		Measure("copy constructor (scattered)", n, [&]()
+		{
+			packed = std::make_unique<LinkedList<T>>(list);
+		});
+
+		std::unique_ptr<LinkedList<T>> copy;
+		Measure("copy constructor (one block)", n, [&]()
+		{
+			copy = std::make_unique<LinkedList<T>>(*packed);
+		});
+
+		// ノードはブロックにまとまったまま、リスト上の順序だけをメモリ上の配置と無関係にする
+		packed->Sort([](const T& a, const T& b)
+		{
+			auto mix = [](const T& value) { return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(&value)) * 0x9E3779B97F4A7C15ull; };
+			return mix(a) < mix(b);
+		});
+		std::unique_ptr<LinkedList<T>> shuffled;
+		Measure("copy constructor (one block, shuffled)", n, [&]()
+		{
+			shuffled = std::make_unique<LinkedList<T>>(*packed);
+		});
+
+		Measure("Relayout (scattered)", n, [&]()
+		{
+			list.Relayout();
+		});
+
+		// 1つずつ挿入したノードを持つリストは、ノードをたどって解放する
+		LinkedList<T> scattered;
+		BuildScattered(scattered, n, make, rng);
+		Measure("Clean (scattered)", n, [&]()
+		{
+			scattered.Clean();
+		});
+
+		Measure("Clean (one block)", n, [&]()
+		{
+			copy->Clean();
+		});
+
+		Measure("Clean (one block, shuffled)", n, [&]()
+		{
+			packed->Clean();
+		});
+		gSink = static_cast<long long>(shuffled->Count() + list.Count());
+	}
+
+	/// <summary>
+	/// ソート済みの複数のリストを1つにまとめる計測
+	/// </summary>
+	void BenchMerge(size_t n, size_t k)
+	{
+		std::printf("== merge: %zu sorted LinkedList<PlayerScore>, %zu nodes in total ==\n", k, n);
+
+		auto descending = [](const PlayerScore& a, const PlayerScore& b) { return a.score > b.score; };
+		auto build = [&]()
+		{
+			std::mt19937 rng(999);
+			std::vector<LinkedList<PlayerScore>> lists(k);
+			for (size_t i = 0; i < n; i++)
+			{
+				lists[i % k].Insert(lists[i % k].End(), PlayerScore(static_cast<int>(rng() % 1000000), "player" + std::to_string(i % 1000)));
+			}
+			for (auto& list : lists)
+			{
+				list.Sort(descending);
+			}
+			return lists;
+		};
+
+		{
+			auto lists = build();
+			Measure("concatenate + Sort", n, [&]()
+			{
+				LinkedList<PlayerScore> all;
+				for (auto& list : lists)
+				{
+					list.ForEach([&all](const PlayerScore& playerScore) { all.Insert(all.End(), playerScore); });
+					list.Clean();
+				}
+				all.Sort(descending);
+				gSink = static_cast<long long>(all.Count());
+			});
+		}
+
+		{
+			auto lists = build();
+			Measure("MergeK", n, [&]()
+			{
+				auto merged = LinkedList<PlayerScore>::MergeK(lists, descending);
+				gSink = static_cast<long long>(merged.Count());
+			});
+		}
+	}
+	/// <summary>
+	/// IDで要素を検索する計測（std::stringのIDと固定長のIDを比較）
+	/// </summary>
+	void BenchIdSearch(size_t n)
+	{
+		std::printf("== id search: %zu nodes, 100 lookups ==\n", n);
+
+		auto makeId = [](size_t i) { return "player" + std::to_string(i % 100000); };
+		LinkedList<PlayerScore> list;
+		LinkedList<CompactPlayerScore> compact;
+		list.InsertBulk(list.End(), n, [&](size_t i) { return PlayerScore(static_cast<int>(i), makeId(i)); });
+		compact.InsertBulk(compact.End(), n, [&](size_t i) { return CompactPlayerScore(static_cast<int>(i), makeId(i)); });
+
+		const size_t lookups = 100;
+		Measure("find id (std::string)", n * lookups, [&]()
+		{
+			long long hits = 0;
+			for (size_t k = 0; k < lookups; k++)
+			{
+				const std::string key = makeId(k * 997 + 100000 - 1);
+				list.ForEach([&](const PlayerScore& playerScore) { hits += playerScore.id == key; });
+			}
+			gSink = hits;
+		});
+		Measure("find id (PlayerId)", n * lookups, [&]()
+		{
+			long long hits = 0;
+			for (size_t k = 0; k < lookups; k++)
+			{
+				const PlayerId key(makeId(k * 997 + 100000 - 1));
+				compact.ForEach([&](const CompactPlayerScore& playerScore) { hits += playerScore.id == key; });
+			}
+			gSink = hits;
+		});
+		Measure("Sort by id (std::string)", n, [&]()
+		{
+			list.Sort([](const PlayerScore& a, const PlayerScore& b) { return a.id < b.id; });
+		});
+		Measure("Sort by id (PlayerId)", n, [&]()
+		{
+			compact.Sort([](const CompactPlayerScore& a, const CompactPlayerScore& b) { return a.id < b.id; });
+		});
+	}
+
+	/// <summary>
+	/// 複数のスレッドがそれぞれのリストへ1つずつ挿入してから解放する計測（ノードキャッシュの有無を比較）
+	/// </summary>
+	void BenchProducers(size_t n, size_t threadCount)
+	{
+		std::printf("== producers: %zu threads, LinkedList<PlayerScore>, %zu nodes in total ==\n", threadCount, n);
+
+		for (bool nodeCache : { false, true })
+		{
+			Measure(nodeCache ? "Insert + Clean (node cache)" : "Insert + Clean (new/delete)", n, [&]()
+			{
+				std::vector<std::thread> threads;
+				for (size_t t = 0; t < threadCount; t++)
+				{
+					threads.emplace_back([n, threadCount, nodeCache]()
+					{
+						// 2回繰り返して、解放したノードを再利用する場合も含める
+						for (int round = 0; round < 2; round++)
+						{
+							LinkedList<PlayerScore> list;
+							list.SetNodeCache(nodeCache);
+							for (size_t i = 0; i < n / threadCount / 2; i++)
+							{
+								list.Insert(list.End(), PlayerScore(static_cast<int>(i), "player"));
+							}
+						}
+					});
+				}
+				for (auto& thread : threads)
+				{
+					thread.join();
+				}
+			});
+		}
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	// 要素数は引数で変更できる（既定は1000万）
+	const size_t n = (argc > 1) ? static_cast<size_t>(std::strtoull(argv[1], nullptr, 10)) : 10000000;
+
+	BenchTraversal(n);
+	BenchPlayerScore(n);
+	BenchCopy<int>("int", n, [](size_t i) { return static_cast<int>(i); });
+	BenchCopy<CompactPlayerScore>("CompactPlayerScore", n, [](size_t i) { return CompactPlayerScore(static_cast<int>(i % 50000), "player" + std::to_string(i % 1000)); });
+	BenchCopy<PlayerScore>("PlayerScore", n, [](size_t i) { return PlayerScore(static_cast<int>(i % 50000), "player" + std::to_string(i % 1000)); });
+	BenchMerge(n, 16);
+	BenchIdSearch(n / 10);
+	BenchProducers(n, std::max(2u, std::thread::hardware_concurrency()));
+
+	return 0;
+}
@@ -0,0 +1,130 @@
+﻿// このプロジェクトは例外を無効にしてビルドする（プロジェクトの設定で /EHs-c- と _HAS_EXCEPTIONS=0 を指定）
+// 例外を有効にしたテストとは別の実行ファイルにして、同じインライン関数が異なる内容でリンク時に混ざらないようにする
+// 確かめた内容のいずれかが期待と異なれば、内容を出力して1を返す
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "errorPolicy.h"
+#include "inplaceLinkedList.h"
+#include "linkedList.h"
+#include "playerScore.h"
+#include "scoreIndex.h"
+#include "scoreIngest.h"
+#include "scoreLoader.h"
+#include "versionedList.h"
+
+static_assert(!LINKEDLIST_EXCEPTIONS, "noExceptions.cpp must be built with exceptions disabled");
+
+namespace
+{
+	int gFailures = 0;
+
+	/// <summary>
+	/// 値が期待と一致するかを確かめ、異なれば出力する
+	/// </summary>
+	template <typename T>
+	void Expect(const char* name, const T& expected, const T& actual)
+	{
+		if (!(expected == actual))
+		{
+			std::printf("FAILED: %s\n", name);
+			gFailures++;
+		}
+	}
+
+	/// <summary>
+	/// 解析できない行を2行含むスコアファイルを作成
+	/// </summary>
+	void WriteInput(const char* path)
+	{
+		std::ofstream file(path, std::ios::binary);
+		for (int i = 1; i <= 20; i++)
+		{
+			if (i == 7 || i == 15)
+			{
+				file << "broken row " << i << "\n";
+				continue;
+			}
+			file << i * 10 << "\tplayer" << i << "\n";
+		}
+	}
+}
+
+/// <summary>
+/// 例外を無効にしてビルドしたコードでも、パイプラインが解析できない行を行番号つきで通知し、リストや索引を操作できることを確かめる
+/// </summary>
+int main()
+{
+	const char* path = "no_exceptions_test.txt";
+	WriteInput(path);
+
+	// チャンクを小さくして、解析できない行の行番号がチャンクをまたいでも正しいことを確かめる
+	IngestOptions options;
+	options.chunkSize = 16;
+	options.parserCount = 2;
+
+	LinkedList<PlayerScore> list;
+	{
+		std::vector<size_t> errorLines;
+		ScoreIngestPipeline ingest(options);
+		auto ingested = ingest.TryRun(path, list, [&errorLines](const ScoreError& error)
+		{
+			errorLines.push_back(error.line);
+			return ScoreErrorAction::Skip;
+		});
+		Expect<size_t>("ingested rows", 18, ingested ? *ingested : 0);
+		Expect("error lines", std::vector<size_t>{ 7, 15 }, errorLines);
+	}
+	{
+		ScoreIngestPipeline ingest(options);
+		LinkedList<PlayerScore> stopped;
+		auto ingested = ingest.TryRun(path, stopped, [](const ScoreError&) { return ScoreErrorAction::Stop; });
+		Expect<size_t>("stopped line", 7, ingested ? 0 : ingested.Error().line);
+		Expect<size_t>("rows before stop", 6, stopped.Count());
+	}
+	{
+		LinkedList<PlayerScore> loaded;
+		auto count = TryLoadScores(path, loaded, [](const ScoreError&) { return ScoreErrorAction::Skip; });
+		Expect<size_t>("loaded rows", 18, count ? *count : 0);
+	}
+
+	// スコアが100以下の行は 10..100 のうち壊れた行（70）を除いた9行
+	IndexedScoreList indexed;
+	for (auto it = list.CBegin(); it != list.CEnd(); ++it)
+	{
+		indexed.Insert(indexed.End(), *it);
+	}
+	Expect<size_t>("indexed hits", 9, indexed.RangeByScore(0, 100).size());
+
+	long long intSum = 0;
+	LinkedList<int> ints;
+	ints.SetNodeCache(true);
+	ints.InsertBulk(ints.End(), 10, [](size_t i) { return static_cast<int>(i); });
+	ints.RemoveIf([](int value) { return value % 2 != 0; });
+	LinkedList<int> copy(ints);
+	copy.Relayout();
+	copy.ForEach([&intSum](int value) { intSum += value; });
+
+	InplaceLinkedList<int, 4> inplace;
+	inplace.Insert(inplace.End(), 100);
+	intSum += *inplace.Begin();
+	Expect<long long>("int sum", 0 + 2 + 4 + 6 + 8 + 100, intSum);
+
+	VersionedList<int, 2> versioned;
+	for (int i = 0; i < 10; i++)
+	{
+		versioned.PushBack(i);
+	}
+	versioned.Remove(0);
+	Expect<int>("versioned front", 1, *versioned.GetSnapshot().CBegin());
+
+	std::remove(path);
+	if (gFailures == 0)
+	{
+		std::printf("all checks passed without exceptions\n");
+	}
+	return gFailures == 0 ? 0 : 1;
+}
@@ -1,5 +1,31 @@
-#include "pch.h"
+﻿#include "pch.h"
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <share.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "../Project1_2/compactPlayerScore.h"
+#include "../Project1_2/errorPolicy.h"
+#include "../Project1_2/externalSort.h"
+#include "../Project1_2/inplaceLinkedList.h"
+#include "../Project1_2/intrusiveList.h"
+#include "../Project1_2/latencyTrace.h"
 #include "../Project1_2/linkedList.h"
+#include "../Project1_2/nodeCache.h"
+#include "../Project1_2/scoreIndex.h"
+#include "../Project1_2/scoreIngest.h"
+#include "../Project1_2/scoreLoader.h"
+#include "../Project1_2/scoreFollower.h"
+#include "../Project1_2/scoreReader.h"
+#include "../Project1_2/scoreSnapshot.h"
+#include "../Project1_2/scoreWriter.h"
+#include "../Project1_2/versionedList.h"
 
 #pragma region データ数の取得テスト
 
@@ -1320,3 +1346,2645 @@ TEST(LinkedListTest, CompareNotEqualDifferentIteratorTest)
 }
 
 #pragma endregion
+
+#pragma region スコアの出力
+
+/// <summary>
+/// ID_0 テキスト形式・CSV形式・TSV形式で整形した際の出力
+/// </summary>
+TEST(ScoreWriterTest, AppendRowTextAndCsvTest)
+{
+	std::string out;
+
+	ScoreWriter::AppendRow(out, PlayerScore(34044, "yst"), ScoreFormat::Text);
+	EXPECT_EQ("Score: 34044	ID: yst\n", out);
+
+	out.clear();
+	ScoreWriter::AppendRow(out, PlayerScore(-5, "a,\"b"), ScoreFormat::Csv);
+	EXPECT_EQ("-5,\"a,\"\"b\"\n", out);
+
+	out.clear();
+	ScoreWriter::AppendRow(out, PlayerScore(-5, "yst"), ScoreFormat::Tsv);
+	EXPECT_EQ("-5	yst\n", out);
+}
+
+/// <summary>
+/// ID_1 バイナリ形式で整形した際の出力
+/// </summary>
+TEST(ScoreWriterTest, AppendRowBinaryTest)
+{
+	std::string out;
+
+	ScoreWriter::AppendRow(out, PlayerScore(0x01020304, "ab"), ScoreFormat::Binary);
+	EXPECT_EQ(std::string("\x04\x03\x02\x01\x02\x00\x00\x00" "ab", 10), out);
+}
+
+namespace
+{
+	/// <summary>
+	/// 書き込み用にファイルを作り直して開き、ファイルディスクリプタを返す
+	/// </summary>
+	int OpenForWrite(const char* path)
+	{
+#ifdef _WIN32
+		int fd = -1;
+		_sopen_s(&fd, path, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _SH_DENYNO, _S_IREAD | _S_IWRITE);
+		return fd;
+#else
+		return open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+	}
+
+	void CloseFd(int fd)
+	{
+#ifdef _WIN32
+		_close(fd);
+#else
+		close(fd);
+#endif
+	}
+}
+
+/// <summary>
+/// ID_2 複数スレッドで整形した出力が、呼び出しをまたいでも1スレッドの場合と同じ順序になることをチェック
+/// </summary>
+TEST(ScoreWriterTest, ParallelWriteAllTest)
+{
+	LinkedList<PlayerScore> list;
+	std::string expected;
+	for (int i = 0; i < 150000; i++)
+	{
+		list.Insert(list.End(), PlayerScore(i, "player" + std::to_string(i % 97)));
+		ScoreWriter::AppendRow(expected, PlayerScore(i, "player" + std::to_string(i % 97)), ScoreFormat::Tsv);
+	}
+
+	const int fd = OpenForWrite("writer_test.txt");
+	ASSERT_GE(fd, 0);
+	{
+		// 2回目の呼び出しでは1回目に起動したスレッドを使い回す
+		ScoreWriter writer(fd, ScoreFormat::Tsv);
+		writer.WriteAll(list, 3);
+		writer.WriteAll(list, 2);
+		EXPECT_TRUE(writer.Flush());
+	}
+	CloseFd(fd);
+
+	std::ifstream file("writer_test.txt", std::ios::binary);
+	const std::string actual((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	EXPECT_TRUE(actual == expected + expected);
+
+	file.close();
+	std::remove("writer_test.txt");
+}
+
+/// <summary>
+/// ID_3 無効なファイルディスクリプタを渡した場合は最初から失敗状態になることをチェック
+/// </summary>
+TEST(ScoreWriterTest, InvalidFdTest)
+{
+	ScoreWriter writer(-1);
+	EXPECT_FALSE(writer.Good());
+	writer.Write(PlayerScore(1, "a"));
+	EXPECT_FALSE(writer.Flush());
+}
+
+#pragma endregion
+
+#pragma region スコアの読み込み
+
+/// <summary>
+/// ID_0 1行を解析した際の戻り値
+/// </summary>
+TEST(ScoreLoaderTest, ParseScoreLineTest)
+{
+	int score = 0;
+	std::string_view id;
+
+	EXPECT_TRUE(ParseScoreLine("34044	yst\r", score, id));
+	EXPECT_EQ(34044, score);
+	EXPECT_EQ("yst", id);
+
+	// タブが無い、スコアが数値でない行は失敗する
+	EXPECT_FALSE(ParseScoreLine("34044 yst", score, id));
+	EXPECT_FALSE(ParseScoreLine("abc	yst", score, id));
+}
+
+/// <summary>
+/// ID_1 改行で終わっていない行が解析されずに残ることをチェック
+/// </summary>
+TEST(ScoreLoaderTest, ParseScoreLinesKeepsPartialLineTest)
+{
+	LinkedList<PlayerScore> list;
+	const std::string data = "1	a\nbad\n2	b\n3	c";
+
+	// 途中の行は消費しない
+	size_t consumed = ParseScoreLines(data.data(), data.size(), list, false);
+	EXPECT_EQ(data.size() - 3, consumed);
+	EXPECT_EQ(2, list.Count());
+
+	// 最後のチャンクであれば途中の行も解析する
+	consumed += ParseScoreLines(data.data() + consumed, data.size() - consumed, list, true);
+	EXPECT_EQ(data.size(), consumed);
+	EXPECT_EQ(3, list.Count());
+
+	auto it = list.Begin();
+	EXPECT_EQ("a", it->id);
+	++it;
+	++it;
+	EXPECT_EQ(3, it->score);
+	EXPECT_EQ("c", it->id);
+}
+
+/// <summary>
+/// ID_2 重複したIDをポリシーに従ってまとめながら読み込んだ際の値
+/// </summary>
+TEST(ScoreLoaderTest, LoadMergedTest)
+{
+	{
+		std::ofstream file("merge_test.txt", std::ios::binary);
+		file << "10\ta\n5\tb\n30\ta\n7\tc\n20\ta\nbad\n1\tb";
+	}
+
+	struct Expected
+	{
+		DuplicatePolicy policy;
+		int a;
+		int b;
+	};
+	const Expected cases[] = {
+		{ DuplicatePolicy::Max, 30, 5 },
+		{ DuplicatePolicy::Min, 10, 1 },
+		{ DuplicatePolicy::Latest, 20, 1 },
+		{ DuplicatePolicy::Sum, 60, 6 },
+	};
+
+	for (const Expected& expected : cases)
+	{
+		LinkedList<PlayerScore> list;
+		ASSERT_TRUE(LoadScores("merge_test.txt", list, expected.policy));
+
+		// 各IDは最初に現れた順に1つずつ並ぶ
+		ASSERT_EQ(3, list.Count());
+		auto it = list.CBegin();
+		EXPECT_EQ("a", it->id);
+		EXPECT_EQ(expected.a, it->score);
+		++it;
+		EXPECT_EQ("b", it->id);
+		EXPECT_EQ(expected.b, it->score);
+		++it;
+		EXPECT_EQ("c", it->id);
+		EXPECT_EQ(7, it->score);
+	}
+
+	std::remove("merge_test.txt");
+}
+
+/// <summary>
+/// ID_3 既存の要素とまとめる場合と、合計が範囲を超える場合
+/// </summary>
+TEST(ScoreLoaderTest, ScoreMergerTest)
+{
+	LinkedList<PlayerScore> list;
+	list.Insert(list.End(), PlayerScore(2000000000, "a"));
+
+	ScoreMerger merger(list, DuplicatePolicy::Sum);
+	merger.Add(2000000000, "a");
+	merger.Add(-3, "b");
+	merger.Add(-2147483647, "b");
+	merger.Add(-100, "b");
+
+	EXPECT_EQ(2, merger.Count());
+	ASSERT_EQ(2, list.Count());
+	EXPECT_EQ(std::numeric_limits<int>::max(), list.Begin()->score);
+	EXPECT_EQ(std::numeric_limits<int>::min(), (++list.Begin())->score);
+}
+
+#pragma endregion
+
+#pragma region 要素のまとめての挿入
+
+/// <summary>
+/// ID_0 空のリストにまとめて挿入した際の挙動
+/// </summary>
+TEST(LinkedListBulkTest, InsertBulkToEmptyListTest)
+{
+	LinkedList<int> list;
+
+	auto it = list.InsertBulk(list.End(), 3, [](size_t i) { return static_cast<int>(i) * 10; });
+
+	EXPECT_EQ(3, list.Count());
+	EXPECT_TRUE(it == list.Begin());
+	EXPECT_EQ(0, *it++);
+	EXPECT_EQ(10, *it++);
+	EXPECT_EQ(20, *it++);
+	EXPECT_TRUE(it == list.End());
+}
+
+/// <summary>
+/// ID_1 中間にまとめて挿入し、挿入したノードを個別に削除した際の挙動
+/// </summary>
+TEST(LinkedListBulkTest, InsertBulkAtMiddleAndRemoveTest)
+{
+	LinkedList<int> list;
+	list.Insert(list.End(), 1);
+	auto last = list.Insert(list.End(), 9);
+
+	list.InsertBulk(last, 2, [](size_t i) { return static_cast<int>(i) + 2; });
+
+	// 1 2 3 9
+	auto it = list.Begin();
+	++it;
+	it = list.Remove(it);
+	EXPECT_EQ(3, *it);
+	it = list.Remove(it);
+	EXPECT_EQ(9, *it);
+	EXPECT_EQ(2, list.Count());
+
+	// 逆方向にも正しく繋がっている
+	--it;
+	EXPECT_EQ(1, *it);
+}
+
+/// <summary>
+/// ID_2 範囲を指定してまとめて挿入した際の挙動
+/// </summary>
+TEST(LinkedListBulkTest, InsertRangeTest)
+{
+	LinkedList<int> list;
+	list.Insert(list.End(), 0);
+	list.Insert(list.End(), 4);
+
+	const std::vector<int> values = { 1, 2, 3 };
+	auto it = list.InsertRange(++list.Begin(), values.begin(), values.end());
+
+	EXPECT_EQ(5, list.Count());
+	EXPECT_EQ(1, *it);
+
+	int expected = 0;
+	for (auto c = list.CBegin(); c != list.CEnd(); ++c)
+	{
+		EXPECT_EQ(expected++, *c);
+	}
+
+	// 別のリストのコンストイテレータも範囲として渡せる
+	LinkedList<int> copy;
+	copy.InsertRange(copy.End(), list.CBegin(), list.CEnd());
+	EXPECT_EQ(5, copy.Count());
+}
+
+/// <summary>
+/// ID_3 Assignで内容を置き換えた際の挙動
+/// </summary>
+TEST(LinkedListBulkTest, AssignTest)
+{
+	LinkedList<int> list;
+	list.Insert(list.End(), 99);
+
+	const int values[] = { 7, 8 };
+	list.Assign(std::begin(values), std::end(values));
+
+	EXPECT_EQ(2, list.Count());
+	EXPECT_EQ(7, *list.Begin());
+	EXPECT_EQ(8, *++list.Begin());
+
+	// 空の範囲で置き換えると空になる
+	list.Assign(values, values);
+	EXPECT_EQ(0, list.Count());
+	EXPECT_TRUE(list.Begin() == list.End());
+}
+
+#pragma endregion
+
+#pragma region リストのコピーとムーブ
+
+/// <summary>
+/// ID_0 コピーコンストラクト後にコピー元と独立した同じ内容を持つことをチェック
+/// </summary>
+TEST(LinkedListCopyMoveTest, CopyConstructorTest)
+{
+	LinkedList<int> list;
+	list.Insert(list.End(), 10);
+	list.Insert(list.End(), 20);
+
+	LinkedList<int> copy(list);
+	EXPECT_EQ(2, copy.Count());
+	EXPECT_EQ(10, *copy.Begin());
+	EXPECT_EQ(20, *++copy.Begin());
+
+	// コピー元を変更してもコピー先は変わらない
+	*list.Begin() = 99;
+	list.Remove(++list.Begin());
+	EXPECT_EQ(10, *copy.Begin());
+	EXPECT_EQ(2, copy.Count());
+}
+
+/// <summary>
+/// ID_1 コピー代入後の内容をチェック
+/// </summary>
+TEST(LinkedListCopyMoveTest, CopyAssignmentTest)
+{
+	LinkedList<std::string> list;
+	list.Insert(list.End(), "a");
+
+	LinkedList<std::string> other;
+	other.Insert(other.End(), "x");
+	other.Insert(other.End(), "y");
+
+	other = list;
+	EXPECT_EQ(1, other.Count());
+	EXPECT_EQ("a", *other.Begin());
+
+	// 自己代入しても内容は変わらない
+	auto& self = other;
+	other = self;
+	EXPECT_EQ(1, other.Count());
+}
+
+/// <summary>
+/// ID_2 ムーブコンストラクト後にノードが引き継がれ、ムーブ元が空になることをチェック
+/// </summary>
+TEST(LinkedListCopyMoveTest, MoveConstructorTest)
+{
+	LinkedList<int> list;
+	auto it = list.Insert(list.End(), 10);
+	list.Insert(list.End(), 20);
+
+	LinkedList<int> moved(std::move(list));
+	EXPECT_EQ(2, moved.Count());
+	EXPECT_EQ(0, list.Count());
+	EXPECT_TRUE(list.Begin() == list.End());
+
+	// ノード自体は移動しないので、ムーブ前のイテレータがそのまま使える
+	EXPECT_TRUE(it == moved.Begin());
+}
+
+/// <summary>
+/// ID_3 ムーブ代入後に元の要素が解放され、ムーブ元が空になることをチェック
+/// </summary>
+TEST(LinkedListCopyMoveTest, MoveAssignmentTest)
+{
+	LinkedList<int> list;
+	list.Insert(list.End(), 10);
+
+	LinkedList<int> other;
+	other.Insert(other.End(), 1);
+	other.Insert(other.End(), 2);
+
+	other = std::move(list);
+	EXPECT_EQ(1, other.Count());
+	EXPECT_EQ(10, *other.Begin());
+	EXPECT_EQ(0, list.Count());
+
+	// ムーブ元は空のリストとしてそのまま使える
+	list.Insert(list.End(), 5);
+	EXPECT_EQ(1, list.Count());
+}
+
+/// <summary>
+/// ID_4 代入ではコンストラクタと同じく遅延削除の設定も引き継ぎ、遅延削除でないリストにトゥームストーンが残らないことをチェック
+/// </summary>
+TEST(LinkedListCopyMoveTest, AssignmentSettingsTest)
+{
+	LinkedList<int> lazy;
+	lazy.SetLazyRemove(true, 0.0);
+	for (int i = 0; i < 4; i++)
+	{
+		lazy.Insert(lazy.End(), i);
+	}
+	lazy.Remove(lazy.Begin());
+
+	// コピー代入：トゥームストーンはコピーされず、以降の削除は遅延削除になる
+	LinkedList<int> copied;
+	copied.Insert(copied.End(), 100);
+	copied = lazy;
+	EXPECT_EQ(3, copied.Count());
+	EXPECT_EQ(0, copied.TombstoneCount());
+	copied.Remove(copied.Begin());
+	EXPECT_EQ(1, copied.TombstoneCount());
+
+	// 遅延削除でないリストからのコピー代入では、遅延削除が無効になる
+	LinkedList<int> eager;
+	eager.Insert(eager.End(), 7);
+	copied = eager;
+	copied.Remove(copied.Begin());
+	EXPECT_EQ(0, copied.TombstoneCount());
+
+	// ムーブ代入：トゥームストーンと一緒に遅延削除の設定も引き継ぐ
+	LinkedList<int> moved;
+	moved = std::move(lazy);
+	EXPECT_EQ(3, moved.Count());
+	EXPECT_EQ(1, moved.TombstoneCount());
+	moved.Remove(moved.Begin());
+	EXPECT_EQ(2, moved.TombstoneCount());
+	EXPECT_EQ(2, moved.Compact());
+
+	// 入れ替えでは設定は入れ替えず、遅延削除でないリストが受け取ったトゥームストーンはその場で解放する
+	moved.Remove(moved.Begin());
+	LinkedList<int> swapped;
+	swapped.Swap(moved);
+	EXPECT_EQ(1, swapped.Count());
+	EXPECT_EQ(0, swapped.TombstoneCount());
+	EXPECT_EQ(3, *swapped.Begin());
+}
+
+#pragma endregion
+
+#pragma region 遅延削除
+
+namespace
+{
+	/// <summary>
+	/// 前方向と後ろ方向のどちらにたどっても期待した並びになっているか
+	/// </summary>
+	void ExpectSequence(LinkedList<int>& list, const std::vector<int>& expected)
+	{
+		std::vector<int> forward;
+		LinkedList<int>::Iterator last;
+		for (auto it = list.Begin(); it != list.End(); ++it)
+		{
+			forward.push_back(*it);
+			last = it;
+		}
+		EXPECT_EQ(expected, forward);
+
+		std::vector<int> backward;
+		if (!expected.empty())
+		{
+			for (auto it = last; ; --it)
+			{
+				backward.insert(backward.begin(), *it);
+				if (it == list.Begin())
+				{
+					break;
+				}
+			}
+		}
+		EXPECT_EQ(expected, backward);
+	}
+}
+
+/// <summary>
+/// ID_0 遅延削除したノードがイテレータから見えないことをチェック
+/// </summary>
+TEST(LinkedListLazyRemoveTest, IteratorSkipsTombstoneTest)
+{
+	LinkedList<int> list;
+	list.SetLazyRemove(true, 0.0);
+	auto first = list.Insert(list.End(), 10);
+	auto middle = list.Insert(list.End(), 20);
+	auto last = list.Insert(list.End(), 30);
+
+	// 戻り値は削除した要素の次
+	auto it = list.Remove(middle);
+	EXPECT_EQ(30, *it);
+	EXPECT_EQ(2, list.Count());
+	EXPECT_EQ(1, list.TombstoneCount());
+
+	// 前後どちらの方向にも削除済みの要素を飛ばす
+	++first;
+	EXPECT_TRUE(first == last);
+	--first;
+	EXPECT_EQ(10, *first);
+
+	// 先頭を削除するとBeginも次の要素を指す
+	list.Remove(list.Begin());
+	EXPECT_EQ(30, *list.Begin());
+	EXPECT_EQ(30, *list.CBegin());
+}
+
+/// <summary>
+/// ID_1 Compactでトゥームストーンが解放され、残りの要素が保たれることをチェック
+/// </summary>
+TEST(LinkedListLazyRemoveTest, CompactTest)
+{
+	LinkedList<int> list;
+	list.SetLazyRemove(true, 0.0);
+	for (int i = 0; i < 10; i++)
+	{
+		list.Insert(list.End(), i);
+	}
+
+	// 偶数を削除
+	for (auto it = list.Begin(); it != list.End();)
+	{
+		it = (*it % 2 == 0) ? list.Remove(it) : ++it;
+	}
+	EXPECT_EQ(5, list.TombstoneCount());
+
+	EXPECT_EQ(5, list.Compact());
+	EXPECT_EQ(0, list.TombstoneCount());
+	EXPECT_EQ(5, list.Count());
+
+	int expected = 1;
+	for (auto it = list.CBegin(); it != list.CEnd(); ++it, expected += 2)
+	{
+		EXPECT_EQ(expected, *it);
+	}
+
+	// コピーにはトゥームストーンが含まれない
+	list.Remove(list.Begin());
+	LinkedList<int> copy(list);
+	EXPECT_EQ(4, copy.Count());
+	EXPECT_EQ(0, copy.TombstoneCount());
+}
+
+/// <summary>
+/// ID_2 トゥームストーンの割合が閾値を超えた際に自動でコンパクションされることをチェック
+/// </summary>
+TEST(LinkedListLazyRemoveTest, AutoCompactTest)
+{
+	LinkedList<int> list;
+	list.SetLazyRemove(true, 0.5);
+	for (int i = 0; i < 200; i++)
+	{
+		list.Insert(list.End(), i);
+	}
+
+	auto it = list.Begin();
+	for (int i = 0; i < 99; i++)
+	{
+		it = list.Remove(it);
+	}
+	EXPECT_EQ(99, list.TombstoneCount());
+
+	// 100個目で半分に達する
+	it = list.Remove(it);
+	EXPECT_EQ(0, list.TombstoneCount());
+	EXPECT_EQ(100, list.Count());
+	EXPECT_EQ(100, *it);
+	EXPECT_TRUE(it == list.Begin());
+}
+
+/// <summary>
+/// ID_3 遅延削除のリストから遅延削除でないリストへ繋ぎ替えると、移ってきたトゥームストーンがその場で解放されることをチェック
+/// </summary>
+TEST(LinkedListLazyRemoveTest, SpliceIntoEagerListTest)
+{
+	LinkedList<int> lazy;
+	lazy.SetLazyRemove(true, 0.0);
+	for (int i = 0; i < 8; i++)
+	{
+		lazy.Insert(lazy.End(), i);
+	}
+	lazy.Remove(lazy.Begin());
+	lazy.Remove(++lazy.Begin());
+	EXPECT_EQ(2, lazy.TombstoneCount());
+
+	// 範囲：[1, 4) には削除済みの2が含まれる
+	LinkedList<int> eager;
+	eager.Insert(eager.End(), 100);
+	auto last = lazy.Begin();
+	for (int i = 0; i < 2; i++)
+	{
+		++last;
+	}
+	eager.Splice(eager.End(), lazy, lazy.Begin(), last);
+	EXPECT_EQ(0, eager.TombstoneCount());
+	EXPECT_EQ(1, lazy.TombstoneCount());
+	ExpectSequence(eager, { 100, 1, 3 });
+
+	// 全体：先頭の削除済みの0が一緒に移る
+	eager.Splice(eager.Begin(), lazy);
+	EXPECT_EQ(0, eager.TombstoneCount());
+	EXPECT_EQ(0, lazy.TombstoneCount());
+	EXPECT_FALSE(lazy.Any());
+	ExpectSequence(eager, { 4, 5, 6, 7, 100, 1, 3 });
+
+	// 遅延削除のリストへ移した場合はトゥームストーンのまま残る
+	LinkedList<int> source;
+	source.SetLazyRemove(true, 0.0);
+	source.Insert(source.End(), 1);
+	source.Insert(source.End(), 2);
+	source.Remove(source.Begin());
+	LinkedList<int> target;
+	target.SetLazyRemove(true, 0.0);
+	target.Splice(target.End(), source);
+	EXPECT_EQ(1, target.TombstoneCount());
+	ExpectSequence(target, { 2 });
+}
+
+#pragma endregion
+
+#pragma region 全要素の走査とソート
+
+/// <summary>
+/// ID_0 ForEachが先読み距離に関係なく全要素を順に渡すことをチェック
+/// </summary>
+TEST(LinkedListTraversalTest, ForEachTest)
+{
+	LinkedList<int> list;
+	for (int i = 0; i < 100; i++)
+	{
+		list.Insert(list.End(), i);
+	}
+
+	for (size_t distance : { 0, 1, 8, 1000 })
+	{
+		int expected = 0;
+		list.ForEach([&expected](int& value)
+		{
+			EXPECT_EQ(expected++, value);
+		}, distance);
+		EXPECT_EQ(100, expected);
+	}
+
+	// 削除済みの要素は渡されない
+	list.SetLazyRemove(true, 0.0);
+	list.Remove(list.Begin());
+	const LinkedList<int>& constList = list;
+	int count = 0;
+	constList.ForEach([&count](const int&) { count++; });
+	EXPECT_EQ(99, count);
+}
+
+/// <summary>
+/// ID_1 Sortが安定ソートであり、既存のイテレータが有効なままであることをチェック
+/// </summary>
+TEST(LinkedListTraversalTest, SortTest)
+{
+	LinkedList<PlayerScore> list;
+	list.Insert(list.End(), PlayerScore(30, "a"));
+	auto b = list.Insert(list.End(), PlayerScore(10, "b"));
+	list.Insert(list.End(), PlayerScore(30, "c"));
+	list.Insert(list.End(), PlayerScore(20, "d"));
+
+	list.Sort([](const PlayerScore& x, const PlayerScore& y) { return x.score < y.score; });
+
+	const char* expected[] = { "b", "d", "a", "c" };
+	size_t index = 0;
+	for (auto it = list.CBegin(); it != list.CEnd(); ++it)
+	{
+		EXPECT_EQ(expected[index++], it->id);
+	}
+	EXPECT_TRUE(b == list.Begin());
+
+	// 末尾からも辿れる
+	auto last = list.Begin();
+	++last;
+	++last;
+	++last;
+	EXPECT_EQ("a", (--last)->id);
+}
+
+/// <summary>
+/// ID_2 負のキーを含む要素を基数ソートした際の並びと安定性
+/// </summary>
+TEST(LinkedListTraversalTest, RadixSortByTest)
+{
+	LinkedList<PlayerScore> list;
+	const int scores[] = { 5, -3, 70000, 5, -2147483647 - 1, 0, 2147483647, -3, 5 };
+	for (size_t i = 0; i < sizeof(scores) / sizeof(scores[0]); i++)
+	{
+		list.Insert(list.End(), PlayerScore(scores[i], std::to_string(i)));
+	}
+	auto first = list.Begin();
+
+	list.RadixSortBy([](const PlayerScore& playerScore) { return playerScore.score; });
+	const char* ascending[] = { "4", "1", "7", "5", "0", "3", "8", "2", "6" };
+	size_t index = 0;
+	for (auto c = list.CBegin(); c != list.CEnd(); ++c)
+	{
+		EXPECT_EQ(ascending[index++], c->id);
+	}
+	EXPECT_EQ(9, index);
+
+	// 降順でも同じキーの要素は元の順番を保つ
+	list.RadixSortBy([](const PlayerScore& playerScore) { return playerScore.score; }, true);
+	const char* descending[] = { "6", "2", "0", "3", "8", "5", "1", "7", "4" };
+	index = 0;
+	for (auto c = list.CBegin(); c != list.CEnd(); ++c)
+	{
+		EXPECT_EQ(descending[index++], c->id);
+	}
+
+	// 既存のイテレータは同じ要素を指したまま
+	EXPECT_EQ("0", first->id);
+	EXPECT_EQ("3", (++first)->id);
+}
+
+/// <summary>
+/// ID_3 比較ソートと結果が一致することをチェック
+/// </summary>
+TEST(LinkedListTraversalTest, RadixSortMatchesSortTest)
+{
+	LinkedList<long long> radix;
+	LinkedList<long long> compare;
+	unsigned long long seed = 1;
+	for (int i = 0; i < 5000; i++)
+	{
+		seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+		const long long value = static_cast<long long>(seed) >> (i % 3 == 0 ? 0 : 40);
+		radix.Insert(radix.End(), value);
+		compare.Insert(compare.End(), value);
+	}
+	radix.Remove(radix.Begin());
+	compare.Remove(compare.Begin());
+
+	radix.RadixSortBy([](long long value) { return value; });
+	compare.Sort();
+
+	ASSERT_EQ(compare.Count(), radix.Count());
+	auto it = radix.CBegin();
+	for (auto c = compare.CBegin(); c != compare.CEnd(); ++c, ++it)
+	{
+		EXPECT_EQ(*c, *it);
+	}
+}
+
+/// <summary>
+/// ID_4 ソート済みの複数のリストをマージした際の並び順
+/// </summary>
+TEST(LinkedListTraversalTest, MergeKTest)
+{
+	std::vector<LinkedList<PlayerScore>> lists(4);
+	lists[0].Insert(lists[0].End(), PlayerScore(300, "a0"));
+	lists[0].Insert(lists[0].End(), PlayerScore(200, "a1"));
+	lists[0].Insert(lists[0].End(), PlayerScore(100, "a2"));
+	lists[1].Insert(lists[1].End(), PlayerScore(250, "b0"));
+	lists[1].Insert(lists[1].End(), PlayerScore(200, "b1"));
+	lists[3].Insert(lists[3].End(), PlayerScore(400, "d0"));
+	lists[3].Insert(lists[3].End(), PlayerScore(200, "d1"));
+	lists[3].Insert(lists[3].End(), PlayerScore(50, "d2"));
+	auto b0 = lists[1].Begin();
+
+	auto merged = LinkedList<PlayerScore>::MergeK(lists, [](const PlayerScore& a, const PlayerScore& b) { return a.score > b.score; });
+
+	// 同点は前のリストの要素を先に並べる
+	const char* expected[] = { "d0", "a0", "b0", "a1", "b1", "d1", "a2", "d2" };
+	ASSERT_EQ(8, merged.Count());
+	size_t index = 0;
+	for (auto it = merged.CBegin(); it != merged.CEnd(); ++it)
+	{
+		EXPECT_EQ(expected[index++], it->id);
+	}
+
+	// 元のリストは空になり、ノードは移っただけなので元のイテレータはマージ後の要素を指す
+	for (const auto& list : lists)
+	{
+		EXPECT_EQ(0, list.Count());
+		EXPECT_FALSE(list.Any());
+	}
+	EXPECT_EQ("a1", (++b0)->id);
+}
+
+/// <summary>
+/// ID_5 削除済みの要素や空のリストを含む場合のマージ
+/// </summary>
+TEST(LinkedListTraversalTest, MergeKTombstoneTest)
+{
+	std::vector<LinkedList<int>> lists(3);
+	lists[0].SetLazyRemove(true, 0.0);
+	for (int i = 0; i < 10; i++)
+	{
+		lists[0].Insert(lists[0].End(), i * 2);
+		lists[1].Insert(lists[1].End(), i * 2 + 1);
+	}
+	lists[0].Remove(lists[0].Begin());
+
+	auto merged = LinkedList<int>::MergeK(lists);
+	ASSERT_EQ(19, merged.Count());
+	int expected = 1;
+	for (auto it = merged.CBegin(); it != merged.CEnd(); ++it)
+	{
+		EXPECT_EQ(expected++, *it);
+	}
+
+	std::vector<LinkedList<int>> empty(2);
+	EXPECT_FALSE(LinkedList<int>::MergeK(empty).Any());
+}
+
+#pragma endregion
+
+#pragma region ノードの再配置
+
+/// <summary>
+/// ID_0 Relayout後に内容と順序が保たれ、トゥームストーンが解放されることをチェック
+/// </summary>
+TEST(LinkedListRelayoutTest, RelayoutTest)
+{
+	LinkedList<std::string> list;
+	list.SetLazyRemove(true, 0.0);
+	for (int i = 0; i < 10; i++)
+	{
+		list.Insert(list.Begin(), std::to_string(i));
+	}
+	list.Remove(list.Begin());
+
+	const size_t version = list.LayoutVersion();
+	list.Relayout();
+
+	EXPECT_NE(version, list.LayoutVersion());
+	EXPECT_EQ(9, list.Count());
+	EXPECT_EQ(0, list.TombstoneCount());
+
+	int expected = 8;
+	for (auto it = list.CBegin(); it != list.CEnd(); ++it)
+	{
+		EXPECT_EQ(std::to_string(expected--), *it);
+	}
+
+	// 再配置後も前後どちらにも辿れ、挿入・削除できる
+	auto last = list.Insert(list.End(), "x");
+	--last;
+	EXPECT_EQ("0", *last);
+	list.Remove(list.Begin());
+	EXPECT_EQ("7", *list.Begin());
+}
+
+/// <summary>
+/// ID_1 RelayoutStepで少しずつ再配置した際の挙動
+/// </summary>
+TEST(LinkedListRelayoutTest, RelayoutStepTest)
+{
+	LinkedList<int> list;
+	for (int i = 0; i < 10; i++)
+	{
+		list.Insert(list.End(), i);
+	}
+
+	EXPECT_FALSE(list.RelayoutStep(4));
+
+	// 途中で次に移すノードを削除しても続けられる
+	auto it = list.Begin();
+	for (int i = 0; i < 4; i++)
+	{
+		++it;
+	}
+	list.Remove(it);
+
+	EXPECT_FALSE(list.RelayoutStep(4));
+	EXPECT_TRUE(list.RelayoutStep(4));
+
+	const int expected[] = { 0, 1, 2, 3, 5, 6, 7, 8, 9 };
+	size_t index = 0;
+	for (auto c = list.CBegin(); c != list.CEnd(); ++c)
+	{
+		EXPECT_EQ(expected[index++], *c);
+	}
+	EXPECT_EQ(9, index);
+	EXPECT_EQ(9, *--list.Insert(list.End(), 10));
+}
+
+/// <summary>
+/// ID_2 trivially copyable な要素のコピー・再配置・まとめての挿入の挙動
+/// </summary>
+TEST(LinkedListRelayoutTest, TriviallyCopyableTest)
+{
+	LinkedList<CompactPlayerScore> list;
+	list.SetLazyRemove(true, 0.0);
+	for (int i = 0; i < 6; i++)
+	{
+		list.Insert(list.Begin(), CompactPlayerScore(i, "player_with_a_long_id_" + std::to_string(i)));
+	}
+	list.Remove(list.Begin());
+
+	LinkedList<CompactPlayerScore> copy(list);
+	list.Relayout();
+
+	for (const LinkedList<CompactPlayerScore>* target : { &list, &copy })
+	{
+		EXPECT_EQ(5, target->Count());
+		int expected = 4;
+		for (auto it = target->CBegin(); it != target->CEnd(); ++it)
+		{
+			EXPECT_EQ(expected, it->score);
+			EXPECT_EQ("player_with_a_long_id_" + std::to_string(expected), it->id.ToString());
+			expected--;
+		}
+		EXPECT_EQ(-1, expected);
+	}
+
+	// 値の生成が例外を送出した場合はリストが変わらない
+	LinkedList<int> ints;
+	ints.Insert(ints.End(), 1);
+	EXPECT_THROW(ints.InsertBulk(ints.End(), 4, [](size_t i) -> int
+	{
+		if (i == 2)
+		{
+			throw std::runtime_error("generate");
+		}
+		return static_cast<int>(i);
+	}), std::runtime_error);
+	EXPECT_EQ(1, ints.Count());
+	EXPECT_EQ(1, *ints.Begin());
+
+	copy.Clean();
+	EXPECT_EQ(0, copy.Count());
+	EXPECT_EQ(copy.End(), copy.Begin());
+}
+
+/// <summary>
+/// ID_3 ブロック単位のコピーと解放が、並べ替え・削除・移動の後も正しく行われることをチェック
+/// </summary>
+TEST(LinkedListRelayoutTest, BlockCopyAndReleaseTest)
+{
+	// 2つのブロックにまたがるリストを並べ替えてから、ブロックの配列ごと複製する
+	LinkedList<int> list;
+	list.InsertBulk(list.End(), 50, [](size_t i) { return static_cast<int>(i * 3 % 50); });
+	list.InsertBulk(list.Begin(), 30, [](size_t i) { return static_cast<int>(100 + i); });
+	list.Sort([](int a, int b) { return a > b; });
+	std::vector<int> expected;
+	list.ForEach([&expected](int value) { expected.push_back(value); });
+
+	LinkedList<int> copy(list);
+	ExpectSequence(copy, expected);
+	ExpectSequence(list, expected);
+
+	// 解放済みのノードがあるブロックはノードをたどって複製する
+	list.Remove(list.Begin());
+	expected.erase(expected.begin());
+	LinkedList<int> partial(list);
+	ExpectSequence(partial, expected);
+
+	// 全体を移したリストはブロックの記録を引き継ぎ、範囲を移した両方のリストは記録をやめる
+	LinkedList<int> target;
+	target.InsertBulk(target.End(), 3, [](size_t i) { return static_cast<int>(i); });
+	target.Splice(target.End(), partial);
+	EXPECT_EQ(0, partial.Count());
+	LinkedList<int> other(copy);
+	target.Splice(target.Begin(), other, other.Begin(), ++++other.Begin());
+	EXPECT_EQ(3 + expected.size() + 2, target.Count());
+	EXPECT_EQ(copy.Count() - 2, other.Count());
+
+	// 入れ替えやムーブの後もブロックはそれぞれのリストで一度だけ解放される
+	LinkedList<int> moved(std::move(copy));
+	moved.Swap(list);
+	other = std::move(moved);
+	ExpectSequence(other, expected);
+	list.Clean();
+	other.Clean();
+	target.Clean();
+	EXPECT_EQ(0, target.Count());
+
+	// 空になったリストは再びブロック単位で扱える
+	target.InsertBulk(target.End(), 4, [](size_t i) { return static_cast<int>(i); });
+	target.Relayout();
+	LinkedList<int> relaid(target);
+	ExpectSequence(relaid, { 0, 1, 2, 3 });
+}
+
+#pragma endregion
+
+#pragma region 固定容量リスト
+
+/// <summary>
+/// ID_0 挿入と削除を繰り返した際の並びと要素数
+/// </summary>
+TEST(InplaceLinkedListTest, InsertRemoveTest)
+{
+	InplaceLinkedList<std::string, 4> list;
+	list.Insert(list.End(), "b");
+	list.Insert(list.Begin(), "a");
+	auto last = list.Insert(list.End(), "d");
+	auto it = list.Insert(last, "c");
+	EXPECT_EQ("c", *it);
+	EXPECT_EQ(4, list.Count());
+
+	it = list.Remove(list.Begin());
+	EXPECT_EQ("b", *it);
+	list.Remove(last);
+
+	const char* expected[] = { "b", "c" };
+	size_t index = 0;
+	for (auto c = list.CBegin(); c != list.CEnd(); ++c)
+	{
+		EXPECT_EQ(expected[index++], *c);
+	}
+	EXPECT_EQ(2, index);
+
+	list.Clean();
+	EXPECT_FALSE(list.Any());
+	EXPECT_EQ(list.End(), list.Begin());
+}
+
+/// <summary>
+/// ID_1 満杯になった後の挿入と、削除で空いたノードの再利用
+/// </summary>
+TEST(InplaceLinkedListTest, FullTest)
+{
+	InplaceLinkedList<int, 3> list;
+	for (int i = 0; i < 3; i++)
+	{
+		list.Insert(list.End(), i);
+	}
+	EXPECT_TRUE(list.Full());
+
+	// 満杯の場合は挿入されず、誤った使い方として通知される
+	EXPECT_THROW(list.Insert(list.Begin(), 9), std::runtime_error);
+	EXPECT_EQ(3, list.Count());
+	EXPECT_EQ(0, *list.Begin());
+
+	list.Remove(++list.Begin());
+	EXPECT_FALSE(list.Full());
+	EXPECT_EQ(9, *list.Insert(list.Begin(), 9));
+	EXPECT_TRUE(list.Full());
+
+	InplaceLinkedList<int, 3> copy(list);
+	const int expected[] = { 9, 0, 2 };
+	size_t index = 0;
+	for (auto c = copy.CBegin(); c != copy.CEnd(); ++c)
+	{
+		EXPECT_EQ(expected[index++], *c);
+	}
+	EXPECT_EQ(3, index);
+}
+
+/// <summary>
+/// ID_2 無効なイテレータの操作
+/// </summary>
+TEST(InplaceLinkedListTest, InvalidIteratorTest)
+{
+	InplaceLinkedList<int, 2> list;
+	EXPECT_THROW(*list.End(), std::runtime_error);
+	EXPECT_THROW(++list.End(), std::runtime_error);
+	EXPECT_THROW(--list.End(), std::runtime_error);
+	EXPECT_EQ(list.End(), list.Remove(list.End()));
+}
+
+namespace
+{
+	/// <summary>
+	/// コンパイル時に挿入と削除を行い、残った要素の合計を返す
+	/// </summary>
+	constexpr int InplaceSum()
+	{
+		InplaceLinkedList<int, 8> list;
+		for (int i = 1; i <= 8; i++)
+		{
+			list.Insert(list.End(), i);
+		}
+		list.Remove(list.Begin());
+		list.Insert(list.Begin(), 100);
+
+		int sum = 0;
+		for (auto it = list.CBegin(); it != list.CEnd(); ++it)
+		{
+			sum += *it;
+		}
+		return sum;
+	}
+}
+
+/// <summary>
+/// ID_3 constexprな文脈での使用
+/// </summary>
+TEST(InplaceLinkedListTest, ConstexprTest)
+{
+	static_assert(InplaceSum() == 135);
+	EXPECT_EQ(135, InplaceSum());
+}
+
+namespace
+{
+	/// <summary>
+	/// failが立っている値のコピーで例外を送出する型
+	/// </summary>
+	struct ThrowOnCopy
+	{
+		int value;
+		bool fail;
+
+		ThrowOnCopy(int value, bool fail) : value(value), fail(fail)
+		{
+		}
+
+		ThrowOnCopy(const ThrowOnCopy& other) : value(other.value), fail(other.fail)
+		{
+			if (fail)
+			{
+				throw std::runtime_error("copy");
+			}
+		}
+	};
+}
+
+/// <summary>
+/// ID_4 要素のコピーが例外を送出しても空きノードが失われないことをチェック
+/// </summary>
+TEST(InplaceLinkedListTest, ThrowingCopyTest)
+{
+	InplaceLinkedList<ThrowOnCopy, 2> list;
+	EXPECT_THROW(list.Insert(list.End(), ThrowOnCopy(0, true)), std::runtime_error);
+	EXPECT_EQ(0, list.Count());
+
+	// 失敗した後も容量いっぱいまで挿入できる
+	EXPECT_NE(list.End(), list.Insert(list.End(), ThrowOnCopy(1, false)));
+	EXPECT_THROW(list.Insert(list.Begin(), ThrowOnCopy(0, true)), std::runtime_error);
+	EXPECT_NE(list.End(), list.Insert(list.End(), ThrowOnCopy(2, false)));
+	EXPECT_EQ(2, list.Count());
+	EXPECT_TRUE(list.Full());
+	EXPECT_EQ(1, list.Begin()->value);
+}
+
+#pragma endregion
+
+#pragma region 侵入型リスト
+
+/// <summary>
+/// ID_0 既存の要素をコピーせずに繋ぎ、切り離す
+/// </summary>
+TEST(IntrusiveListTest, InsertRemoveTest)
+{
+	PlayerScoreEntry entries[] = { { 10, "a" }, { 20, "b" }, { 30, "c" } };
+	PlayerRankingList list;
+
+	list.Insert(list.End(), entries[0]);
+	list.Insert(list.End(), entries[2]);
+	auto it = list.Insert(list.IteratorTo(entries[2]), entries[1]);
+
+	// リストは要素そのものを指している
+	EXPECT_EQ(&entries[1], &*it);
+	EXPECT_EQ(3, list.Count());
+	EXPECT_TRUE(entries[0].rankingHook.IsLinked());
+
+	it = list.Remove(list.Begin());
+	EXPECT_EQ(&entries[1], &*it);
+	EXPECT_FALSE(entries[0].rankingHook.IsLinked());
+
+	// 同じフックで二重に繋ぐことはできない
+	EXPECT_THROW(list.Insert(list.End(), entries[1]), std::runtime_error);
+
+	const int expected[] = { 20, 30 };
+	size_t index = 0;
+	for (auto c = list.CBegin(); c != list.CEnd(); ++c)
+	{
+		EXPECT_EQ(expected[index++], c->score);
+	}
+	EXPECT_EQ(2, index);
+
+	list.Clean();
+	EXPECT_FALSE(list.Any());
+	EXPECT_FALSE(entries[1].rankingHook.IsLinked());
+}
+
+/// <summary>
+/// ID_1 1つの要素を複数のフックで別々のリストに繋ぐ
+/// </summary>
+TEST(IntrusiveListTest, MultipleHooksTest)
+{
+	PlayerScoreEntry entries[] = { { 10, "a" }, { 20, "b" }, { 30, "c" } };
+	PlayerRankingList ranking;
+	PlayerUpdateList updates;
+
+	for (auto& entry : entries)
+	{
+		ranking.Insert(ranking.Begin(), entry);
+	}
+	updates.Insert(updates.End(), entries[1]);
+
+	// 更新待ちから値を書き換えると、ランキング側からも見える
+	updates.Begin()->score = 25;
+	updates.Remove(updates.Begin());
+
+	EXPECT_FALSE(updates.Any());
+	EXPECT_FALSE(entries[1].updateHook.IsLinked());
+	EXPECT_TRUE(entries[1].rankingHook.IsLinked());
+
+	const int expected[] = { 30, 25, 10 };
+	size_t index = 0;
+	for (auto c = ranking.CBegin(); c != ranking.CEnd(); ++c)
+	{
+		EXPECT_EQ(expected[index++], c->score);
+	}
+	EXPECT_EQ(3, index);
+
+	// このリストに繋がっていない要素のイテレータは取得できない
+	EXPECT_THROW(updates.IteratorTo(entries[0]), std::runtime_error);
+	ranking.Clean();
+}
+
+/// <summary>
+/// ID_2 要素をコピーしてもフックはコピーされない
+/// </summary>
+TEST(IntrusiveListTest, CopyHookTest)
+{
+	PlayerScoreEntry entry(10, "a");
+	PlayerRankingList list;
+	list.Insert(list.End(), entry);
+
+	PlayerScoreEntry copy = entry;
+	EXPECT_FALSE(copy.rankingHook.IsLinked());
+	EXPECT_EQ(10, copy.score);
+
+	copy = entry;
+	list.Insert(list.End(), copy);
+	entry = copy;
+	EXPECT_TRUE(entry.rankingHook.IsLinked());
+	EXPECT_EQ(2, list.Count());
+	EXPECT_EQ(&copy, &*++list.Begin());
+}
+
+#pragma endregion
+
+#pragma region 取り込みパイプライン
+
+/// <summary>
+/// ID_0 複数のチャンクに分けて並列に解析してもファイル内の順番どおりに追加されることをチェック
+/// </summary>
+TEST(ScoreIngestTest, OrderedIngestTest)
+{
+	{
+		std::ofstream file("ingest_test.txt", std::ios::binary);
+		for (int i = 0; i < 1000; i++)
+		{
+			file << i << "\tplayer" << i << (i % 2 ? "\r\n" : "\n");
+			if (i == 500)
+			{
+				// チャンクより長い行と解析できない行
+				file << std::string(300, 'x') << "\n";
+				file << "7\t" << std::string(300, 'y') << "\n";
+			}
+		}
+		file << "1000\tlast";
+	}
+
+	IngestOptions options;
+	options.chunkSize = 64;
+	options.parserCount = 3;
+	options.queueCapacity = 2;
+	ScoreIngestPipeline pipeline(options);
+
+	LinkedList<PlayerScore> list;
+	list.Insert(list.End(), PlayerScore(-1, "existing"));
+	ASSERT_TRUE(pipeline.Run("ingest_test.txt", list));
+
+	ASSERT_EQ(1003, list.Count());
+	auto it = list.CBegin();
+	EXPECT_EQ("existing", it->id);
+	++it;
+	for (int i = 0; i <= 1000; i++, ++it)
+	{
+		EXPECT_EQ(i, it->score);
+		EXPECT_EQ(i == 1000 ? "last" : "player" + std::to_string(i), it->id);
+		if (i == 500)
+		{
+			++it;
+			EXPECT_EQ(std::string(300, 'y'), it->id);
+		}
+	}
+
+	const IngestStats stats = pipeline.Stats();
+	EXPECT_EQ(1002, stats.parser.items);
+	EXPECT_EQ(1002, stats.builder.items);
+	EXPECT_EQ(stats.reader.bytes, stats.parser.bytes);
+	EXPECT_LE(stats.readQueue.maxDepth, 2);
+	EXPECT_LE(stats.parseQueue.maxDepth, 2);
+	EXPECT_EQ(0, stats.reorderDepth);
+
+	std::remove("ingest_test.txt");
+}
+
+/// <summary>
+/// ID_1 存在しないファイルを指定した際の戻り値
+/// </summary>
+TEST(ScoreIngestTest, MissingFileTest)
+{
+	ScoreIngestPipeline pipeline;
+	LinkedList<PlayerScore> list;
+	EXPECT_FALSE(pipeline.Run("ingest_missing.txt", list));
+	EXPECT_FALSE(list.Any());
+}
+
+#pragma endregion
+
+#pragma region ストリーミング読み込み
+
+/// <summary>
+/// ID_0 バッファより大きなファイルを1行ずつ読み込んだ際の値
+/// </summary>
+TEST(ScoreReaderTest, ReadAllTest)
+{
+	{
+		std::ofstream file("reader_test.txt", std::ios::binary);
+		for (int i = 0; i < 100; i++)
+		{
+			file << i << "\tplayer" << i << "\r\n";
+		}
+		// バッファより長い行と解析できない行
+		file << "bad\n" << "100\t" << std::string(50, 'z');
+	}
+
+	int index = 0;
+	long long sum = 0;
+	for (const ScoreView& view : ReadScores("reader_test.txt", 16))
+	{
+		EXPECT_EQ(index, view.score);
+		EXPECT_EQ(index == 100 ? std::string(50, 'z') : "player" + std::to_string(index), view.id);
+		sum += view.score;
+		index++;
+	}
+	EXPECT_EQ(101, index);
+	EXPECT_EQ(5050, sum);
+
+	std::remove("reader_test.txt");
+}
+
+/// <summary>
+/// ID_1 途中で読み込みをやめた場合と、存在しないファイルの場合
+/// </summary>
+TEST(ScoreReaderTest, StopEarlyTest)
+{
+	{
+		std::ofstream file("reader_test.txt", std::ios::binary);
+		file << "10\ta\n20\tb\n30\tc\n";
+	}
+
+	LinkedList<PlayerScore> list;
+	for (const ScoreView& view : ReadScores("reader_test.txt"))
+	{
+		if (view.score > 20)
+		{
+			break;
+		}
+		list.Insert(list.End(), view.ToPlayerScore());
+	}
+	EXPECT_EQ(2, list.Count());
+	EXPECT_EQ("b", (++list.Begin())->id);
+
+	int count = 0;
+	for (const ScoreView& view : ReadScores("reader_missing.txt"))
+	{
+		count += view.score;
+	}
+	EXPECT_EQ(0, count);
+
+	std::remove("reader_test.txt");
+}
+
+#pragma endregion
+
+#pragma region 外部ソート
+
+/// <summary>
+/// ID_0 複数のランに分けてソートした結果が、メモリ上でソートした結果と一致することをチェック
+/// </summary>
+TEST(ExternalSortTest, MultipleRunsTest)
+{
+	{
+		std::ofstream file("external_input.txt", std::ios::binary);
+		for (int i = 0; i < 2000; i++)
+		{
+			file << (i * 7919) % 101 << "\tplayer" << i << "\n";
+		}
+		file << "bad line\n";
+	}
+
+	ExternalSortOptions options;
+	options.memoryBudget = 8 << 10;
+	options.ioBufferSize = 256;
+	ExternalSortStats stats;
+	ASSERT_TRUE(ExternalSortScores("external_input.txt", "external_output.txt", options, &stats));
+	EXPECT_EQ(2000, stats.rows);
+	EXPECT_GT(stats.runs, 2);
+	// 8KBの上限では2つずつしか同時に読めないので、中間のマージを何度か挟む
+	EXPECT_GT(stats.mergePasses, 1);
+
+	LinkedList<PlayerScore> expected;
+	ASSERT_TRUE(LoadScores("external_input.txt", expected));
+	expected.Sort([](const PlayerScore& a, const PlayerScore& b) { return a.score > b.score; });
+
+	LinkedList<PlayerScore> sorted;
+	ASSERT_TRUE(LoadScores("external_output.txt", sorted));
+	ASSERT_EQ(2000, sorted.Count());
+	auto it = sorted.CBegin();
+	for (auto e = expected.CBegin(); e != expected.CEnd(); ++e, ++it)
+	{
+		EXPECT_EQ(e->score, it->score);
+		EXPECT_EQ(e->id, it->id);
+	}
+
+	// 一時ファイルは残らない
+	EXPECT_FALSE(std::ifstream("external_output.txt.run0.tmp").is_open());
+
+	std::remove("external_input.txt");
+	std::remove("external_output.txt");
+}
+
+/// <summary>
+/// ID_1 メモリに収まる場合と、比較関数を指定した場合
+/// </summary>
+TEST(ExternalSortTest, InMemoryTest)
+{
+	{
+		std::ofstream file("external_input.txt", std::ios::binary);
+		file << "3\tc\n1\ta\n2\tb\n1\td";
+	}
+
+	ExternalSortStats stats;
+	ASSERT_TRUE(ExternalSortScores("external_input.txt", "external_output.txt",
+		[](const PlayerScore& a, const PlayerScore& b) { return a.score < b.score; }, ExternalSortOptions(), &stats));
+	EXPECT_EQ(4, stats.rows);
+	EXPECT_EQ(0, stats.runs);
+
+	std::ifstream output("external_output.txt", std::ios::binary);
+	const std::string content((std::istreambuf_iterator<char>(output)), std::istreambuf_iterator<char>());
+	EXPECT_EQ("1	a\n1	d\n2	b\n3	c\n", content);
+	output.close();
+
+	EXPECT_FALSE(ExternalSortScores("external_missing.txt", "external_output.txt"));
+
+	std::remove("external_input.txt");
+	std::remove("external_output.txt");
+}
+
+/// <summary>
+/// ID_2 行の途中で終わっているランを、正常な終わりと区別して失敗として扱うことをチェック
+/// </summary>
+TEST(ExternalSortTest, TruncatedRunTest)
+{
+	std::string run;
+	ScoreWriter::AppendRow(run, PlayerScore(1, "a"), ScoreFormat::Binary);
+	ScoreWriter::AppendRow(run, PlayerScore(2, "bcd"), ScoreFormat::Binary);
+	for (size_t size : { run.size(), run.size() - 2, run.size() - 9 })
+	{
+		{
+			std::ofstream file("external_run.tmp", std::ios::binary | std::ios::trunc);
+			file.write(run.data(), static_cast<std::streamsize>(size));
+		}
+
+		ExternalSortDetail::RunReader reader("external_run.tmp", 16);
+		PlayerScore playerScore(0, "");
+		ASSERT_TRUE(reader.Next(playerScore));
+		EXPECT_EQ(1, playerScore.score);
+		EXPECT_EQ(size == run.size(), reader.Next(playerScore));
+		EXPECT_FALSE(reader.Next(playerScore));
+		EXPECT_EQ(size != run.size(), reader.Failed());
+	}
+	std::remove("external_run.tmp");
+
+	ExternalSortDetail::RunReader missing("external_missing.tmp", 16);
+	PlayerScore playerScore(0, "");
+	EXPECT_FALSE(missing.Next(playerScore));
+	EXPECT_TRUE(missing.Failed());
+}
+
+/// <summary>
+/// ID_3 メモリ上限に0を指定しても、最小値に切り上げて1行ごとのランを作らないことをチェック
+/// </summary>
+TEST(ExternalSortTest, MinMemoryBudgetTest)
+{
+	{
+		std::ofstream file("external_input.txt", std::ios::binary);
+		for (int i = 0; i < 100; i++)
+		{
+			file << i << "\tp" << i << "\n";
+		}
+	}
+
+	ExternalSortOptions options;
+	options.memoryBudget = 0;
+	ExternalSortStats stats;
+	ASSERT_TRUE(ExternalSortScores("external_input.txt", "external_output.txt", options, &stats));
+	EXPECT_EQ(100, stats.rows);
+	EXPECT_LT(stats.runs, 10);
+
+	std::remove("external_input.txt");
+	std::remove("external_output.txt");
+}
+
+/// <summary>
+/// ID_4 ランの書き出しに失敗したら、残りの入力を読まずに失敗を返すことをチェック
+/// </summary>
+TEST(ExternalSortTest, SpillFailureStopsTest)
+{
+	{
+		std::ofstream file("external_input.txt", std::ios::binary);
+		for (int i = 0; i < 2000; i++)
+		{
+			file << (i * 7919) % 101 << "\tplayer" << i << "\n";
+		}
+	}
+
+	// 存在しないディレクトリを一時ファイルの置き場所にして、最初のランの書き出しで失敗させる
+	ExternalSortOptions options;
+	options.memoryBudget = 8 << 10;
+	options.tempDirectory = "external_missing_directory";
+	size_t compared = 0;
+	EXPECT_FALSE(ExternalSortScores("external_input.txt", "external_output.txt",
+		[&compared](const PlayerScore& a, const PlayerScore& b) { compared++; return a.score > b.score; }, options));
+
+	// 最初のランのソートだけで比較をやめている（全ランをソートすると1万回を超える）
+	EXPECT_GT(compared, 0);
+	EXPECT_LT(compared, 2000);
+	EXPECT_FALSE(std::ifstream("external_output.txt").is_open());
+
+	std::remove("external_input.txt");
+}
+
+#pragma endregion
+
+#pragma region 索引付きの検索
+
+/// <summary>
+/// ID_0 スコアの範囲で検索した際の結果
+/// </summary>
+TEST(IndexedScoreListTest, RangeByScoreTest)
+{
+	IndexedScoreList list;
+	list.Insert(list.End(), PlayerScore(25000, "Kai"));
+	list.Insert(list.End(), PlayerScore(10000, "Ken"));
+	list.Insert(list.End(), PlayerScore(30000, "Mio"));
+	list.Insert(list.End(), PlayerScore(20000, "Kaede"));
+	list.Insert(list.End(), PlayerScore(30001, "Rin"));
+	list.Insert(list.End(), PlayerScore(25000, "Sora"));
+
+	auto result = list.RangeByScore(20000, 30000);
+	const char* expected[] = { "Kaede", "Kai", "Sora", "Mio" };
+	ASSERT_EQ(4, result.size());
+	for (size_t i = 0; i < result.size(); i++)
+	{
+		EXPECT_EQ(expected[i], result[i]->id);
+	}
+
+	EXPECT_TRUE(list.RangeByScore(30002, 40000).empty());
+	EXPECT_TRUE(list.RangeByScore(30000, 20000).empty());
+
+	// 検索結果のイテレータはリスト上の位置を指している
+	auto it = result[0];
+	++it;
+	EXPECT_EQ("Rin", it->id);
+}
+
+/// <summary>
+/// ID_1 IDの前方一致で検索した際の結果
+/// </summary>
+TEST(IndexedScoreListTest, ByIdPrefixTest)
+{
+	IndexedScoreList list;
+	list.Insert(list.End(), PlayerScore(1, "Kai"));
+	list.Insert(list.End(), PlayerScore(2, "Ken"));
+	list.Insert(list.End(), PlayerScore(3, "kai"));
+	list.Insert(list.End(), PlayerScore(4, "Kaede"));
+	list.Insert(list.End(), PlayerScore(5, "K"));
+
+	auto result = list.ByIdPrefix("Ka");
+	ASSERT_EQ(2, result.size());
+	EXPECT_EQ("Kaede", result[0]->id);
+	EXPECT_EQ("Kai", result[1]->id);
+
+	EXPECT_EQ(4, list.ByIdPrefix("K").size());
+	EXPECT_EQ(5, list.ByIdPrefix("").size());
+	EXPECT_TRUE(list.ByIdPrefix("Kaz").empty());
+}
+
+/// <summary>
+/// ID_2 削除とスコア変更の後も索引が一致していることをチェック
+/// </summary>
+TEST(IndexedScoreListTest, RemoveAndUpdateTest)
+{
+	IndexedScoreList list;
+	auto kai = list.Insert(list.End(), PlayerScore(100, "Kai"));
+	auto ken = list.Insert(list.End(), PlayerScore(100, "Ken"));
+	list.Insert(list.Begin(), PlayerScore(200, "Kai"));
+
+	list.Remove(kai);
+	EXPECT_EQ(2, list.Count());
+	auto result = list.ByIdPrefix("Kai");
+	ASSERT_EQ(1, result.size());
+	EXPECT_EQ(200, result[0]->score);
+
+	list.UpdateScore(ken, 300);
+	EXPECT_TRUE(list.RangeByScore(0, 199).empty());
+	result = list.RangeByScore(250, 300);
+	ASSERT_EQ(1, result.size());
+	EXPECT_EQ("Ken", result[0]->id);
+
+	list.Clean();
+	EXPECT_TRUE(list.ByIdPrefix("").empty());
+	EXPECT_TRUE(list.RangeByScore(0, 1000).empty());
+}
+
+#pragma endregion
+
+#pragma region レイテンシの計測
+
+/// <summary>
+/// ID_0 ヒストグラムのバケットとパーセンタイルの計算
+/// </summary>
+TEST(LatencyHistogramTest, PercentileTest)
+{
+	// 小さい値はそのままの番号のバケットに入る
+	EXPECT_EQ(0, LatencyHistogram::BucketIndex(0));
+	EXPECT_EQ(31, LatencyHistogram::BucketIndex(31));
+	EXPECT_EQ(31, LatencyHistogram::BucketUpperBound(31));
+
+	// バケットの上端は値以上で、誤差は値の1/32以内
+	for (uint64_t value : { 32ull, 33ull, 1000ull, 123456789ull, 1ull << 39 })
+	{
+		const uint64_t upper = LatencyHistogram::BucketUpperBound(LatencyHistogram::BucketIndex(value));
+		EXPECT_GE(upper, value);
+		EXPECT_LE(upper - value, value / 32);
+	}
+	EXPECT_EQ(LatencyHistogram::BucketCount - 1, LatencyHistogram::BucketIndex(~0ull));
+
+	LatencyHistogram histogram;
+	EXPECT_EQ(0, histogram.Percentile(50.0));
+	for (uint64_t value = 1; value <= 1000; value++)
+	{
+		histogram.Record(value);
+	}
+	EXPECT_EQ(1000, histogram.Count());
+	EXPECT_EQ(1000, histogram.Max());
+	EXPECT_DOUBLE_EQ(500.5, histogram.Mean());
+	EXPECT_NEAR(500.0, static_cast<double>(histogram.Percentile(50.0)), 500.0 / 32);
+	EXPECT_NEAR(990.0, static_cast<double>(histogram.Percentile(99.0)), 990.0 / 32);
+	EXPECT_EQ(1000, histogram.Percentile(100.0));
+
+	histogram.Reset();
+	EXPECT_EQ(0, histogram.Count());
+	EXPECT_EQ(0, histogram.Max());
+}
+
+/// <summary>
+/// ID_1 間引きを設定した際に記録される回数
+/// </summary>
+TEST(LatencyTracerTest, SampleRateTest)
+{
+	LatencyTracer& tracer = LatencyTracer::Instance();
+	tracer.Reset();
+
+	tracer.SetSampleRate(4);
+	for (int i = 0; i < 8; i++)
+	{
+		TraceScope scope(TraceOp::Insert);
+	}
+	EXPECT_EQ(2, tracer.Histogram(TraceOp::Insert).Count());
+
+	tracer.SetSampleRate(0);
+	for (int i = 0; i < 8; i++)
+	{
+		TraceScope scope(TraceOp::Insert);
+	}
+	EXPECT_EQ(2, tracer.Histogram(TraceOp::Insert).Count());
+
+	tracer.SetSampleRate(1);
+	{
+		TraceScope scope(TraceOp::Remove);
+	}
+	EXPECT_EQ(1, tracer.Histogram(TraceOp::Remove).Count());
+	tracer.Reset();
+}
+
+/// <summary>
+/// ID_2 集計結果の書き出し
+/// </summary>
+TEST(LatencyTracerTest, WriteSummaryTest)
+{
+	LatencyTracer& tracer = LatencyTracer::Instance();
+	tracer.Reset();
+	tracer.Record(TraceOp::Sort, 100);
+	tracer.Record(TraceOp::Sort, 200);
+	tracer.Record(TraceOp::Sort, 300);
+
+	std::ostringstream out;
+	tracer.WriteSummary(out);
+	// 記録の無い操作は出力しない
+	EXPECT_EQ("op\tcount\tmean_ns\tp50_ns\tp99_ns\tp999_ns\tmax_ns\nSort\t3\t200\t203\t300\t300\t300\n", out.str());
+	tracer.Reset();
+}
+
+#pragma endregion
+
+#pragma region ハンドル
+
+/// <summary>
+/// ID_0 要素を削除した後のハンドル
+/// </summary>
+TEST(LinkedListHandleTest, RemoveTest)
+{
+	LinkedList<PlayerScore> list;
+	auto kai = list.Insert(list.End(), PlayerScore(100, "Kai"));
+	auto ken = list.Insert(list.End(), PlayerScore(200, "Ken"));
+
+	auto kaiHandle = list.GetHandle(kai);
+	auto kenHandle = list.GetHandle(ken);
+	EXPECT_EQ(kaiHandle, list.GetHandle(kai));
+	EXPECT_NE(kaiHandle, kenHandle);
+	EXPECT_TRUE(list.IsValid(kaiHandle));
+	EXPECT_EQ("Kai", list.Resolve(kaiHandle)->id);
+
+	list.Remove(kai);
+	EXPECT_FALSE(list.IsValid(kaiHandle));
+	EXPECT_EQ(list.End(), list.Resolve(kaiHandle));
+	EXPECT_EQ("Ken", list.Resolve(kenHandle)->id);
+
+	// 解放されたスロットが再利用されても、古いハンドルは無効なまま
+	auto mio = list.Insert(list.End(), PlayerScore(300, "Mio"));
+	auto mioHandle = list.GetHandle(mio);
+	EXPECT_NE(kaiHandle, mioHandle);
+	EXPECT_FALSE(list.IsValid(kaiHandle));
+	EXPECT_EQ("Mio", list.Resolve(mioHandle)->id);
+
+	// どの要素も指さないハンドルと末尾イテレータ
+	EXPECT_FALSE(list.IsValid(LinkedList<PlayerScore>::Handle()));
+	EXPECT_THROW(list.GetHandle(list.End()), std::runtime_error);
+}
+
+/// <summary>
+/// ID_1 遅延削除と再配置の後のハンドル
+/// </summary>
+TEST(LinkedListHandleTest, LazyRemoveAndRelayoutTest)
+{
+	LinkedList<int> list;
+	list.SetLazyRemove(true, 0.0);
+	std::vector<LinkedList<int>::Handle> handles;
+	for (int i = 0; i < 10; i++)
+	{
+		handles.push_back(list.GetHandle(list.Insert(list.End(), i)));
+	}
+
+	// 削除済みの印を付けただけの要素のハンドルもすぐに無効になる
+	auto it = list.Begin();
+	++it;
+	list.Remove(it);
+	EXPECT_FALSE(list.IsValid(handles[1]));
+	EXPECT_EQ(1, list.TombstoneCount());
+
+	// 再配置でノードが変わっても同じ要素を指す
+	list.Relayout();
+	for (int i = 0; i < 10; i++)
+	{
+		if (i == 1)
+		{
+			EXPECT_FALSE(list.IsValid(handles[i]));
+			continue;
+		}
+		ASSERT_TRUE(list.IsValid(handles[i]));
+		EXPECT_EQ(i, *list.Resolve(handles[i]));
+	}
+
+	list.RelayoutStep(3);
+	const LinkedList<int>& constList = list;
+	EXPECT_EQ(9, *constList.Resolve(handles[9]));
+}
+
+/// <summary>
+/// ID_2 リスト全体を操作した後のハンドル
+/// </summary>
+TEST(LinkedListHandleTest, InvalidateTest)
+{
+	LinkedList<int> list;
+	list.Insert(list.End(), 1);
+	auto handle = list.GetHandle(list.Begin());
+
+	// ソートではノードが変わらないので有効なまま
+	list.Insert(list.End(), 0);
+	list.Sort();
+	EXPECT_EQ(1, *list.Resolve(handle));
+
+	// コピー先では使えない
+	LinkedList<int> copy(list);
+	EXPECT_FALSE(copy.IsValid(handle));
+
+	// 入れ替えやムーブでは両方のリストのハンドルが無効になる
+	LinkedList<int> other;
+	list.Swap(other);
+	EXPECT_FALSE(list.IsValid(handle));
+	EXPECT_FALSE(other.IsValid(handle));
+
+	handle = other.GetHandle(other.Begin());
+	LinkedList<int> moved(std::move(other));
+	EXPECT_FALSE(other.IsValid(handle));
+	EXPECT_EQ(2, moved.Count());
+
+	handle = moved.GetHandle(moved.Begin());
+	moved.Clean();
+	EXPECT_FALSE(moved.IsValid(handle));
+	moved.Insert(moved.End(), 5);
+	EXPECT_FALSE(moved.IsValid(handle));
+}
+
+#pragma endregion
+
+#pragma region まとめての削除
+
+/// <summary>
+/// ID_0 条件を満たす要素をまとめて削除した際の挙動
+/// </summary>
+TEST(LinkedListRemoveIfTest, RemoveIfTest)
+{
+	LinkedList<PlayerScore> list;
+	const int scores[] = { 10, 50, 20, 5, 70, 30, 1, 2 };
+	for (int i = 0; i < 8; i++)
+	{
+		list.Insert(list.End(), PlayerScore(scores[i], std::to_string(i)));
+	}
+	auto handle = list.GetHandle(++list.Begin());
+	auto kept = list.Begin();
+	++kept;
+	++kept;
+
+	// 先頭・途中・末尾の連続した2要素を削除する
+	EXPECT_EQ(4, list.RemoveIf([](const PlayerScore& playerScore) { return playerScore.score < 25 && playerScore.id != "2"; }));
+	const char* expected[] = { "1", "2", "4", "5" };
+	ASSERT_EQ(4, list.Count());
+	size_t index = 0;
+	for (auto it = list.CBegin(); it != list.CEnd(); ++it)
+	{
+		EXPECT_EQ(expected[index++], it->id);
+	}
+	// 末尾からも辿れる
+	auto last = list.Begin();
+	for (int i = 0; i < 3; i++)
+	{
+		++last;
+	}
+	EXPECT_EQ("2", (--(--last))->id);
+
+	// 残った要素のイテレータとハンドルは有効なまま
+	EXPECT_EQ("2", kept->id);
+	EXPECT_EQ("1", list.Resolve(handle)->id);
+
+	EXPECT_EQ(0, list.RemoveIf([](const PlayerScore&) { return false; }));
+	EXPECT_EQ(4, list.RemoveIf([](const PlayerScore&) { return true; }));
+	EXPECT_FALSE(list.Any());
+	EXPECT_EQ(list.End(), list.Begin());
+	EXPECT_EQ(0, list.RemoveIf([](const PlayerScore&) { return true; }));
+}
+
+/// <summary>
+/// ID_1 範囲を指定して削除した際の挙動
+/// </summary>
+TEST(LinkedListRemoveIfTest, RemoveRangeTest)
+{
+	LinkedList<int> list;
+	const int values[] = { 0, 1, 2, 3, 4, 5 };
+	list.InsertRange(list.End(), values, values + 6);
+
+	auto first = ++list.Begin();
+	auto last = first;
+	++last;
+	++last;
+	++last;
+	EXPECT_EQ(3, list.Remove(first, last));
+	EXPECT_EQ(3, list.Count());
+	EXPECT_EQ(4, *last);
+	EXPECT_EQ(0, *(--last));
+
+	// 空の範囲
+	EXPECT_EQ(0, list.Remove(list.Begin(), list.Begin()));
+	EXPECT_EQ(0, list.Remove(list.End(), list.End()));
+
+	// 全体
+	EXPECT_EQ(3, list.Remove(list.Begin(), list.End()));
+	EXPECT_FALSE(list.Any());
+	list.Insert(list.End(), 7);
+	EXPECT_EQ(7, *list.Begin());
+}
+
+/// <summary>
+/// ID_2 遅延削除モードや、判定中に例外が発生した場合の挙動
+/// </summary>
+TEST(LinkedListRemoveIfTest, TombstoneAndExceptionTest)
+{
+	LinkedList<int> list;
+	list.SetLazyRemove(true, 0.0);
+	for (int i = 0; i < 10; i++)
+	{
+		list.Insert(list.End(), i);
+	}
+	list.Remove(list.Begin());
+	EXPECT_EQ(1, list.TombstoneCount());
+
+	// トゥームストーンも一緒に解放され、削除数には数えない
+	EXPECT_EQ(4, list.RemoveIf([](int value) { return value % 2 == 0; }));
+	EXPECT_EQ(0, list.TombstoneCount());
+	EXPECT_EQ(5, list.Count());
+
+	// 例外が発生するまでに条件を満たした要素だけが削除される
+	EXPECT_THROW(list.RemoveIf([](int value)
+	{
+		if (value == 5)
+		{
+			throw std::runtime_error("stop");
+		}
+		return value == 3;
+	}), std::runtime_error);
+	const int expected[] = { 1, 5, 7, 9 };
+	ASSERT_EQ(4, list.Count());
+	size_t index = 0;
+	for (auto it = list.CBegin(); it != list.CEnd(); ++it)
+	{
+		EXPECT_EQ(expected[index++], *it);
+	}
+}
+
+#pragma endregion
+
+#pragma region ノードキャッシュ
+
+/// <summary>
+/// ID_0 解放した領域が同じスレッドで再利用されることをチェック
+/// </summary>
+TEST(NodeCacheTest, ReuseTest)
+{
+	using Cache = NodeCache<48, 8>;
+	void* first = Cache::Allocate();
+	Cache::Deallocate(first);
+	EXPECT_EQ(first, Cache::Allocate());
+
+	// マガジンをまたいで確保しても、領域は重ならず、アライメントも保たれる
+	std::vector<char*> pointers;
+	for (size_t i = 0; i < Cache::MagazineSize * 3; i++)
+	{
+		pointers.push_back(static_cast<char*>(Cache::Allocate()));
+		EXPECT_EQ(0, reinterpret_cast<uintptr_t>(pointers.back()) % 8);
+	}
+	pointers.push_back(static_cast<char*>(first));
+	std::sort(pointers.begin(), pointers.end());
+	for (size_t i = 1; i < pointers.size(); i++)
+	{
+		EXPECT_GE(pointers[i] - pointers[i - 1], 48);
+	}
+	for (char* pointer : pointers)
+	{
+		Cache::Deallocate(pointer);
+	}
+}
+
+/// <summary>
+/// ID_1 ノードキャッシュを使うリストの基本的な操作
+/// </summary>
+TEST(NodeCacheTest, ListTest)
+{
+	LinkedList<PlayerScore> list;
+	list.SetNodeCache(true);
+	for (int i = 0; i < 200; i++)
+	{
+		list.Insert(list.End(), PlayerScore(i, std::to_string(i)));
+	}
+	const PlayerScore values[] = { PlayerScore(-1, "a"), PlayerScore(-2, "b") };
+	list.InsertRange(list.Begin(), values, values + 2);
+	EXPECT_EQ(202, list.Count());
+
+	EXPECT_EQ(100, list.RemoveIf([](const PlayerScore& playerScore) { return playerScore.score >= 0 && playerScore.score % 2 == 1; }));
+	list.Remove(list.Begin());
+
+	// コピーやキャッシュを使わないリストとの間でノードを移しても、それぞれ正しく解放される
+	LinkedList<PlayerScore> copy(list);
+	LinkedList<PlayerScore> plain;
+	plain.Insert(plain.End(), PlayerScore(1000, "plain"));
+	plain.Splice(plain.Begin(), list);
+	EXPECT_FALSE(list.Any());
+	EXPECT_EQ(102, plain.Count());
+	EXPECT_EQ("b", plain.Begin()->id);
+	plain.Relayout();
+	EXPECT_EQ(101, copy.Count());
+	plain.Clean();
+	copy.Clean();
+}
+
+/// <summary>
+/// ID_2 複数のスレッドで作ったリストを1つにまとめ、別のスレッドで解放した際の挙動
+/// </summary>
+TEST(NodeCacheTest, MultiThreadTest)
+{
+	const int threadCount = 4;
+	const int perThread = 5000;
+	std::vector<LinkedList<PlayerScore>> lists(threadCount);
+	std::vector<std::thread> threads;
+	for (int t = 0; t < threadCount; t++)
+	{
+		threads.emplace_back([&lists, t, perThread]()
+		{
+			LinkedList<PlayerScore>& list = lists[t];
+			list.SetNodeCache(true);
+			for (int i = 0; i < perThread; i++)
+			{
+				list.Insert(list.End(), PlayerScore(t * perThread + i, "p"));
+				// 確保と解放を混ぜてマガジンとデポのやり取りを起こす
+				if (i % 3 == 0)
+				{
+					list.Remove(list.Begin());
+				}
+			}
+		});
+	}
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	LinkedList<PlayerScore> merged;
+	for (auto& list : lists)
+	{
+		merged.Splice(merged.End(), list);
+	}
+	const size_t expected = static_cast<size_t>(threadCount) * (perThread - (perThread + 2) / 3);
+	EXPECT_EQ(expected, merged.Count());
+
+	// 別のスレッドで半分を解放し、残りをこのスレッドで解放する
+	std::thread remover([&merged]()
+	{
+		merged.RemoveIf([](const PlayerScore& playerScore) { return playerScore.score % 2 == 0; });
+	});
+	remover.join();
+	long long sum = 0;
+	merged.ForEach([&sum](const PlayerScore& playerScore) { sum += playerScore.score % 2; });
+	EXPECT_EQ(static_cast<long long>(merged.Count()), sum);
+	merged.Clean();
+	EXPECT_FALSE(merged.Any());
+}
+
+/// <summary>
+/// ID_3 範囲を指定してノードを繋ぎ替えた際の挙動
+/// </summary>
+TEST(NodeCacheTest, SpliceRangeTest)
+{
+	LinkedList<int> source;
+	source.SetLazyRemove(true, 0.0);
+	const int values[] = { 0, 1, 2, 3, 4, 5 };
+	source.InsertRange(source.End(), values, values + 6);
+	auto first = ++source.Begin();
+	auto last = first;
+	for (int i = 0; i < 3; i++)
+	{
+		++last;
+	}
+	auto handle = source.GetHandle(first);
+	auto two = first;
+	++two;
+	source.Remove(two);
+
+	// 1, (2は削除済み), 3 を移す（遅延削除でない移動先では2はその場で解放される）
+	LinkedList<int> target;
+	target.Insert(target.End(), 9);
+	target.Splice(target.Begin(), source, first, last);
+	EXPECT_EQ(3, target.Count());
+	EXPECT_EQ(0, target.TombstoneCount());
+	EXPECT_EQ(0, source.TombstoneCount());
+	EXPECT_EQ(3, source.Count());
+	EXPECT_FALSE(source.IsValid(handle));
+
+	const int expectedTarget[] = { 1, 3, 9 };
+	size_t index = 0;
+	for (auto it = target.CBegin(); it != target.CEnd(); ++it)
+	{
+		EXPECT_EQ(expectedTarget[index++], *it);
+	}
+	const int expectedSource[] = { 0, 4, 5 };
+	index = 0;
+	for (auto it = source.CBegin(); it != source.CEnd(); ++it)
+	{
+		EXPECT_EQ(expectedSource[index++], *it);
+	}
+
+	// 同じリスト内での移動（先頭の要素を末尾へ）
+	source.Splice(source.End(), source, source.Begin(), ++source.Begin());
+	const int rotated[] = { 4, 5, 0 };
+	index = 0;
+	for (auto it = source.CBegin(); it != source.CEnd(); ++it)
+	{
+		EXPECT_EQ(rotated[index++], *it);
+	}
+	EXPECT_EQ(3, source.Count());
+}
+
+#pragma endregion
+
+#pragma region 固定長のID
+
+/// <summary>
+/// ID_0 IDの作成と、長いIDの登録
+/// </summary>
+TEST(PlayerIdTest, ConstructTest)
+{
+	PlayerId empty;
+	EXPECT_EQ(0, empty.Size());
+	EXPECT_EQ("", empty.View());
+	EXPECT_EQ(PlayerId(""), empty);
+
+	PlayerId shortId("yst");
+	EXPECT_EQ(3, shortId.Size());
+	EXPECT_EQ("yst", shortId.View());
+
+	// 16バイトちょうどと、それを超える長さ
+	PlayerId inlineId("0123456789abcdef");
+	EXPECT_EQ("0123456789abcdef", inlineId.View());
+	PlayerId longId("0123456789abcdef-overflow");
+	EXPECT_EQ("0123456789abcdef-overflow", longId.ToString());
+	EXPECT_NE(inlineId, longId);
+
+	// 同じ内容の長いIDは同じ領域を指す
+	const std::string text = "0123456789abcdef-overflow";
+	PlayerId sameId(text);
+	EXPECT_EQ(longId, sameId);
+	EXPECT_EQ(longId.View().data(), sameId.View().data());
+
+	// コピーしても同じ内容を指す
+	PlayerId copied;
+	std::memcpy(static_cast<void*>(&copied), &longId, sizeof(PlayerId));
+	EXPECT_EQ(longId, copied);
+	EXPECT_TRUE(std::is_trivially_copyable_v<CompactPlayerScore>);
+}
+
+/// <summary>
+/// ID_1 一致判定と大小比較がstd::stringの比較と一致することをチェック
+/// </summary>
+TEST(PlayerIdTest, CompareTest)
+{
+	const std::string ids[] = {
+		"", "a", "ab", "abc", "abd", "b", "PUCKUP", "83force", "yst",
+		std::string("ab\0", 3), std::string("ab\0c", 4), "\xff", "a\xff",
+		"0123456789abcde", "0123456789abcdef", "0123456789abcdefa", "0123456789abcdefb",
+		"0123456789abcdefab", "0123456789abcdeg", "0123456789abcdef0123456789",
+	};
+	for (const std::string& a : ids)
+	{
+		for (const std::string& b : ids)
+		{
+			const PlayerId x(a);
+			const PlayerId y(b);
+			const int expected = a.compare(b);
+			EXPECT_EQ(a == b, x == y) << a << " / " << b;
+			EXPECT_EQ(a != b, x != y) << a << " / " << b;
+			EXPECT_EQ(a < b, x < y) << a << " / " << b;
+			EXPECT_EQ(expected < 0 ? -1 : (expected > 0 ? 1 : 0), (x.Compare(y) > 0) - (x.Compare(y) < 0)) << a << " / " << b;
+		}
+	}
+}
+
+/// <summary>
+/// ID_2 CompactPlayerScoreをリストに入れて検索・ソートした際の挙動
+/// </summary>
+TEST(PlayerIdTest, CompactPlayerScoreTest)
+{
+	LinkedList<CompactPlayerScore> list;
+	list.Insert(list.End(), CompactPlayerScore(PlayerScore(300, "yst")));
+	list.Insert(list.End(), CompactPlayerScore(100, "PUCKUP"));
+	list.Insert(list.End(), CompactPlayerScore(200, "83force"));
+	list.Insert(list.End(), CompactPlayerScore(400, "a-very-long-player-name"));
+
+	const PlayerId key("PUCKUP");
+	auto found = list.End();
+	for (auto it = list.Begin(); it != list.End(); ++it)
+	{
+		if (it->id == key)
+		{
+			found = it;
+		}
+	}
+	ASSERT_NE(list.End(), found);
+	EXPECT_EQ(100, found->score);
+
+	list.Sort([](const CompactPlayerScore& a, const CompactPlayerScore& b) { return a.id < b.id; });
+	const char* expected[] = { "83force", "PUCKUP", "a-very-long-player-name", "yst" };
+	size_t index = 0;
+	for (auto it = list.CBegin(); it != list.CEnd(); ++it)
+	{
+		PlayerScore playerScore = it->ToPlayerScore();
+		EXPECT_EQ(expected[index++], playerScore.id);
+	}
+}
+
+#pragma endregion
+
+#pragma region 例外を使わないエラー処理
+
+namespace
+{
+	// 設定した関数に渡されたメッセージ
+	std::string gMisuseMessage;
+
+	struct MisuseDetected
+	{
+	};
+
+	void RecordingMisuseHandler(const char* message)
+	{
+		gMisuseMessage = message;
+		throw MisuseDetected();
+	}
+}
+
+/// <summary>
+/// ID_0 誤った使い方を検出した際に、設定した関数が呼ばれることをチェック
+/// </summary>
+TEST(ErrorPolicyTest, MisuseHandlerTest)
+{
+	const MisuseHandler previous = SetMisuseHandler(RecordingMisuseHandler);
+
+	LinkedList<int> list;
+	list.Insert(list.End(), 1);
+	EXPECT_THROW(*list.End(), MisuseDetected);
+	EXPECT_EQ("Invalid iterator", gMisuseMessage);
+
+	PlayerScoreEntry entry(10, "a");
+	PlayerRankingList ranking;
+	gMisuseMessage.clear();
+	EXPECT_THROW(ranking.IteratorTo(entry), MisuseDetected);
+	EXPECT_EQ("Element is not linked to this list", gMisuseMessage);
+
+	// 別のリストの要素を指すイテレータでスコアを変更しようとした
+	IndexedScoreList indexed;
+	IndexedScoreList other;
+	auto foreign = other.Insert(other.End(), PlayerScore(5, "b"));
+	gMisuseMessage.clear();
+	EXPECT_THROW(indexed.UpdateScore(foreign, 6), MisuseDetected);
+	EXPECT_EQ("Iterator does not belong to this list", gMisuseMessage);
+	EXPECT_EQ(5, foreign->score);
+
+	// 正しい使い方では呼ばれない
+	gMisuseMessage.clear();
+	EXPECT_EQ(1, *list.Begin());
+	EXPECT_TRUE(gMisuseMessage.empty());
+
+	// nullptrを設定すると既定の関数に戻る
+	EXPECT_EQ(RecordingMisuseHandler, SetMisuseHandler(nullptr));
+	EXPECT_THROW(*list.End(), std::runtime_error);
+	SetMisuseHandler(previous);
+}
+
+/// <summary>
+/// ID_1 プロセスを終了させる関数を設定した場合の挙動
+/// </summary>
+TEST(ErrorPolicyTest, TerminatingMisuseHandlerDeathTest)
+{
+	EXPECT_DEATH(
+	{
+		SetMisuseHandler(TerminatingMisuseHandler);
+		LinkedList<int> list;
+		++list.End();
+	}, "Invalid iterator");
+}
+
+/// <summary>
+/// ID_2 1行の解析結果と、解析できない理由
+/// </summary>
+TEST(ErrorPolicyTest, TryParseScoreLineTest)
+{
+	auto parsed = TryParseScoreLine(" +42	abc\r");
+	ASSERT_TRUE(parsed.HasValue());
+	EXPECT_EQ(42, parsed->score);
+	EXPECT_EQ("abc", parsed->id);
+
+	EXPECT_EQ(ScoreErrorReason::MissingTab, TryParseScoreLine("42 abc").Error());
+	EXPECT_EQ(ScoreErrorReason::MissingTab, TryParseScoreLine("").Error());
+	EXPECT_EQ(ScoreErrorReason::InvalidScore, TryParseScoreLine("x42	abc").Error());
+	EXPECT_EQ(ScoreErrorReason::ScoreOutOfRange, TryParseScoreLine("99999999999	abc").Error());
+
+	// 値を持たない結果から値を取り出すのは誤った使い方
+	EXPECT_THROW(TryParseScoreLine("abc").Value(), std::runtime_error);
+}
+
+/// <summary>
+/// ID_3 解析できない行を行番号と理由つきで通知し、読み飛ばすか途中でやめるかを選べることをチェック
+/// </summary>
+TEST(ErrorPolicyTest, TryLoadScoresTest)
+{
+	{
+		std::ofstream file("try_load_test.txt", std::ios::binary);
+		file << "10\ta\n";
+		file << "no tab\n";
+		file << "20\tb\r\n";
+		file << "abc\tc\n";
+		file << "30\td";
+	}
+
+	// 読み飛ばす場合は、解析できた行をすべて追加してすべてのエラーを通知する
+	std::vector<ScoreError> errors;
+	LinkedList<PlayerScore> list;
+	auto loaded = TryLoadScores("try_load_test.txt", list, [&errors](const ScoreError& error)
+	{
+		errors.push_back(error);
+		return ScoreErrorAction::Skip;
+	});
+	ASSERT_TRUE(loaded.HasValue());
+	EXPECT_EQ(3, *loaded);
+	EXPECT_EQ(3, list.Count());
+	ASSERT_EQ(2, errors.size());
+	EXPECT_EQ(2, errors[0].line);
+	EXPECT_EQ(ScoreErrorReason::MissingTab, errors[0].reason);
+	EXPECT_EQ(4, errors[1].line);
+	EXPECT_EQ(ScoreErrorReason::InvalidScore, errors[1].reason);
+
+	// 途中でやめる場合は、その行の手前までを追加してエラーを返す
+	LinkedList<PlayerScore> stopped;
+	auto result = TryLoadScores("try_load_test.txt", stopped, [](const ScoreError&) { return ScoreErrorAction::Stop; });
+	ASSERT_FALSE(result.HasValue());
+	EXPECT_EQ(2, result.Error().line);
+	EXPECT_EQ(ScoreErrorReason::MissingTab, result.Error().reason);
+	ASSERT_EQ(1, stopped.Count());
+	EXPECT_EQ("a", stopped.Begin()->id);
+
+	auto missing = TryLoadScores("no_such_file.txt", stopped, [](const ScoreError&) { return ScoreErrorAction::Skip; });
+	ASSERT_FALSE(missing.HasValue());
+	EXPECT_EQ(0, missing.Error().line);
+	EXPECT_EQ(ScoreErrorReason::OpenFailed, missing.Error().reason);
+
+	std::remove("try_load_test.txt");
+}
+
+#pragma endregion
+
+#pragma region ファイルの追従
+
+/// <summary>
+/// ID_0 末尾に改行で終わっていない行が残っていても、ファイルが変わらない限り待ち続けることをチェック
+/// </summary>
+TEST(ScoreFileFollowerTest, PartialLineTest)
+{
+	{
+		std::ofstream file("follow_test.txt", std::ios::binary);
+		file << "1\ta\n2\tb";
+	}
+
+	ScoreFileFollower follower("follow_test.txt", std::chrono::milliseconds(10));
+	LinkedList<PlayerScore> list;
+	EXPECT_EQ(1, follower.Poll(list));
+	EXPECT_FALSE(follower.Reloaded());
+	EXPECT_FALSE(follower.WaitForChange(std::chrono::milliseconds(100)));
+
+	{
+		std::ofstream file("follow_test.txt", std::ios::binary | std::ios::app);
+		file << "\n";
+	}
+	EXPECT_TRUE(follower.WaitForChange(std::chrono::milliseconds(1000)));
+	EXPECT_EQ(1, follower.Poll(list));
+	EXPECT_EQ(2, list.Count());
+	EXPECT_EQ("b", (++list.Begin())->id);
+
+	std::remove("follow_test.txt");
+}
+
+/// <summary>
+/// ID_1 ファイルが置き換えられたり切り詰められたりした場合に、リストを空にして先頭から読み直すことをチェック
+/// </summary>
+TEST(ScoreFileFollowerTest, ReplacedFileTest)
+{
+	{
+		std::ofstream file("follow_test.txt", std::ios::binary);
+		file << "1\ta\n2\tb\n3\tc\n";
+	}
+
+	ScoreFileFollower follower("follow_test.txt", std::chrono::milliseconds(10));
+	LinkedList<PlayerScore> list;
+	EXPECT_EQ(3, follower.Poll(list));
+
+	// 別のファイルを書いてから置き換える（ローテーション）
+	{
+		std::ofstream file("follow_test.new", std::ios::binary);
+		file << "10\tw\n20\tx\n30\ty\n40\tz\n";
+	}
+	std::remove("follow_test.txt");
+	ASSERT_EQ(0, std::rename("follow_test.new", "follow_test.txt"));
+
+	EXPECT_TRUE(follower.WaitForChange(std::chrono::milliseconds(1000)));
+	EXPECT_EQ(4, follower.Poll(list));
+	EXPECT_TRUE(follower.Reloaded());
+	ASSERT_EQ(4, list.Count());
+	EXPECT_EQ("w", list.Begin()->id);
+
+	// 切り詰められた
+	{
+		std::ofstream file("follow_test.txt", std::ios::binary | std::ios::trunc);
+		file << "5\tv\n";
+	}
+	EXPECT_EQ(1, follower.Poll(list));
+	EXPECT_TRUE(follower.Reloaded());
+	ASSERT_EQ(1, list.Count());
+	EXPECT_EQ("v", list.Begin()->id);
+
+	EXPECT_EQ(0, follower.Poll(list));
+	EXPECT_FALSE(follower.Reloaded());
+
+	std::remove("follow_test.txt");
+}
+
+#pragma endregion
+
+#pragma region スナップショット
+
+/// <summary>
+/// ID_0 保存したスナップショットから同じ内容が復元されることをチェック
+/// </summary>
+TEST(ScoreSnapshotTest, SaveAndLoadTest)
+{
+	LinkedList<PlayerScore> list;
+	list.Insert(list.End(), PlayerScore(34044, "yst"));
+	list.Insert(list.End(), PlayerScore(-1, ""));
+	list.Insert(list.End(), PlayerScore(10025, "PUCKUP"));
+
+	ASSERT_TRUE(SaveSnapshot(list, "snapshot_test.bin"));
+
+	LinkedList<PlayerScore> restored;
+	restored.Insert(restored.End(), PlayerScore(1, "old"));
+	ASSERT_TRUE(LoadSnapshot(restored, "snapshot_test.bin"));
+
+	ASSERT_EQ(3, restored.Count());
+	auto it = restored.CBegin();
+	for (auto expected = list.CBegin(); expected != list.CEnd(); ++expected, ++it)
+	{
+		EXPECT_EQ(expected->score, it->score);
+		EXPECT_EQ(expected->id, it->id);
+	}
+
+	std::remove("snapshot_test.bin");
+}
+
+/// <summary>
+/// ID_1 壊れたスナップショットを読み込んだ際にリストが変更されないことをチェック
+/// </summary>
+TEST(ScoreSnapshotTest, LoadCorruptedTest)
+{
+	LinkedList<PlayerScore> list;
+	list.Insert(list.End(), PlayerScore(34044, "yst"));
+	ASSERT_TRUE(SaveSnapshot(list, "snapshot_test.bin"));
+
+	// ペイロードの1バイトを書き換える
+	{
+		std::fstream file("snapshot_test.bin", std::ios::binary | std::ios::in | std::ios::out);
+		file.seekp(SnapshotHeader::Size);
+		file.put('x');
+	}
+
+	EXPECT_FALSE(LoadSnapshot(list, "snapshot_test.bin"));
+	EXPECT_EQ(1, list.Count());
+	EXPECT_EQ("yst", list.Begin()->id);
+
+	std::remove("snapshot_test.bin");
+}
+
+#pragma endregion
+
+#pragma region バージョン管理付きリスト
+
+/// <summary>
+/// ID_0 取得済みのスナップショットが後からの書き込みの影響を受けないことをチェック
+/// </summary>
+TEST(VersionedListTest, SnapshotIsolationTest)
+{
+	VersionedList<int, 4> list;
+	for (int i = 0; i < 10; i++)
+	{
+		list.PushBack(i);
+	}
+
+	auto before = list.GetSnapshot();
+
+	{
+		auto writer = list.BeginWrite();
+		writer.Remove(0);
+		writer.Insert(4, 100);
+		writer.Set(8, 200);
+
+		// コミット前の変更は見えない
+		EXPECT_EQ(10, list.Count());
+		writer.Commit();
+	}
+
+	auto after = list.GetSnapshot();
+	EXPECT_EQ(before.VersionNumber() + 1, after.VersionNumber());
+
+	int expectedBefore = 0;
+	for (auto it = before.CBegin(); it != before.CEnd(); ++it)
+	{
+		EXPECT_EQ(expectedBefore++, *it);
+	}
+	EXPECT_EQ(10, expectedBefore);
+
+	const int expectedAfter[] = { 1, 2, 3, 4, 100, 5, 6, 7, 200, 9 };
+	size_t index = 0;
+	for (auto it = after.CBegin(); it != after.CEnd(); ++it)
+	{
+		EXPECT_EQ(expectedAfter[index++], *it);
+	}
+	EXPECT_EQ(10, index);
+}
+
+/// <summary>
+/// ID_1 コミットせずに破棄したトランザクションの変更が捨てられることをチェック
+/// </summary>
+TEST(VersionedListTest, DiscardUncommittedWriteTest)
+{
+	VersionedList<int> list;
+	list.PushBack(1);
+
+	{
+		auto writer = list.BeginWrite();
+		writer.PushBack(2);
+	}
+
+	EXPECT_EQ(1, list.Count());
+	EXPECT_EQ(1, *list.GetSnapshot().CBegin());
+}
+
+/// <summary>
+/// ID_2 1要素ずつの書き込みを多数重ねて木が何段にもなっても、位置の検索と各スナップショットの内容が正しいことをチェック
+/// </summary>
+TEST(VersionedListTest, ManySmallWritesTest)
+{
+	VersionedList<int, 2> list;
+	std::vector<int> expected;
+	for (int i = 0; i < 500; i++)
+	{
+		list.PushBack(i);
+		expected.push_back(i);
+	}
+
+	auto before = list.GetSnapshot();
+	const std::vector<int> expectedBefore = expected;
+
+	uint32_t seed = 12345;
+	for (int i = 0; i < 300; i++)
+	{
+		seed = seed * 1103515245 + 12345;
+		const size_t index = (seed >> 8) % (expected.size() + 1);
+		auto writer = list.BeginWrite();
+		if (i % 3 == 2 && index < expected.size())
+		{
+			writer.Remove(index);
+			expected.erase(expected.begin() + index);
+		}
+		else
+		{
+			writer.Insert(index, 1000 + i);
+			expected.insert(expected.begin() + index, 1000 + i);
+		}
+		writer.Commit();
+	}
+
+	{
+		auto writer = list.BeginWrite();
+		ASSERT_EQ(expected.size(), writer.Count());
+		for (size_t i = 0; i < expected.size(); i++)
+		{
+			EXPECT_EQ(expected[i], writer.At(i));
+		}
+	}
+
+	std::vector<int> actual;
+	auto after = list.GetSnapshot();
+	for (auto it = after.CBegin(); it != after.CEnd(); ++it)
+	{
+		actual.push_back(*it);
+	}
+	EXPECT_EQ(expected, actual);
+
+	actual.clear();
+	for (auto it = before.CBegin(); it != before.CEnd(); ++it)
+	{
+		actual.push_back(*it);
+	}
+	EXPECT_EQ(expectedBefore, actual);
+
+	// すべて取り除いても空のリストとして使い続けられる
+	while (list.Count() > 0)
+	{
+		list.Remove(0);
+	}
+	EXPECT_TRUE(list.GetSnapshot().CBegin() == list.GetSnapshot().CEnd());
+	list.PushBack(7);
+	EXPECT_EQ(7, *list.GetSnapshot().CBegin());
+}
+
+/// <summary>
+/// ID_3 大半の要素を削除すると、容量の半分を下回ったノードが借用・併合されてノード数と木の高さが縮むことをチェック
+/// </summary>
+TEST(VersionedListTest, ShrinkAfterRemoveTest)
+{
+	VersionedList<int, 4> list;
+	std::vector<int> expected;
+	{
+		auto writer = list.BeginWrite();
+		for (int i = 0; i < 2000; i++)
+		{
+			writer.PushBack(i);
+			expected.push_back(i);
+		}
+		writer.Commit();
+	}
+
+	auto full = list.GetSnapshot();
+	// 葉500個を16分岐でまとめると4段になる
+	EXPECT_EQ(4, full.Height());
+	EXPECT_LE(500u, full.NodeCount());
+
+	uint32_t seed = 54321;
+	auto writer = list.BeginWrite();
+	while (expected.size() > 20)
+	{
+		seed = seed * 1103515245 + 12345;
+		const size_t index = (seed >> 8) % expected.size();
+		writer.Remove(index);
+		expected.erase(expected.begin() + index);
+	}
+	auto shrunk = writer.Commit();
+
+	std::vector<int> actual;
+	for (auto it = shrunk.CBegin(); it != shrunk.CEnd(); ++it)
+	{
+		actual.push_back(*it);
+	}
+	EXPECT_EQ(expected, actual);
+
+	// 根以外の葉は2要素以上残るので葉は高々10個、それを1つの根がまとめる
+	EXPECT_EQ(2, shrunk.Height());
+	EXPECT_GE(11u, shrunk.NodeCount());
+
+	// 削除前のスナップショットはそのまま残る
+	EXPECT_EQ(2000, full.Count());
+	EXPECT_EQ(4, full.Height());
+}
+
+#pragma endregion